@@ -0,0 +1,42 @@
+
+#include "local_cluster.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <numeric>
+
+// Throughput of a sharded filter whose owners run in their own processes, for a growing number of owners.
+int main()
+{
+    constexpr std::size_t keys = 400'000;
+
+    std::vector<std::uint64_t> values(keys);
+    std::iota(values.begin(), values.end(), 0);
+
+    auto found = std::make_unique<bool[]>(keys);
+
+    for (std::size_t owners : {1, 2, 4})
+    {
+        tnt::test::local_cluster cluster{owners};
+        std::size_t matched{};
+        double seconds{};
+
+        {
+            tnt::sharded_bloom<std::uint64_t, tnt::unix_socket_transport> bloom{*cluster.transport, keys, 0.01f};
+
+            auto const start = std::chrono::steady_clock::now();
+
+            bloom.insert(values.begin(), values.end());
+            matched = bloom.matches(values.begin(), values.end(), found.get());
+
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        cluster.stop();
+
+        std::printf("%zu owner(s): %.2f M keys/s%s\n", owners, 2 * keys / seconds / 1e6, matched == keys ? "" : " (some keys are missing!)");
+    }
+
+    return 0;
+}
@@ -0,0 +1,334 @@
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "bloom_filter.hpp"
+#include "string_hash.hpp"
+
+// The structures of the Arrow C data interface, as defined by the Arrow specification.
+// They are ABI-stable, so they can be defined here without depending on Arrow.
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C"
+{
+    struct ArrowSchema
+    {
+        // Array type description
+        const char *format;
+        const char *name;
+        const char *metadata;
+        int64_t flags;
+        int64_t n_children;
+        struct ArrowSchema **children;
+        struct ArrowSchema *dictionary;
+
+        // Release callback
+        void (*release)(struct ArrowSchema *);
+        // Opaque producer-specific data
+        void *private_data;
+    };
+
+    struct ArrowArray
+    {
+        // Array data description
+        int64_t length;
+        int64_t null_count;
+        int64_t offset;
+        int64_t n_buffers;
+        int64_t n_children;
+        const void **buffers;
+        struct ArrowArray **children;
+        struct ArrowArray *dictionary;
+
+        // Release callback
+        void (*release)(struct ArrowArray *);
+        // Opaque producer-specific data
+        void *private_data;
+    };
+}
+
+#endif // ARROW_C_DATA_INTERFACE
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // rows are hashed 64 at a time, so that the validity and the results of a chunk fit in one word.
+    inline constexpr std::size_t arrow_chunk = 64;
+
+    template <typename V>
+    inline V load_arrow_value(void const *values, std::int64_t index) noexcept
+    {
+        V value;
+        std::memcpy(&value, static_cast<unsigned char const *>(values) + index * static_cast<std::int64_t>(sizeof(V)), sizeof(V));
+        return value;
+    }
+
+    // call `f(first_row, rows, hashes, valid)` for each chunk of the column, where bit i of `valid` tells whether row `first_row + i` is not null.
+    // `V` is the type of the values, or the type of the offsets of a string or binary column when `Strings` is set.
+    template <typename T, typename Hash, typename V, bool Strings, typename F>
+    void hash_arrow_column(Hash const &hash, ArrowArray const &array, F &&f)
+    {
+        auto const validity = static_cast<unsigned char const *>(array.buffers[0]);
+        auto const values = array.buffers[1];
+        auto const data = Strings ? static_cast<char const *>(array.buffers[2]) : nullptr;
+
+        std::uint64_t hashes[arrow_chunk];
+
+        for (std::int64_t first{}; first < array.length; first += arrow_chunk)
+        {
+            auto const rows = static_cast<std::size_t>(array.length - first < static_cast<std::int64_t>(arrow_chunk) ? array.length - first : arrow_chunk);
+
+            std::uint64_t valid = rows == arrow_chunk ? ~std::uint64_t{} : (std::uint64_t{1} << rows) - 1;
+
+            // strings hashed with `string_hash` go through its batched hasher, null rows included since their offsets are valid too.
+            if constexpr (Strings && std::is_same_v<Hash, string_hash>)
+                hash.batch(static_cast<V const *>(values) + array.offset + first, data, rows, hashes);
+
+            for (std::size_t i{}; i < rows; ++i)
+            {
+                auto const row = array.offset + first + static_cast<std::int64_t>(i);
+
+                if (validity && array.null_count != 0 && ((validity[row >> 3] >> (row & 7)) & 1) == 0)
+                {
+                    valid &= ~(std::uint64_t{1} << i);
+                    continue;
+                }
+
+                if constexpr (Strings && std::is_same_v<Hash, string_hash>)
+                    continue;
+                else if constexpr (Strings)
+                {
+                    auto const begin = load_arrow_value<V>(values, row);
+                    auto const end = load_arrow_value<V>(values, row + 1);
+
+                    hashes[i] = hash(std::string_view{data + begin, static_cast<std::size_t>(end - begin)});
+                }
+                else
+                    hashes[i] = hash(static_cast<T>(load_arrow_value<V>(values, row)));
+            }
+
+            f(static_cast<std::size_t>(first), rows, static_cast<std::uint64_t const *>(hashes), valid);
+        }
+    }
+
+    template <typename T, typename Hash, typename F>
+    void visit_arrow_column(Hash const &hash, ArrowArray const &array, ArrowSchema const &schema, F &&f);
+
+    // call `f` as `hash_arrow_column` does for a dictionary-encoded column, whose rows are indices of type `I` into the dictionary.
+    // The values of the dictionary are hashed once, and a row is null if either its index or the value it points to is null.
+    template <typename T, typename Hash, typename I, typename F>
+    void hash_arrow_indices(Hash const &hash, ArrowArray const &array, ArrowSchema const &schema, F &&f)
+    {
+        if (!array.dictionary)
+            throw std::invalid_argument{"A dictionary-encoded Arrow column must come with its dictionary!"};
+
+        auto const size = array.dictionary->length;
+
+        std::vector<std::uint64_t> values(static_cast<std::size_t>(size));
+        std::vector<std::uint64_t> present(static_cast<std::size_t>(size + 63) / 64);
+
+        visit_arrow_column<T>(
+            hash, *array.dictionary, *schema.dictionary,
+            [&](std::size_t first, std::size_t rows, std::uint64_t const *hashes, std::uint64_t valid)
+            {
+                std::copy_n(hashes, rows, values.data() + first);
+                present[first / 64] = valid;
+            });
+
+        auto const validity = static_cast<unsigned char const *>(array.buffers[0]);
+        auto const indices = array.buffers[1];
+
+        std::uint64_t hashes[arrow_chunk];
+
+        for (std::int64_t first{}; first < array.length; first += arrow_chunk)
+        {
+            auto const rows = static_cast<std::size_t>(array.length - first < static_cast<std::int64_t>(arrow_chunk) ? array.length - first : arrow_chunk);
+
+            std::uint64_t valid = rows == arrow_chunk ? ~std::uint64_t{} : (std::uint64_t{1} << rows) - 1;
+
+            for (std::size_t i{}; i < rows; ++i)
+            {
+                auto const row = array.offset + first + static_cast<std::int64_t>(i);
+
+                if (validity && array.null_count != 0 && ((validity[row >> 3] >> (row & 7)) & 1) == 0)
+                {
+                    valid &= ~(std::uint64_t{1} << i);
+                    continue;
+                }
+
+                auto const index = static_cast<std::int64_t>(load_arrow_value<I>(indices, row));
+
+                if (index < 0 || index >= size)
+                    throw std::invalid_argument{"An index of the dictionary-encoded Arrow column is out of the dictionary!"};
+
+                if (((present[static_cast<std::size_t>(index) / 64] >> (index & 63)) & 1) == 0)
+                    valid &= ~(std::uint64_t{1} << i);
+                else
+                    hashes[i] = values[static_cast<std::size_t>(index)];
+            }
+
+            f(static_cast<std::size_t>(first), rows, static_cast<std::uint64_t const *>(hashes), valid);
+        }
+    }
+
+    // dispatch on the format string of the schema, and throw if the column cannot be hashed with `Hash`.
+    template <typename T, typename Hash, typename F>
+    void visit_arrow_column(Hash const &hash, ArrowArray const &array, ArrowSchema const &schema, F &&f)
+    {
+        auto const format = std::string_view{schema.format ? schema.format : ""};
+
+        // the format of a dictionary-encoded column is the type of its indices, which are always integers.
+        if (schema.dictionary)
+        {
+            if (format.size() == 1)
+            {
+                switch (format[0])
+                {
+                case 'c':
+                    return hash_arrow_indices<T, Hash, std::int8_t>(hash, array, schema, f);
+                case 'C':
+                    return hash_arrow_indices<T, Hash, std::uint8_t>(hash, array, schema, f);
+                case 's':
+                    return hash_arrow_indices<T, Hash, std::int16_t>(hash, array, schema, f);
+                case 'S':
+                    return hash_arrow_indices<T, Hash, std::uint16_t>(hash, array, schema, f);
+                case 'i':
+                    return hash_arrow_indices<T, Hash, std::int32_t>(hash, array, schema, f);
+                case 'I':
+                    return hash_arrow_indices<T, Hash, std::uint32_t>(hash, array, schema, f);
+                case 'l':
+                    return hash_arrow_indices<T, Hash, std::int64_t>(hash, array, schema, f);
+                case 'L':
+                    return hash_arrow_indices<T, Hash, std::uint64_t>(hash, array, schema, f);
+                default:
+                    break;
+                }
+            }
+
+            throw std::invalid_argument{"The indices of a dictionary-encoded Arrow column must be integers!"};
+        }
+
+        if (format.size() == 1)
+        {
+            if constexpr (std::is_arithmetic_v<T>)
+            {
+                switch (format[0])
+                {
+                case 'c':
+                    return hash_arrow_column<T, Hash, std::int8_t, false>(hash, array, f);
+                case 'C':
+                    return hash_arrow_column<T, Hash, std::uint8_t, false>(hash, array, f);
+                case 's':
+                    return hash_arrow_column<T, Hash, std::int16_t, false>(hash, array, f);
+                case 'S':
+                    return hash_arrow_column<T, Hash, std::uint16_t, false>(hash, array, f);
+                case 'i':
+                    return hash_arrow_column<T, Hash, std::int32_t, false>(hash, array, f);
+                case 'I':
+                    return hash_arrow_column<T, Hash, std::uint32_t, false>(hash, array, f);
+                case 'l':
+                    return hash_arrow_column<T, Hash, std::int64_t, false>(hash, array, f);
+                case 'L':
+                    return hash_arrow_column<T, Hash, std::uint64_t, false>(hash, array, f);
+                case 'f':
+                    return hash_arrow_column<T, Hash, float, false>(hash, array, f);
+                case 'g':
+                    return hash_arrow_column<T, Hash, double, false>(hash, array, f);
+                default:
+                    break;
+                }
+            }
+
+            if constexpr (std::is_invocable_r_v<std::size_t, Hash const &, std::string_view>)
+            {
+                switch (format[0])
+                {
+                case 'u':
+                case 'z':
+                    return hash_arrow_column<T, Hash, std::int32_t, true>(hash, array, f);
+                case 'U':
+                case 'Z':
+                    return hash_arrow_column<T, Hash, std::int64_t, true>(hash, array, f);
+                default:
+                    break;
+                }
+            }
+        }
+
+        throw std::invalid_argument{"This Arrow column type cannot be hashed with the hash function of the filter!"};
+    }
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief Insert all the non-null values of an Arrow column into a filter, reading the buffers of the column in place.
+    /// Integer and floating point columns are hashed as `T`, so they land in the same place as with `filter.insert(T(value))`,
+    /// while string and binary columns (`utf8`, `large_utf8`, `binary`, `large_binary`) are hashed as `std::string_view`, which `Hash` must accept.
+    /// Dictionary-encoded columns are decoded: each value of the dictionary is hashed once, and rows are hashed as the value their index points to.
+    /// @param filter The filter to insert the values into, eg. a `tnt::bloom_filter<std::int64_t>` or a `tnt::bloom_filter<std::string_view>`.
+    /// @param array The column, as exported through the Arrow C data interface.
+    /// @param schema The type of the column.
+    /// @throw std::invalid_argument if the type of the column is not supported, cannot be hashed with the hash function of the filter,
+    /// or if an index of a dictionary-encoded column is out of its dictionary.
+    template <typename T, typename Hash, typename Alloc>
+    void arrow_insert(bloom_filter<T, Hash, Alloc> &filter, ArrowArray const &array, ArrowSchema const &schema)
+    {
+        utils::visit_arrow_column<T>(
+            filter.hash_function(), array, schema,
+            [&](std::size_t, std::size_t rows, std::uint64_t const *hashes, std::uint64_t valid)
+            {
+                for (std::size_t i{}; i < rows; ++i)
+                {
+                    if ((valid >> i) & 1)
+                        filter.insert_hash(hashes[i]);
+                }
+            });
+    }
+
+    /// @brief Check all the values of an Arrow column against a filter, writing the results into an Arrow boolean bitmap.
+    /// Bit `i` of the bitmap is set if row `i` *might* be present in the filter. Null rows are never present. See `arrow_insert` for how values are hashed.
+    /// @param filter The filter to check the values against.
+    /// @param array The column, as exported through the Arrow C data interface.
+    /// @param schema The type of the column.
+    /// @param bitmap Where to write the results, starting at bit 0. It must have room for `array.length` bits, rounded up to whole bytes.
+    /// @return The number of rows that might be present.
+    /// @throw std::invalid_argument if the type of the column is not supported, cannot be hashed with the hash function of the filter,
+    /// or if an index of a dictionary-encoded column is out of its dictionary.
+    template <typename T, typename Hash, typename Alloc>
+    std::size_t arrow_matches(bloom_filter<T, Hash, Alloc> const &filter, ArrowArray const &array, ArrowSchema const &schema, std::uint8_t *bitmap)
+    {
+        std::size_t count{};
+
+        utils::visit_arrow_column<T>(
+            filter.hash_function(), array, schema,
+            [&](std::size_t first, std::size_t rows, std::uint64_t const *hashes, std::uint64_t valid)
+            {
+                std::uint64_t found{};
+
+                for (std::size_t i{}; i < rows; ++i)
+                    found |= std::uint64_t{(valid >> i) & 1 && filter.matches_hash(hashes[i])} << i;
+
+                count += utils::popcount(found);
+
+                // chunks start on a byte boundary, and bitmaps are in little-endian bit order.
+                for (std::size_t byte{}; byte < (rows + 7) / 8; ++byte)
+                    bitmap[first / 8 + byte] = static_cast<std::uint8_t>(found >> (byte * 8));
+            });
+
+        return count;
+    }
+}
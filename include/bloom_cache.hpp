@@ -0,0 +1,75 @@
+
+#pragma once
+
+#include "bloom_filter.hpp"
+
+namespace tnt
+{
+    /// @brief A small direct-mapped cache of the results of `bloom_filter::matches`, for query streams where the same hot keys are checked over and over.
+    /// A cached hit is answered from a few bytes that stay in L1 instead of `k` random reads of the filter.
+    /// Positive results stay valid until the filter is cleared, since inserting only sets more bits, while negative results are dropped as soon as the filter changes `version()`.
+    /// The cache is not thread-safe, so each thread querying the filter should have its own, eg. as a `thread_local`.
+    /// @note The cache only keeps a pointer to the filter, which must outlive it. Call `reset()` after assigning to or swapping the filter.
+    /// @tparam Filter The type of the cached filter, which must count its versions, such as `tnt::versioned_bloom<T>`, `tnt::overlay_bloom<T>` or `tnt::cow_bloom<T>`.
+    /// @tparam Slots The number of cached results, must be a power of two. Defaults to 128, which takes 3 KB.
+    template <typename Filter, std::size_t Slots = 128>
+    class bloom_cache final
+    {
+        static_assert(Slots != 0 && (Slots & (Slots - 1)) == 0, "The number of slots must be a power of two!");
+
+    public:
+        /// @brief Construct an empty cache for the given filter.
+        /// @param filter The filter whose results are cached.
+        constexpr explicit bloom_cache(Filter const &filter) noexcept
+            : filter{&filter},
+              generation{filter.generation()}
+        {
+        }
+
+        /// @brief Check whether the given value *might* be present in the filter, with the same result as `filter.matches(value)`.
+        /// @param value The value to check.
+        template <typename U>
+        constexpr bool matches(U &&value) noexcept
+        {
+            if (auto const current = filter->generation(); current != generation)
+            {
+                reset();
+                generation = current;
+            }
+
+            auto const hash = filter->hash_function()(value);
+            auto const version = filter->version();
+
+            // the hash might be weak, so remix it to pick the slot.
+            auto &slot = slots[utils::mix64(hash) & (Slots - 1)];
+
+            if (slot.used && slot.hash == hash && (slot.found || slot.version == version))
+                return slot.found;
+
+            auto const found = filter->matches_hash(hash);
+            slot = entry{hash, version, found, true};
+
+            return found;
+        }
+
+        /// @brief Drop all the cached results.
+        constexpr void reset() noexcept
+        {
+            for (auto &slot : slots)
+                slot.used = false;
+        }
+
+    private:
+        struct entry final
+        {
+            std::size_t hash;
+            std::size_t version;
+            bool found;
+            bool used;
+        };
+
+        Filter const *filter;
+        std::size_t generation;
+        entry slots[Slots]{};
+    };
+}
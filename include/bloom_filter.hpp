@@ -1,9 +1,12 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <memory>
 #include <memory_resource>
+#include <vector>
 
 #if __has_include(<version>)
 #include <version>
@@ -35,10 +38,18 @@ namespace tnt::utils
         inline static constexpr std::size_t high_shift = sizeof(std::size_t) / 2 * 8;
     };
 
+    // the number of hashes, and of probe positions, handled at once by batched insertion.
+    inline constexpr std::size_t bloom_batch = 1'024;
+
     template <typename Alloc>
     struct deduce_allocator final
     {
-        using type = std::allocator_traits<Alloc>::template rebind_alloc<std::uint64_t>;
+        using type = typename std::allocator_traits<Alloc>::template rebind_alloc<std::uint64_t>;
+    };
+
+    // the allocator of storages that do not take one.
+    struct no_allocator final
+    {
     };
 }
 
@@ -46,6 +57,15 @@ namespace tnt::utils
 
 namespace tnt
 {
+    template <typename T, typename Hash, typename Alloc>
+    class overlay_bloom;
+
+    template <typename T, typename Hash, typename Alloc>
+    class resizable_bloom;
+
+    template <typename T, typename Alloc>
+    class hybrid_int_filter;
+
     /// @brief Utility function that calculates the number of bits to be used in the bloom filter. Useful for pre-allocating the storage if desired.
     /// @param n The number of elements to be inserted into the filter.
     /// @param eps The desired false positive rate.
@@ -78,23 +98,505 @@ namespace tnt
         return static_cast<std::size_t>(n * -ln_eps / ln_2p2);
     }
 
-    /// @brief A bloom filter is a space-efficient probabilistic data structure that is used to test whether an element might be a member of a set.
+    /// @brief The number of set bits in each region of a filter, as returned by `bloom_filter::fill_histogram`.
+    struct bloom_histogram final
+    {
+        /// @brief The number of set bits in each region.
+        std::vector<std::size_t> counts;
+
+        /// @brief The number of bits covered by each region. The last region might be shorter.
+        std::size_t region_bits;
+
+        /// @brief The number of bits of the whole filter.
+        std::size_t bits;
+
+        /// @brief The number of bits covered by the given region.
+        std::size_t size(std::size_t region) const noexcept
+        {
+            auto const from = region * region_bits;
+            return bits - from < region_bits ? bits - from : region_bits;
+        }
+
+        /// @brief The ratio of set bits over the whole filter.
+        double fill_ratio() const noexcept
+        {
+            std::size_t set{};
+
+            for (auto const c : counts)
+                set += c;
+
+            return bits ? static_cast<double>(set) / bits : 0.0;
+        }
+
+        /// @brief The highest ratio of set bits of a single region. Regions close to 1 are saturated, and every query that probes them is likely to match there.
+        double max_fill_ratio() const noexcept
+        {
+            double worst{};
+
+            for (std::size_t r{}; r < counts.size(); ++r)
+            {
+                auto const ratio = static_cast<double>(counts[r]) / size(r);
+                worst = ratio > worst ? ratio : worst;
+            }
+
+            return worst;
+        }
+
+        /// @brief How far the fill of the regions is from what uniformly spread probes would give:
+        /// the largest deviation of a region from the overall fill ratio, in standard deviations of a binomial distribution.
+        /// Values up to about 4 are expected from a good hash function, while much higher values point to a skewed hash function or adversarial keys.
+        double skew() const noexcept
+        {
+            auto const p = fill_ratio();
+
+            if (p <= 0.0 || p >= 1.0)
+                return 0.0;
+
+            double worst{};
+
+            for (std::size_t r{}; r < counts.size(); ++r)
+            {
+                auto const n = static_cast<double>(size(r));
+                auto const z = std::abs(counts[r] - n * p) / std::sqrt(n * p * (1.0 - p));
+
+                worst = z > worst ? z : worst;
+            }
+
+            return worst;
+        }
+    };
+
+    /// @brief Probes spread over the whole filter, each of them reduced to a bit of its own. This gives the lowest false positive rate for a given size, but every probe is a cache miss on large filters.
+    struct classic_layout final
+    {
+        /// @brief The number of bits the reducer picks from.
+        inline static constexpr std::size_t block_bits = 1;
+
+        /// @brief Call `f(word, mask)` for each probe of the hash, until `f` returns false.
+        template <typename Reducer, typename F>
+        static constexpr void probe(std::size_t hash, std::size_t k, Reducer const &reduce, F &&f) noexcept
+        {
+            auto const step = hash & utils::size_traits::low_mask;
+
+            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            // strategy based on
+            // https://github.com/Claudenw/BloomFilters/wiki/Bloom-Filters----An-overview
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+
+                auto const index = reduce(h);
+
+                if (!f(index >> 6, std::uint64_t{1} << (index & 63)))
+                    return;
+            }
+        }
+    };
+
+    /// @brief All the probes of a value fall in the same 512-bit block, ie. a single cache line, at the cost of a slightly higher false positive rate.
+    /// The block is picked from the high half of the hash, and each probe takes 9 bits of the low half, remixed by a multiplication as in RocksDB filters.
+    struct blocked_layout final
+    {
+        /// @brief The number of bits the reducer picks from.
+        inline static constexpr std::size_t block_bits = 512;
+
+        /// @brief Call `f(word, mask)` for each probe of the hash, until `f` returns false.
+        template <typename Reducer, typename F>
+        static constexpr void probe(std::size_t hash, std::size_t k, Reducer const &reduce, F &&f) noexcept
+        {
+            auto const block = reduce((hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift) * 8;
+
+            auto h = static_cast<std::uint32_t>(hash);
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                auto const bit = h >> (32 - 9);
+
+                if (!f(block + (bit >> 6), std::uint64_t{1} << (bit & 63)))
+                    return;
+
+                h *= 0x9e37'79b9u;
+            }
+        }
+    };
+
+    /// @brief Like `blocked_layout`, but consecutive probes go to consecutive 64-bit words (sectors) of the block, so that up to 8 probes never share a word.
+    struct sectorized_layout final
+    {
+        /// @brief The number of bits the reducer picks from.
+        inline static constexpr std::size_t block_bits = 512;
+
+        /// @brief Call `f(word, mask)` for each probe of the hash, until `f` returns false.
+        template <typename Reducer, typename F>
+        static constexpr void probe(std::size_t hash, std::size_t k, Reducer const &reduce, F &&f) noexcept
+        {
+            auto const block = reduce((hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift) * 8;
+
+            auto h = static_cast<std::uint32_t>(hash);
+            auto const first = h & 7;
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h *= 0x9e37'79b9u;
+
+                if (!f(block + ((first + i) & 7), std::uint64_t{1} << (h >> (32 - 6))))
+                    return;
+            }
+        }
+    };
+
+    /// @brief Map probes to `[0, n)` with an exact modulo, computed with a precomputed reciprocal instead of a division.
+    struct modulo_reducer final
+    {
+        constexpr modulo_reducer() noexcept = default;
+
+        constexpr explicit modulo_reducer(std::size_t n) noexcept
+            : mod{n}
+        {
+        }
+
+        /// @brief The number of bits (or blocks) a reducer over at least `n` of them uses.
+        static constexpr std::size_t size(std::size_t n) noexcept
+        {
+            return n;
+        }
+
+        constexpr std::size_t operator()(std::uint64_t h) const noexcept
+        {
+            return static_cast<std::size_t>(mod(h));
+        }
+
+        utils::fast_modulo mod;
+    };
+
+    /// @brief Map probes to `[0, n)` with a multiplication and a shift (Lemire's fast range), using the low 32 bits of each probe. Cheaper than `modulo_reducer`, but not the same mapping.
+    struct fast_range_reducer final
+    {
+        constexpr fast_range_reducer() noexcept = default;
+
+        constexpr explicit fast_range_reducer(std::size_t n) noexcept
+            : n{n}
+        {
+        }
+
+        /// @brief The number of bits (or blocks) a reducer over at least `n` of them uses.
+        static constexpr std::size_t size(std::size_t n) noexcept
+        {
+            return n;
+        }
+
+        constexpr std::size_t operator()(std::uint64_t h) const noexcept
+        {
+            return static_cast<std::size_t>(utils::mulhi(h << 32, n));
+        }
+
+        std::uint64_t n{};
+    };
+
+    /// @brief Map probes to `[0, n)` with a mask, rounding the size of the filter up to a power of two. The cheapest reducer, at the cost of up to twice the memory.
+    struct mask_reducer final
+    {
+        constexpr mask_reducer() noexcept = default;
+
+        constexpr explicit mask_reducer(std::size_t n) noexcept
+            : mask{n ? n - 1 : 0}
+        {
+        }
+
+        /// @brief The number of bits (or blocks) a reducer over at least `n` of them uses.
+        static constexpr std::size_t size(std::size_t n) noexcept
+        {
+            std::size_t p{1};
+
+            while (p < n)
+                p <<= 1;
+
+            return p;
+        }
+
+        constexpr std::size_t operator()(std::uint64_t h) const noexcept
+        {
+            return static_cast<std::size_t>(h & mask);
+        }
+
+        std::uint64_t mask{};
+    };
+
+    /// @brief Stop a query at the first probe that misses, which saves memory accesses for absent values.
+    struct early_exit_probe final
+    {
+        inline static constexpr bool early_exit = true;
+    };
+
+    /// @brief Check every probe of a query without branching on the bits, which avoids mispredictions when about half of the queries match.
+    struct branch_free_probe final
+    {
+        inline static constexpr bool early_exit = false;
+    };
+
+    /// @brief Keep no insert or clear counters, so that insertions do not pay for them. The filter then has no `version()` and `generation()`.
+    struct unversioned
+    {
+        template <bool Concurrent>
+        constexpr void inserted(std::size_t) noexcept {}
+
+        template <bool Concurrent>
+        constexpr void cleared() noexcept {}
+
+        friend constexpr void swap(unversioned &, unversioned &) noexcept {}
+    };
+
+    /// @brief Count insertions and clears, so that `tnt::bloom_cache` can tell when its cached results go stale.
+    /// Counters are bumped with a release store once the bits are written, and read with an acquire load, so whoever sees a new `version()` also sees the bits of the insertions it counts, even with `atomic_storage`.
+    class versioned
+    {
+    public:
+        constexpr versioned() noexcept = default;
+
+        inline versioned(versioned const &rhs) noexcept
+            : inserts{rhs.version()},
+              clears{rhs.generation()}
+        {
+        }
+
+        inline versioned &operator=(versioned const &rhs) noexcept
+        {
+            inserts.store(rhs.version(), std::memory_order_release);
+            clears.store(rhs.generation(), std::memory_order_release);
+
+            return *this;
+        }
+
+        template <bool Concurrent>
+        inline void inserted(std::size_t n) noexcept
+        {
+            bump<Concurrent>(inserts, n);
+        }
+
+        template <bool Concurrent>
+        inline void cleared() noexcept
+        {
+            bump<Concurrent>(clears, 1);
+        }
+
+        inline std::size_t version() const noexcept
+        {
+            return inserts.load(std::memory_order_acquire);
+        }
+
+        inline std::size_t generation() const noexcept
+        {
+            return clears.load(std::memory_order_acquire);
+        }
+
+        friend inline void swap(versioned &lhs, versioned &rhs) noexcept
+        {
+            versioned const tmp{lhs};
+
+            lhs = rhs;
+            rhs = tmp;
+        }
+
+    private:
+        // a single writer needs no read-modify-write, only the release store.
+        template <bool Concurrent>
+        static inline void bump(std::atomic<std::size_t> &counter, std::size_t n) noexcept
+        {
+            if constexpr (Concurrent)
+                counter.fetch_add(n, std::memory_order_release);
+            else
+                counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_release);
+        }
+
+        std::atomic<std::size_t> inserts{};
+        std::atomic<std::size_t> clears{};
+    };
+
+    /// @brief Bits stored in memory from an allocator, sized at runtime.
+    /// @tparam Alloc The allocator to be used for memory management.
+    template <typename Alloc>
+    class allocator_storage
+        : private utils::deduce_allocator<Alloc>::type
+    {
+    public:
+        /// @brief The allocator of the storage.
+        using allocator_type = typename utils::deduce_allocator<Alloc>::type;
+
+        /// @brief The number of words of a fixed-size storage, or 0 if the size is picked at runtime.
+        inline static constexpr std::size_t fixed_words = 0;
+
+        /// @brief Whether insertions and queries can run from several threads at once.
+        inline static constexpr bool concurrent = false;
+
+        constexpr allocator_storage(allocator_type const &alloc = allocator_type{}) noexcept
+            : allocator_type(alloc)
+        {
+        }
+
+        // copies only share the allocator, the filter then allocates and copies the words.
+        constexpr allocator_storage(allocator_storage const &rhs) noexcept
+            : allocator_type(rhs)
+        {
+        }
+
+        constexpr allocator_type const &get_allocator() const noexcept
+        {
+            return *this;
+        }
+
+        CONST_ALLOC void allocate(std::size_t len)
+        {
+            words_ = allocator_type::allocate(len);
+            std::fill_n(words_, len, 0);
+        }
+
+        CONST_ALLOC void deallocate(std::size_t len) noexcept
+        {
+            if (words_)
+                allocator_type::deallocate(words_, len);
+
+            words_ = nullptr;
+        }
+
+        constexpr void clear(std::size_t len) noexcept
+        {
+            std::fill_n(words_, len, 0);
+        }
+
+        constexpr std::uint64_t *words() noexcept
+        {
+            return words_;
+        }
+
+        constexpr std::uint64_t const *words() const noexcept
+        {
+            return words_;
+        }
+
+        static constexpr void set(std::uint64_t *word, std::uint64_t mask) noexcept
+        {
+            *word |= mask;
+        }
+
+        static constexpr std::uint64_t load(std::uint64_t const *word) noexcept
+        {
+            return *word;
+        }
+
+        friend CONST_SWAP void swap(allocator_storage &lhs, allocator_storage &rhs) noexcept
+        {
+            std::swap(lhs.words_, rhs.words_);
+            std::swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+        }
+
+    private:
+        std::uint64_t *words_{};
+    };
+
+    /// @brief Bits stored inline, with a size fixed at compile time, so that the filter needs no allocation at all.
+    /// The number of elements given to the filter is then only used for the number of probes.
+    /// @tparam Bits The number of bits of the filter, rounded up to whole 64-bit words.
+    template <std::size_t Bits>
+    class static_storage
+    {
+    public:
+        /// @brief Static storage takes no allocator.
+        using allocator_type = utils::no_allocator;
+
+        /// @brief The number of words of a fixed-size storage, or 0 if the size is picked at runtime.
+        inline static constexpr std::size_t fixed_words = (Bits + 63) / 64;
+
+        /// @brief Whether insertions and queries can run from several threads at once.
+        inline static constexpr bool concurrent = false;
+
+        static_assert(fixed_words > 0, "Static storage needs at least one word!");
+
+        constexpr static_storage(allocator_type = {}) noexcept {}
+
+        constexpr allocator_type get_allocator() const noexcept
+        {
+            return {};
+        }
+
+        constexpr void allocate(std::size_t) noexcept {}
+
+        constexpr void deallocate(std::size_t) noexcept {}
+
+        constexpr void clear(std::size_t len) noexcept
+        {
+            std::fill_n(words_, len, 0);
+        }
+
+        constexpr std::uint64_t *words() noexcept
+        {
+            return words_;
+        }
+
+        constexpr std::uint64_t const *words() const noexcept
+        {
+            return words_;
+        }
+
+        static constexpr void set(std::uint64_t *word, std::uint64_t mask) noexcept
+        {
+            *word |= mask;
+        }
+
+        static constexpr std::uint64_t load(std::uint64_t const *word) noexcept
+        {
+            return *word;
+        }
+
+        friend CONST_SWAP void swap(static_storage &lhs, static_storage &rhs) noexcept
+        {
+            for (std::size_t i{}; i < fixed_words; ++i)
+                std::swap(lhs.words_[i], rhs.words_[i]);
+        }
+
+    private:
+        std::uint64_t words_[fixed_words]{};
+    };
+
+    /// @brief A bloom filter whose hot paths are put together at compile time from policies:
+    /// - `Layout` picks where the probes of a value go: `classic_layout`, `blocked_layout` or `sectorized_layout`.
+    /// - `Reducer` maps probes to the size of the filter: `modulo_reducer`, `fast_range_reducer` or `mask_reducer`.
+    /// - `Probe` picks how queries go through the probes: `early_exit_probe` or `branch_free_probe`.
+    /// - `Storage` holds the bits: `allocator_storage`, `static_storage`, `atomic_storage` (see atomic_bloom.hpp) or `mmap_storage` (see mapped_bloom.hpp).
+    /// - `Versions` picks whether insertions and clears are counted: `unversioned` or `versioned`, which `tnt::bloom_cache` needs.
+    ///
+    /// `tnt::bloom_filter`, `tnt::versioned_bloom`, `tnt::dynamic_bloom` and `tnt::atomic_bloom` are aliases of this class.
     /// @tparam T The type of the elements to be inserted into the bloom filter.
     /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
-    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    /// @tparam Layout Where the probes of a value go. Defaults to `classic_layout`.
+    /// @tparam Reducer How probes are mapped to the size of the filter. Defaults to `modulo_reducer`.
+    /// @tparam Probe How queries go through the probes. Defaults to `early_exit_probe`.
+    /// @tparam Storage Where the bits are stored. Defaults to `allocator_storage<std::allocator<std::uint64_t>>`.
+    /// @tparam Versions Whether insertions and clears are counted. Defaults to `unversioned`.
     template <
         typename T,
         typename Hash = std::hash<T>,
-        typename Alloc = std::allocator<std::uint64_t>>
-    class bloom_filter final
+        typename Layout = classic_layout,
+        typename Reducer = modulo_reducer,
+        typename Probe = early_exit_probe,
+        typename Storage = allocator_storage<std::allocator<std::uint64_t>>,
+        typename Versions = unversioned>
+    class basic_bloom final
         : private Hash,
-          private utils::deduce_allocator<Alloc>::type
+          private Storage,
+          private Versions
     {
         static_assert(
             utils::is_hashable_with<T, Hash>::value,
             "Hash must be a callable object that returns a size_t!");
 
-        using allocator_type = typename utils::deduce_allocator<Alloc>::type;
+        static_assert(
+            Storage::fixed_words == 0 ||
+                (Storage::fixed_words * 64 % Layout::block_bits == 0 &&
+                 Reducer::size(Storage::fixed_words * 64 / Layout::block_bits) == Storage::fixed_words * 64 / Layout::block_bits),
+            "The static storage must hold whole blocks, and as many of them as the reducer works with!");
+
+        using allocator_type = typename Storage::allocator_type;
 
     public:
         /// @brief Construct a new instance of the bloom filter, given the number of elements and the desired false positive rate.
@@ -102,80 +604,227 @@ namespace tnt
         /// @param eps The desired false positive rate. Defaults to 0.01 (1% false positives).
         /// @param hash The hash function to be used for hashing the elements.
         /// @param alloc The allocator to be used for memory management.
-        CONST_ALLOC bloom_filter(
+        CONST_ALLOC basic_bloom(
             std::size_t n,
             float eps = 0.01f,
             Hash const &hash = Hash{},
             allocator_type const &alloc = allocator_type{})
             : Hash(hash),
-              allocator_type(alloc)
+              Storage(alloc)
         {
             auto const nlog_eps = -std::log(eps);
             auto const log_2 = 0.6931471805599453f;
 
-            m = static_cast<std::size_t>(n * nlog_eps / (log_2 * log_2));
+            auto blocks = Storage::fixed_words * 64 / Layout::block_bits;
+
+            if constexpr (Storage::fixed_words == 0)
+            {
+                auto const bits = static_cast<std::size_t>(n * nlog_eps / (log_2 * log_2));
+                // at least one block, so that an empty filter still has somewhere to reduce probes to.
+                blocks = Reducer::size(std::max(bits / Layout::block_bits + (Layout::block_bits > 1 && bits % Layout::block_bits != 0), std::size_t{1}));
+            }
+
+            m = blocks * Layout::block_bits;
             k = static_cast<std::size_t>(nlog_eps / log_2);
+            reduce = Reducer{blocks};
 
-            auto const len = (m >> 6) + ((m & 63) != 0);
-            bits = allocator_type::allocate(len);
-            std::fill_n(bits, len, 0);
+            Storage::allocate(length());
         }
 
         /// @brief The copy constructor.
-        CONST_ALLOC bloom_filter(bloom_filter const &rhs) noexcept
-            : m{rhs.m}, k{rhs.k}
+        CONST_ALLOC basic_bloom(basic_bloom const &rhs)
+            : Hash(rhs),
+              Storage(rhs),
+              Versions(rhs),
+              m{rhs.m},
+              k{rhs.k},
+              reduce{rhs.reduce}
         {
-            auto const len = (m >> 6) + ((m & 63) != 0);
-            bits = allocator_type::allocate(len);
-            std::copy_n(rhs.bits, len, bits);
+            Storage::allocate(length());
+            std::copy_n(rhs.Storage::words(), length(), Storage::words());
         }
 
         /// @brief The copy assignment operator.
-        CONST_ALLOC bloom_filter &operator=(bloom_filter const &rhs) noexcept
+        CONST_ALLOC basic_bloom &operator=(basic_bloom const &rhs)
         {
-            bloom_filter tmp{rhs};
+            basic_bloom tmp{rhs};
             swap(*this, tmp);
 
             return *this;
         }
 
         /// @brief The move constructor.
-        CONST_SWAP bloom_filter(bloom_filter &&rhs) noexcept
+        CONST_SWAP basic_bloom(basic_bloom &&rhs) noexcept
+            : Hash(rhs),
+              Storage(rhs),
+              m{},
+              k{}
         {
             swap(*this, rhs);
         }
 
         /// @brief The move assignment operator.
-        CONST_SWAP bloom_filter &operator=(bloom_filter &&rhs) noexcept
+        CONST_SWAP basic_bloom &operator=(basic_bloom &&rhs) noexcept
         {
             swap(*this, rhs);
             return *this;
         }
 
         /// @brief The destructor.
-        CONST_ALLOC ~bloom_filter() noexcept
+        CONST_ALLOC ~basic_bloom() noexcept
         {
-            auto const len = (m >> 6) + ((m & 63) != 0);
-            allocator_type::deallocate(bits, len);
+            Storage::deallocate(length());
         }
 
         /// @brief Add the value into the filter.
         constexpr void insert(T const &value) noexcept
         {
-            auto const hash = static_cast<Hash const &>(*this)(value);
-            auto const step = hash & utils::size_traits::low_mask;
+            insert_hash(static_cast<Hash const &>(*this)(value));
+        }
 
-            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+        /// @brief Add a value into the filter, given its hash computed with `hash_function()`.
+        constexpr void insert_hash(std::size_t hash) noexcept
+        {
+            auto const words = Storage::words();
 
-            // strategy based on
-            // https://github.com/Claudenw/BloomFilters/wiki/Bloom-Filters----An-overview
-            for (std::size_t i{}; i < k; ++i)
+            Layout::probe(
+                hash, k, reduce,
+                [words](std::size_t word, std::uint64_t mask)
+                {
+                    Storage::set(words + word, mask);
+                    return true;
+                });
+
+            // only counted once its bits are set, or a cache could keep a negative result under the new version.
+            Versions::template inserted<Storage::concurrent>(1);
+        }
+
+        /// @brief Add a range of values into the filter, with the same result as inserting them one by one.
+        /// The values are hashed in batches that go through `insert_hashes`.
+        template <typename It>
+        inline void insert(It first, It last) noexcept
+        {
+            std::size_t hashes[utils::bloom_batch];
+
+            while (first != last)
             {
-                h += i * step;
+                std::size_t n{};
+
+                for (; first != last && n < utils::bloom_batch; ++first)
+                    hashes[n++] = static_cast<Hash const &>(*this)(*first);
+
+                insert_hashes(hashes, n);
+            }
+        }
+
+        /// @brief Add many values into the filter, given their hashes computed with `hash_function()`, with the same result as `insert_hash` on each of them.
+        /// With AVX-512 (and AVX-512CD), the classic layout with an exact modulo computes the probes of 8 values at once and writes them with a single scatter, after the masks of lanes that hit the same word are combined.
+        /// Otherwise, the probes of a batch of values are computed and prefetched before any of them is written, so that their cache misses overlap.
+        /// @param hashes The hashes of the values.
+        /// @param n The number of values.
+        inline void insert_hashes(std::size_t const *hashes, std::size_t n) noexcept
+        {
+            auto const words = Storage::words();
+
+            std::size_t i{};
+
+#if defined(__AVX512F__) && defined(__AVX512CD__)
+            if constexpr (sizeof(std::size_t) == 8 && std::is_same_v<Layout, classic_layout> && std::is_same_v<Reducer, modulo_reducer> && !Storage::concurrent)
+            {
+                auto const low_mask = _mm512_set1_epi64(static_cast<long long>(utils::size_traits::low_mask));
+                auto const one = _mm512_set1_epi64(1);
+                auto const lane_bits = _mm512_set1_epi64(63);
+                auto const scattered = reinterpret_cast<long long *>(words);
+
+                // the words and masks of the probes of a batch, 8 lanes at a time.
+                alignas(64) std::uint64_t batch_words[utils::bloom_batch];
+                alignas(64) std::uint64_t batch_masks[utils::bloom_batch];
 
-                auto const index = h % m;
-                bits[index >> 6] |= std::size_t{1} << (index & 63);
+                auto const per_batch = k ? utils::bloom_batch / k / 8 * 8 : 0;
+
+                while (per_batch && i + 8 <= n)
+                {
+                    std::size_t count{};
+
+                    for (auto const end = i + (std::min)(per_batch, (n - i) / 8 * 8); i < end; i += 8)
+                    {
+                        auto const hash = _mm512_loadu_si512(hashes + i);
+                        auto const step = _mm512_and_si512(hash, low_mask);
+
+                        auto h = _mm512_srli_epi64(hash, utils::size_traits::high_shift);
+                        auto offset = _mm512_setzero_si512();
+
+                        for (std::size_t probe{}; probe < k; ++probe, count += 8)
+                        {
+                            // `h += probe * step`, with the product kept as a running sum.
+                            h = _mm512_add_epi64(h, offset);
+                            offset = _mm512_add_epi64(offset, step);
+
+                            auto const index = reduce.mod(h);
+                            auto const word = _mm512_srli_epi64(index, 6);
+                            auto const mask = _mm512_sllv_epi64(one, _mm512_and_si512(index, lane_bits));
+
+                            // each lane ORs in the masks of the lower lanes that hit the same word, so the highest of them holds all the bits.
+                            auto combined = mask;
+                            auto conflicts = _mm512_conflict_epi64(word);
+                            auto pending = _mm512_test_epi64_mask(conflicts, conflicts);
+
+                            while (pending)
+                            {
+                                auto const lane = _mm512_sub_epi64(lane_bits, _mm512_lzcnt_epi64(conflicts));
+
+                                combined = _mm512_mask_or_epi64(combined, pending, combined, _mm512_permutexvar_epi64(lane, mask));
+                                conflicts = _mm512_mask_andnot_epi64(conflicts, pending, _mm512_sllv_epi64(one, lane), conflicts);
+                                pending = _mm512_test_epi64_mask(conflicts, conflicts);
+                            }
+
+                            _mm512_store_si512(batch_words + count, word);
+                            _mm512_store_si512(batch_masks + count, combined);
+
+                            for (std::size_t lane{}; lane < 8; ++lane)
+                                utils::prefetch(words + batch_words[count + lane]);
+                        }
+                    }
+
+                    // overlapping lanes of a scatter are written from the lowest to the highest, so the complete mask is written last.
+                    for (std::size_t j{}; j < count; j += 8)
+                    {
+                        auto const word = _mm512_load_si512(batch_words + j);
+                        auto const old = _mm512_i64gather_epi64(word, scattered, 8);
+
+                        _mm512_i64scatter_epi64(scattered, word, _mm512_or_si512(old, _mm512_load_si512(batch_masks + j)), 8);
+                    }
+                }
             }
+#endif
+
+            // the probes of a batch are computed and prefetched first, so that their cache misses overlap, then written.
+            std::size_t batch_words[utils::bloom_batch];
+            std::uint64_t batch_masks[utils::bloom_batch];
+            auto const per_batch = k ? utils::bloom_batch / k : 0;
+
+            while (per_batch && i < n)
+            {
+                std::size_t count{};
+
+                for (auto const end = n - i < per_batch ? n : i + per_batch; i < end; ++i)
+                {
+                    Layout::probe(
+                        hashes[i], k, reduce,
+                        [&](std::size_t word, std::uint64_t mask)
+                        {
+                            batch_words[count] = word;
+                            batch_masks[count++] = mask;
+                            utils::prefetch(words + word);
+                            return true;
+                        });
+                }
+
+                for (std::size_t j{}; j < count; ++j)
+                    Storage::set(words + batch_words[j], batch_masks[j]);
+            }
+
+            Versions::template inserted<Storage::concurrent>(n);
         }
 
         /// @brief Check whether the given value *might* be present in the bloom filter. While this function can return false positives, it will never return false negatives.
@@ -191,20 +840,40 @@ namespace tnt
                     utils::is_hashable_with<U, Hash>::value,
                 "This type is not hashable with the given hash function!");
 
-            auto const hash = static_cast<Hash const &>(*this)(value);
-            auto const step = hash & utils::size_traits::low_mask;
+            return matches_hash(static_cast<Hash const &>(*this)(value));
+        }
 
-            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+        /// @brief Check whether the given value *might* be present in the bloom filter.
+        /// @param value The value to check.
+        /// @note This function is deprecated in favor of `matches`.
+        template <typename U>
+        [[deprecated("Use `matches` instead")]] constexpr bool contains(U &&value) const noexcept
+        {
+            return matches(static_cast<U &&>(value));
+        }
 
-            bool found{true};
+        /// @brief Check whether a value *might* be present in the bloom filter, given its hash computed with `hash_function()`.
+        constexpr bool matches_hash(std::size_t hash) const noexcept
+        {
+            auto const words = Storage::words();
 
-            for (std::size_t i{}; i < k; ++i)
-            {
-                h += i * step;
+            bool found{true};
 
-                auto const index = h % m;
-                found = found && (bits[index >> 6] & (std::size_t{1} << (index & 63))) != 0;
-            }
+            Layout::probe(
+                hash, k, reduce,
+                [words, &found](std::size_t word, std::uint64_t mask)
+                {
+                    if constexpr (Probe::early_exit)
+                    {
+                        found = (Storage::load(words + word) & mask) != 0;
+                        return found;
+                    }
+                    else
+                    {
+                        found &= (Storage::load(words + word) & mask) != 0;
+                        return true;
+                    }
+                });
 
             return found;
         }
@@ -212,25 +881,128 @@ namespace tnt
         /// @brief Remove all elements from the filter.
         constexpr void clear() noexcept
         {
-            auto const len = (m >> 6) + ((m & 63) != 0);
-            std::fill_n(bits, len, 0);
+            Storage::clear(length());
+
+            Versions::template cleared<Storage::concurrent>();
+        }
+
+        /// @brief Clear the filter and resize it to a new size.
+        /// @param n The new size of the filter.
+        /// @param eps The desired false positive rate, between 0 and 1. Defaults to 0.01 (1 %).
+        [[deprecated("Use the constructor instead")]] void clear_and_resize(std::size_t n, float eps = 0.01f)
+        {
+            basic_bloom tmp{n, eps, hash_function(), Storage::get_allocator()};
+            swap(*this, tmp);
+        }
+
+        /// @brief The hash function used by the filter.
+        constexpr Hash const &hash_function() const noexcept
+        {
+            return *this;
+        }
+
+        /// @brief A counter that changes whenever an element is inserted. A value that did not match keeps not matching as long as the version stays the same.
+        /// Only available with the `versioned` policy.
+        inline std::size_t version() const noexcept
+        {
+            return Versions::version();
+        }
+
+        /// @brief A counter that changes whenever the filter is cleared. A value that matched keeps matching as long as the generation stays the same.
+        /// Only available with the `versioned` policy.
+        inline std::size_t generation() const noexcept
+        {
+            return Versions::generation();
+        }
+
+        /// @brief Count the set bits of the filter over `buckets` regions of equal size, to spot saturated regions. See `bloom_histogram::skew`.
+        /// Regions are rounded up to whole 64-bit words, so there might be fewer regions than requested.
+        /// The filter is read once from start to end, so it can run from another thread alongside `matches`, but not alongside `insert` or `clear`.
+        /// @param buckets The number of regions. Defaults to 64.
+        inline bloom_histogram fill_histogram(std::size_t buckets = 64) const
+        {
+            auto const len = length();
+
+            buckets = buckets == 0 ? 1 : (buckets < len ? buckets : (len ? len : 1));
+
+            auto const region_words = len / buckets + (len % buckets != 0);
+
+            bloom_histogram histogram{{}, region_words * 64, m};
+            histogram.counts.reserve(buckets);
+
+            for (std::size_t i{}; i < len; i += region_words)
+                histogram.counts.push_back(utils::popcount(Storage::words() + i, region_words < len - i ? region_words : len - i));
+
+            return histogram;
         }
 
         /// @brief Swap the contents of two filters together.
-        friend CONST_SWAP void swap(bloom_filter &lhs, bloom_filter &rhs) noexcept
+        friend CONST_SWAP void swap(basic_bloom &lhs, basic_bloom &rhs) noexcept
         {
-            std::swap(lhs.m, rhs.m);
-            std::swap(lhs.k, rhs.k);
-            std::swap(lhs.bits, rhs.bits);
-            std::swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+            using std::swap;
+
+            // the hash may have a state, eg. a seed, that goes with the bits.
+            swap(static_cast<Hash &>(lhs), static_cast<Hash &>(rhs));
+
+            // bit-fields cannot bind to references, so they are swapped through copies.
+            std::size_t const m = lhs.m;
+            std::size_t const k = lhs.k;
+
+            lhs.m = rhs.m;
+            lhs.k = rhs.k;
+            rhs.m = m;
+            rhs.k = k;
+
+            std::swap(lhs.reduce, rhs.reduce);
+            swap(static_cast<Versions &>(lhs), static_cast<Versions &>(rhs));
+            swap(static_cast<Storage &>(lhs), static_cast<Storage &>(rhs));
         }
 
     private:
+        // overlays probe the bits of their base directly, and fold their delta into a copy of it.
+        template <typename, typename, typename>
+        friend class overlay_bloom;
+
+        // resizable filters rebuild a new filter from several threads at once.
+        template <typename, typename, typename>
+        friend class resizable_bloom;
+
+        // hybrid filters count the memory of their bloom segments.
+        template <typename, typename>
+        friend class hybrid_int_filter;
+
+        // the number of 64-bit words of the filter.
+        constexpr std::size_t length() const noexcept
+        {
+            return (m >> 6) + ((m & 63) != 0);
+        }
+
         std::size_t m : sizeof(std::size_t) * 8 - 8;
         std::size_t k : 8;
-        std::uint64_t *bits;
+        Reducer reduce;
     };
 
+    /// @brief A bloom filter is a space-efficient probabilistic data structure that is used to test whether an element might be a member of a set.
+    /// This is the classic layout, with an exact modulo and memory from an allocator. See `tnt::basic_bloom` for other combinations.
+    /// @tparam T The type of the elements to be inserted into the bloom filter.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    using bloom_filter = basic_bloom<T, Hash, classic_layout, modulo_reducer, early_exit_probe, allocator_storage<Alloc>>;
+
+    /// @brief A `tnt::bloom_filter` that also counts insertions and clears, as `tnt::bloom_cache` needs. See `tnt::versioned`.
+    /// @tparam T The type of the elements to be inserted into the bloom filter.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    using versioned_bloom = basic_bloom<T, Hash, classic_layout, modulo_reducer, early_exit_probe, allocator_storage<Alloc>, versioned>;
+
     namespace pmr
     {
         /// @brief Specialization of bloom_filter using a polymorphic allocator.
@@ -240,5 +1012,13 @@ namespace tnt
         using bloom_filter = tnt::bloom_filter<
             T, Hash,
             std::pmr::polymorphic_allocator<std::uint64_t>>;
+
+        /// @brief Specialization of versioned_bloom using a polymorphic allocator.
+        /// @tparam T The type of the elements to be inserted into the bloom filter.
+        /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+        template <typename T, typename Hash = std::hash<T>>
+        using versioned_bloom = tnt::versioned_bloom<
+            T, Hash,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,325 @@
+
+#pragma once
+
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "bloom_filter.hpp"
+
+#if defined(__cpp_constexpr_dynamic_alloc) && (__cpp_constexpr_dynamic_alloc >= 201907L)
+#define CONST_ALLOC constexpr
+#else
+#define CONST_ALLOC inline
+#endif
+
+#if defined(__cpp_lib_constexpr_algorithms) && (__cpp_lib_constexpr_algorithms >= 202306L)
+#define CONST_SWAP constexpr
+#else
+#define CONST_SWAP inline
+#endif
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    template <std::size_t Bits>
+    struct uint_for final
+    {
+        static_assert(Bits <= 32, "At most 32 bits are supported!");
+
+        using type = std::conditional_t<
+            (Bits <= 8), std::uint8_t,
+            std::conditional_t<(Bits <= 16), std::uint16_t, std::uint32_t>>;
+    };
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief A static retrieval structure (Bloomier filter) that maps each key of a fixed set to a small value, built in bulk.
+    /// It is implemented as a ribbon retrieval structure (Dillinger and Walzer): each key owns a window of 64 consecutive slots and a random
+    /// 64-bit row, and its value is the XOR of the slots selected by the row. A lookup is a single read of one contiguous 64-slot window,
+    /// instead of one query per set when keeping a bloom filter per value. The structure uses about `1.1 * (ValueBits + FingerprintBits)` bits per key.
+    /// Looking up a key that was not in the set returns an arbitrary value, unless fingerprints are stored to detect it.
+    /// @tparam T The type of the keys.
+    /// @tparam ValueBits The number of bits of each value. Defaults to 8.
+    /// @tparam FingerprintBits The number of fingerprint bits stored along with each value, used to reject keys that are not in the set
+    /// with a false positive rate of `2^-FingerprintBits`. Defaults to 0, ie. no membership test.
+    /// @tparam Hash The hash function to be used for hashing the keys. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        std::size_t ValueBits = 8,
+        std::size_t FingerprintBits = 0,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class bloomier_filter final
+        : private Hash,
+          private std::allocator_traits<Alloc>::template rebind_alloc<typename utils::uint_for<ValueBits + FingerprintBits>::type>
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        static_assert(ValueBits > 0, "Values must be at least one bit wide!");
+
+        using slot_type = typename utils::uint_for<ValueBits + FingerprintBits>::type;
+        using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<slot_type>;
+
+        inline static constexpr std::size_t window = 64;
+        inline static constexpr std::uint64_t value_mask = (std::uint64_t{1} << ValueBits) - 1;
+        inline static constexpr std::uint64_t fingerprint_mask = (std::uint64_t{1} << FingerprintBits) - 1;
+
+    public:
+        /// @brief The type of the values stored for each key.
+        using value_type = typename utils::uint_for<ValueBits>::type;
+
+        /// @brief Build the structure from a range of key-value pairs, such as a `std::map` or a `std::vector<std::pair<T, V>>`.
+        /// Only the lowest `ValueBits` bits of each value are kept. The same key may appear more than once, as long as it is always mapped to the same value.
+        /// @param first The beginning of the range of pairs.
+        /// @param last The end of the range of pairs.
+        /// @param hash The hash function to be used for hashing the keys.
+        /// @param alloc The allocator to be used for memory management.
+        /// @throw std::invalid_argument if the same key is mapped to different values (keys with the same hash count as the same key),
+        /// or if no seed gives a solvable system, which is very unlikely for a good hash function.
+        template <typename It>
+        bloomier_filter(
+            It first, It last,
+            Hash const &hash = Hash{},
+            allocator_type const &alloc = allocator_type{})
+            : Hash(hash),
+              allocator_type(alloc)
+        {
+            std::vector<std::pair<std::uint64_t, std::uint64_t>> keys;
+
+            for (; first != last; ++first)
+                keys.emplace_back(static_cast<Hash const &>(*this)(first->first), static_cast<std::uint64_t>(first->second) & value_mask);
+
+            // repeated keys would make the system unsolvable if their values differ, so they are told apart from a bad seed first.
+            std::sort(keys.begin(), keys.end());
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+            for (std::size_t i{1}; i < keys.size(); ++i)
+            {
+                if (keys[i].first == keys[i - 1].first)
+                    throw std::invalid_argument{"The same key is mapped to different values!"};
+            }
+
+            // the banded system is solvable with high probability given a few percent of extra slots.
+            // if it is not, retry with another seed and some more room.
+            for (std::size_t attempt{}; attempt < 8; ++attempt)
+            {
+                seed = utils::mix64(attempt + 1);
+                slots = keys.size() + keys.size() * (8 + 4 * attempt) / 100 + window;
+
+                if (build(keys))
+                    return;
+            }
+
+            throw std::invalid_argument{"Cannot build the filter: no seed gives a solvable system!"};
+        }
+
+        /// @brief The copy constructor.
+        CONST_ALLOC bloomier_filter(bloomier_filter const &rhs)
+            : Hash(rhs),
+              allocator_type(rhs),
+              slots{rhs.slots}, seed{rhs.seed}
+        {
+            solution = allocator_type::allocate(slots);
+            std::copy_n(rhs.solution, slots, solution);
+        }
+
+        /// @brief The copy assignment operator.
+        CONST_ALLOC bloomier_filter &operator=(bloomier_filter const &rhs)
+        {
+            bloomier_filter tmp{rhs};
+            swap(*this, tmp);
+
+            return *this;
+        }
+
+        /// @brief The move constructor.
+        CONST_SWAP bloomier_filter(bloomier_filter &&rhs) noexcept
+            : Hash(rhs),
+              allocator_type(rhs)
+        {
+            swap(*this, rhs);
+        }
+
+        /// @brief The move assignment operator.
+        CONST_SWAP bloomier_filter &operator=(bloomier_filter &&rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        /// @brief The destructor.
+        CONST_ALLOC ~bloomier_filter() noexcept
+        {
+            if (solution)
+                allocator_type::deallocate(solution, slots);
+        }
+
+        /// @brief Retrieve the value of a key of the set. The result is arbitrary for keys outside of the set.
+        /// @param key The key to look up.
+        template <typename U>
+        value_type lookup(U &&key) const noexcept
+        {
+            return static_cast<value_type>(retrieve(hash_of(key)) & value_mask);
+        }
+
+        /// @brief Retrieve the value of a key, if it *might* be part of the set. Keys outside of the set are rejected, except for a fraction of `2^-FingerprintBits` of them.
+        /// @param key The key to look up.
+        /// @return The value of the key, or an empty optional if the key is not part of the set.
+        template <typename U>
+        std::optional<value_type> find(U &&key) const noexcept
+        {
+            static_assert(FingerprintBits > 0, "Membership queries need FingerprintBits > 0!");
+
+            auto const h = hash_of(key);
+            auto const slot = retrieve(h);
+
+            if ((slot >> ValueBits) != fingerprint(h))
+                return std::nullopt;
+
+            return static_cast<value_type>(slot & value_mask);
+        }
+
+        /// @brief Check whether the given key *might* be part of the set. While this function can return false positives, it will never return false negatives.
+        /// @param key The key to check.
+        template <typename U>
+        bool matches(U &&key) const noexcept
+        {
+            return find(static_cast<U &&>(key)).has_value();
+        }
+
+        /// @brief Swap the contents of two structures together.
+        friend CONST_SWAP void swap(bloomier_filter &lhs, bloomier_filter &rhs) noexcept
+        {
+            std::swap(static_cast<Hash &>(lhs), static_cast<Hash &>(rhs));
+            std::swap(lhs.slots, rhs.slots);
+            std::swap(lhs.seed, rhs.seed);
+            std::swap(lhs.solution, rhs.solution);
+            std::swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+        }
+
+    private:
+        template <typename U>
+        std::uint64_t hash_of(U const &key) const noexcept
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            return static_cast<Hash const &>(*this)(key);
+        }
+
+        // the start of the window of a key, taken from the high half of the remixed hash.
+        std::size_t start(std::uint64_t h) const noexcept
+        {
+            return static_cast<std::size_t>(((utils::mix64(h ^ seed) >> 32) * (slots - window + 1)) >> 32);
+        }
+
+        // the row of a key inside its window. The lowest bit is always set, so the key "owns" the first slot of its window.
+        std::uint64_t row(std::uint64_t h) const noexcept
+        {
+            return utils::mix64(h + seed) | 1;
+        }
+
+        std::uint64_t fingerprint(std::uint64_t h) const noexcept
+        {
+            return utils::mix64(h ^ ~seed) & fingerprint_mask;
+        }
+
+        std::uint64_t retrieve(std::uint64_t h) const noexcept
+        {
+            auto const window_start = solution + start(h);
+
+            std::uint64_t result{};
+
+            for (auto r = row(h); r; r &= r - 1)
+                result ^= window_start[utils::countr_zero(r)];
+
+            return result;
+        }
+
+        // on-the-fly gaussian elimination of the banded system, followed by back substitution.
+        bool build(std::vector<std::pair<std::uint64_t, std::uint64_t>> const &keys)
+        {
+            std::vector<std::uint64_t> coefficients(slots);
+            std::vector<std::uint64_t> results(slots);
+
+            struct equation final
+            {
+                std::size_t start;
+                std::uint64_t row;
+                std::uint64_t result;
+            };
+
+            std::vector<equation> equations;
+            equations.reserve(keys.size());
+
+            for (auto const &[h, value] : keys)
+                equations.push_back({start(h), row(h), value | (fingerprint(h) << ValueBits)});
+
+            // inserting in the order of the windows keeps the elimination cache friendly.
+            std::sort(equations.begin(), equations.end(), [](equation const &lhs, equation const &rhs)
+                      { return lhs.start < rhs.start; });
+
+            for (auto [i, c, r] : equations)
+            {
+                while (true)
+                {
+                    if (coefficients[i] == 0)
+                    {
+                        coefficients[i] = c;
+                        results[i] = r;
+                        break;
+                    }
+
+                    c ^= coefficients[i];
+                    r ^= results[i];
+
+                    // the equation is a combination of the previous ones. If the results disagree, the system has no solution.
+                    if (c == 0)
+                    {
+                        if (r != 0)
+                            return false;
+
+                        break;
+                    }
+
+                    auto const shift = utils::countr_zero(c);
+                    c >>= shift;
+                    i += shift;
+                }
+            }
+
+            solution = allocator_type::allocate(slots);
+
+            for (auto i = slots; i-- > 0;)
+            {
+                auto value = results[i];
+
+                for (auto c = coefficients[i] & ~std::uint64_t{1}; c; c &= c - 1)
+                    value ^= solution[i + utils::countr_zero(c)];
+
+                solution[i] = static_cast<slot_type>(value);
+            }
+
+            return true;
+        }
+
+        std::size_t slots{};
+        std::uint64_t seed{};
+        slot_type *solution{};
+    };
+}
+
+#undef CONST_ALLOC
+#undef CONST_SWAP
@@ -0,0 +1,304 @@
+
+#pragma once
+
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "bloom_filter.hpp"
+#include "string_hash.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // rows are hashed this many at a time, one column after the other, so that the words of a column stay in the cache.
+    inline constexpr std::size_t composite_chunk = 256;
+
+    template <typename C>
+    struct is_composite_column
+        : std::bool_constant<std::is_arithmetic_v<C> || std::is_enum_v<C> || std::is_convertible_v<C const &, std::string_view>>
+    {
+    };
+
+    // the word a column contributes to the hash of a row: numbers are mixed, strings are hashed with `string_hash` first.
+    // the steps that combine the columns are close to linear for small words, so small numbers would otherwise give rows with the same hash, eg. (16, 402, 3) and (25, 402, 28).
+    template <typename C>
+    inline std::uint64_t column_word(C const &value) noexcept
+    {
+        if constexpr (std::is_enum_v<C>)
+            return mix64(static_cast<std::uint64_t>(static_cast<std::underlying_type_t<C>>(value)));
+        else if constexpr (std::is_integral_v<C>)
+            return mix64(static_cast<std::uint64_t>(value));
+        else if constexpr (std::is_floating_point_v<C>)
+        {
+            // 0.0 and -0.0 compare equal, so they must hash the same.
+            double const d = value == 0 ? 0.0 : static_cast<double>(value);
+
+            std::uint64_t w;
+            std::memcpy(&w, &d, sizeof(w));
+            return mix64(w);
+        }
+        else
+        {
+            std::string_view const s{value};
+            return string_hash_impl::hash(s.data(), s.size());
+        }
+    }
+
+    template <typename C>
+    inline void column_words(C const *values, std::size_t n, std::uint64_t *out) noexcept
+    {
+        if constexpr (std::is_convertible_v<C const &, std::string_view> && !std::is_arithmetic_v<C>)
+        {
+            string_hash_impl::batch(
+                n,
+                [values](std::size_t i)
+                { return std::string_view{values[i]}.data(); },
+                [values](std::size_t i)
+                { return std::string_view{values[i]}.size(); },
+                out);
+        }
+        else
+        {
+            for (std::size_t i{}; i < n; ++i)
+                out[i] = column_word(values[i]);
+        }
+    }
+
+    // `acc[i] = string_hash_impl::step(acc[i], words[i], key)` for every row, several rows at once.
+    inline void combine_column(std::uint64_t *acc, std::uint64_t const *words, std::size_t n, std::uint64_t key) noexcept
+    {
+        std::size_t i{};
+
+#if defined(__AVX512F__)
+        auto const vkey = _mm512_set1_epi64(static_cast<long long>(key));
+
+        for (; i + 8 <= n; i += 8)
+        {
+            auto const a = _mm512_loadu_si512(acc + i);
+            auto const w = _mm512_loadu_si512(words + i);
+            auto const x = _mm512_xor_si512(w, vkey);
+            auto const product = _mm512_mul_epu32(x, _mm512_srli_epi64(x, 32));
+
+            _mm512_storeu_si512(acc + i, _mm512_add_epi64(_mm512_add_epi64(_mm512_xor_si512(a, _mm512_srli_epi64(a, 29)), w), product));
+        }
+#elif defined(__AVX2__)
+        auto const vkey = _mm256_set1_epi64x(static_cast<long long>(key));
+
+        for (; i + 4 <= n; i += 4)
+        {
+            auto const a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(acc + i));
+            auto const w = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(words + i));
+            auto const x = _mm256_xor_si256(w, vkey);
+            auto const product = _mm256_mul_epu32(x, _mm256_srli_epi64(x, 32));
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_add_epi64(_mm256_add_epi64(_mm256_xor_si256(a, _mm256_srli_epi64(a, 29)), w), product));
+        }
+#endif
+
+        for (; i < n; ++i)
+            acc[i] = string_hash_impl::step(acc[i], words[i], key);
+    }
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief A hash function for rows made of several columns, eg. `(tenant_id, user_id, day)`, that hashes the columns directly instead of a struct holding them.
+    /// Numbers are mixed and strings are hashed with `tnt::string_hash`, then the columns are combined with the same steps `tnt::string_hash` uses for the words of a string.
+    /// Hashing many rows at once, given one array per column, goes through the columns one at a time and combines several rows at once across SIMD lanes (AVX2 or AVX-512 when enabled at compile time).
+    /// Single and batched hashing give the same hashes.
+    /// @tparam Columns The types of the columns. Each must be an arithmetic type, an enumeration, or convertible to `std::string_view`.
+    template <typename... Columns>
+    struct composite_hash
+    {
+        static_assert(sizeof...(Columns) > 0, "A composite key needs at least one column!");
+        static_assert((utils::is_composite_column<Columns>::value && ...), "Columns must be numbers, enumerations or strings!");
+
+        /// @brief Hash a single row, given its columns.
+        inline std::size_t operator()(Columns const &...columns) const noexcept
+        {
+            auto acc = utils::string_hash_impl::init(sizeof...(Columns));
+            std::size_t column{};
+
+            ((acc = utils::string_hash_impl::step(acc, utils::column_word(columns), utils::string_hash_impl::key(column++))), ...);
+
+            return static_cast<std::size_t>(utils::mix64(acc));
+        }
+
+        /// @brief Hash a single row, given as a tuple.
+        inline std::size_t operator()(std::tuple<Columns...> const &row) const noexcept
+        {
+            return std::apply(
+                [this](Columns const &...columns)
+                { return (*this)(columns...); },
+                row);
+        }
+
+        /// @brief Hash many rows at once.
+        /// @param n The number of rows.
+        /// @param out Where to write the hashes, must have room for `n` values.
+        /// @param columns One array of `n` values per column.
+        inline void batch(std::size_t n, std::uint64_t *out, Columns const *...columns) const noexcept
+        {
+            std::uint64_t words[utils::composite_chunk];
+
+            for (std::size_t first{}; first < n; first += utils::composite_chunk)
+            {
+                auto const rows = n - first < utils::composite_chunk ? n - first : utils::composite_chunk;
+                auto const acc = out + first;
+                std::size_t column{};
+
+                std::fill_n(acc, rows, utils::string_hash_impl::init(sizeof...(Columns)));
+
+                ((utils::column_words(columns + first, rows, words),
+                  utils::combine_column(acc, words, rows, utils::string_hash_impl::key(column++))),
+                 ...);
+
+                for (std::size_t i{}; i < rows; ++i)
+                    acc[i] = utils::mix64(acc[i]);
+            }
+        }
+    };
+
+    /// @brief A bloom filter for rows made of several columns, that are inserted and checked without building a struct for each row.
+    /// Rows can be given one at a time, as `insert(tenant, user, day)`, or as one array per column, in which case they are hashed in batches by `tnt::composite_hash` and probed directly.
+    /// @tparam Alloc The allocator to be used for memory management.
+    /// @tparam Columns The types of the columns. Each must be an arithmetic type, an enumeration, or convertible to `std::string_view`.
+    template <typename Alloc, typename... Columns>
+    class basic_composite_bloom final
+    {
+        using allocator_type = typename utils::deduce_allocator<Alloc>::type;
+
+    public:
+        /// @brief The type of the hash function of the filter.
+        using hash_type = composite_hash<Columns...>;
+
+        /// @brief The type of the underlying filter, which can also be queried with `std::tuple`s of the columns.
+        using filter_type = bloom_filter<std::tuple<Columns...>, hash_type, Alloc>;
+
+        /// @brief Construct a new instance of the filter, given the number of rows and the desired false positive rate.
+        /// @param n The number of rows to be inserted into the filter.
+        /// @param eps The desired false positive rate. Defaults to 0.01 (1% false positives).
+        /// @param alloc The allocator to be used for memory management.
+        inline basic_composite_bloom(
+            std::size_t n,
+            float eps = 0.01f,
+            allocator_type const &alloc = allocator_type{})
+            : bloom{n, eps, hash_type{}, alloc}
+        {
+        }
+
+        /// @brief Add a row into the filter, given its columns.
+        inline void insert(Columns const &...columns) noexcept
+        {
+            bloom.insert_hash(hash_function()(columns...));
+        }
+
+        /// @brief Add many rows into the filter, given one array per column, with the same result as inserting them one by one.
+        /// @param n The number of rows.
+        /// @param columns One array of `n` values per column.
+        inline void insert_columns(std::size_t n, Columns const *...columns) noexcept
+        {
+            std::uint64_t hashes[utils::composite_chunk];
+
+            for (std::size_t first{}; first < n; first += utils::composite_chunk)
+            {
+                auto const rows = n - first < utils::composite_chunk ? n - first : utils::composite_chunk;
+
+                hash_function().batch(rows, hashes, (columns + first)...);
+
+                if constexpr (std::is_same_v<std::size_t, std::uint64_t>)
+                    bloom.insert_hashes(hashes, rows);
+                else
+                {
+                    for (std::size_t i{}; i < rows; ++i)
+                        bloom.insert_hash(static_cast<std::size_t>(hashes[i]));
+                }
+            }
+        }
+
+        /// @brief Check whether a row *might* be present in the filter, given its columns.
+        inline bool matches(Columns const &...columns) const noexcept
+        {
+            return bloom.matches_hash(hash_function()(columns...));
+        }
+
+        /// @brief Check many rows at once, given one array per column.
+        /// @param n The number of rows.
+        /// @param out Where to write whether each row might be present, must have room for `n` values.
+        /// @param columns One array of `n` values per column.
+        /// @return The number of rows that might be present.
+        inline std::size_t matches_columns(std::size_t n, bool *out, Columns const *...columns) const noexcept
+        {
+            std::uint64_t hashes[utils::composite_chunk];
+            std::size_t count{};
+
+            for (std::size_t first{}; first < n; first += utils::composite_chunk)
+            {
+                auto const rows = n - first < utils::composite_chunk ? n - first : utils::composite_chunk;
+
+                hash_function().batch(rows, hashes, (columns + first)...);
+
+                for (std::size_t i{}; i < rows; ++i)
+                {
+                    auto const found = bloom.matches_hash(static_cast<std::size_t>(hashes[i]));
+
+                    out[first + i] = found;
+                    count += found;
+                }
+            }
+
+            return count;
+        }
+
+        /// @brief Remove all rows from the filter.
+        inline void clear() noexcept
+        {
+            bloom.clear();
+        }
+
+        /// @brief The underlying filter.
+        inline filter_type const &filter() const noexcept
+        {
+            return bloom;
+        }
+
+        /// @brief The hash function used by the filter.
+        inline hash_type const &hash_function() const noexcept
+        {
+            return bloom.hash_function();
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend inline void swap(basic_composite_bloom &lhs, basic_composite_bloom &rhs) noexcept
+        {
+            swap(lhs.bloom, rhs.bloom);
+        }
+
+    private:
+        filter_type bloom;
+    };
+
+    /// @brief A bloom filter for rows made of several columns, using std::allocator. See `tnt::basic_composite_bloom`.
+    /// @tparam Columns The types of the columns.
+    template <typename... Columns>
+    using composite_bloom = basic_composite_bloom<std::allocator<std::uint64_t>, Columns...>;
+
+    namespace pmr
+    {
+        /// @brief Specialization of composite_bloom using a polymorphic allocator.
+        /// @tparam Columns The types of the columns.
+        template <typename... Columns>
+        using composite_bloom = tnt::basic_composite_bloom<
+            std::pmr::polymorphic_allocator<std::uint64_t>,
+            Columns...>;
+    }
+}
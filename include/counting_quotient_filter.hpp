@@ -0,0 +1,853 @@
+
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "bloom_filter.hpp"
+
+#if defined(__cpp_constexpr_dynamic_alloc) && (__cpp_constexpr_dynamic_alloc >= 201907L)
+#define CONST_ALLOC constexpr
+#else
+#define CONST_ALLOC inline
+#endif
+
+#if defined(__cpp_lib_constexpr_algorithms) && (__cpp_lib_constexpr_algorithms >= 202306L)
+#define CONST_SWAP constexpr
+#else
+#define CONST_SWAP inline
+#endif
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // 64 slots of a rank-and-select quotient filter. `offset` is the distance from the first slot of the block
+    // to the end of the run of the last occupied quotient before it (plus one, or zero if that run ends before the block).
+    template <typename Remainder>
+    struct cqf_block final
+    {
+        inline static constexpr std::size_t slots = 64;
+
+        std::uint64_t occupieds;
+        std::uint64_t runends;
+        std::uint64_t offset;
+        Remainder remainders[slots];
+    };
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief A counting quotient filter (Pandey et al.) counts how many times each element was inserted, and supports removal, merging and resizing.
+    /// Elements are stored as fingerprints split into a quotient, which selects a slot, and a remainder stored in the slot.
+    /// Remainders of the same quotient form a sorted run, found with rank and select on two bit vectors.
+    /// Counts are encoded in place, in the slots following the remainder, so that an element inserted once takes one slot
+    /// and an element inserted `c` times takes about `3 + log(c)` slots, which suits skewed frequencies.
+    /// The capacity of the filter is given in slots: a distinct element takes one slot, or two if inserted twice, and about `3 + log(c)` slots beyond that.
+    /// With 8-bit remainders the false positive rate is below 0.4% at full load.
+    /// The filter can be written to and read back from a flat buffer (eg. a memory-mapped file), see `serialize`.
+    /// @tparam T The type of the elements to be inserted into the filter.
+    /// @tparam Remainder The unsigned type used to store remainders. Defaults to std::uint8_t.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        typename Remainder = std::uint8_t,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class counting_quotient_filter final
+        : private Hash,
+          private std::allocator_traits<Alloc>::template rebind_alloc<utils::cqf_block<Remainder>>
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        static_assert(
+            std::is_unsigned_v<Remainder> && sizeof(Remainder) <= 4,
+            "Remainders must be stored in an unsigned integer type of at most 32 bits!");
+
+        using block = utils::cqf_block<Remainder>;
+        using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<block>;
+
+        // slot positions are signed, so that "before the first slot" can be represented.
+        using position = std::ptrdiff_t;
+        using entry = std::pair<std::uint64_t, std::uint64_t>;
+
+        inline static constexpr std::size_t width = sizeof(Remainder) * 8;
+
+        // "TNTCQF1", followed by the remainder width, the quotient bits, the remainder bits and the used slots.
+        inline static constexpr std::uint64_t magic = 0x0031'4651'4354'4e54;
+        inline static constexpr std::size_t header_words = 5;
+
+        struct layout final
+        {
+        };
+
+    public:
+        /// @brief Construct a new instance of the filter, given the number of slots its elements need.
+        /// @param n The number of slots needed, ie. the number of distinct elements if few of them are inserted more than twice.
+        /// @param hash The hash function to be used for hashing the elements.
+        /// @param alloc The allocator to be used for memory management.
+        explicit counting_quotient_filter(
+            std::size_t n,
+            Hash const &hash = Hash{},
+            allocator_type const &alloc = allocator_type{})
+            : counting_quotient_filter(layout{}, quotient_bits_for(n), width, hash, alloc)
+        {
+        }
+
+        /// @brief Load a filter from a buffer filled by `serialize`. The buffer is only read during construction.
+        /// @param data The beginning of the buffer.
+        /// @param size The size of the buffer, in bytes.
+        /// @param hash The hash function to be used for hashing the elements. It must be the one used by the serialized filter.
+        /// @param alloc The allocator to be used for memory management.
+        /// @throw std::invalid_argument if the buffer does not hold a filter with the same `Remainder` type.
+        counting_quotient_filter(
+            void const *data,
+            std::size_t size,
+            Hash const &hash = Hash{},
+            allocator_type const &alloc = allocator_type{})
+            : Hash(hash),
+              allocator_type(alloc)
+        {
+            std::uint64_t header[header_words]{};
+
+            if (size >= sizeof(header))
+                std::memcpy(header, data, sizeof(header));
+
+            if (header[0] != magic || header[1] != width || header[2] < 6 || header[2] + header[3] > 64 || header[3] < 2 || header[3] > width)
+                throw std::invalid_argument{"The buffer does not hold a counting quotient filter of this type!"};
+
+            quotient_bits = static_cast<std::size_t>(header[2]);
+            remainder_bits = static_cast<std::size_t>(header[3]);
+            used = static_cast<std::size_t>(header[4]);
+            block_count = blocks_for(quotient_bits);
+
+            if (size != serialized_size())
+                throw std::invalid_argument{"The buffer does not hold a counting quotient filter of this type!"};
+
+            blocks = allocator_type::allocate(block_count);
+            std::memcpy(blocks, static_cast<unsigned char const *>(data) + sizeof(header), block_count * sizeof(block));
+        }
+
+        /// @brief The copy constructor.
+        CONST_ALLOC counting_quotient_filter(counting_quotient_filter const &rhs)
+            : Hash(rhs),
+              allocator_type(rhs),
+              quotient_bits{rhs.quotient_bits},
+              remainder_bits{rhs.remainder_bits},
+              used{rhs.used},
+              block_count{rhs.block_count}
+        {
+            blocks = allocator_type::allocate(block_count);
+            std::copy_n(rhs.blocks, block_count, blocks);
+        }
+
+        /// @brief The copy assignment operator.
+        CONST_ALLOC counting_quotient_filter &operator=(counting_quotient_filter const &rhs)
+        {
+            counting_quotient_filter tmp{rhs};
+            swap(*this, tmp);
+
+            return *this;
+        }
+
+        /// @brief The move constructor.
+        CONST_SWAP counting_quotient_filter(counting_quotient_filter &&rhs) noexcept
+            : Hash(rhs),
+              allocator_type(rhs)
+        {
+            swap(*this, rhs);
+        }
+
+        /// @brief The move assignment operator.
+        CONST_SWAP counting_quotient_filter &operator=(counting_quotient_filter &&rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        /// @brief The destructor.
+        CONST_ALLOC ~counting_quotient_filter() noexcept
+        {
+            if (blocks)
+                allocator_type::deallocate(blocks, block_count);
+        }
+
+        /// @brief Add the value into the filter.
+        /// @param value The value to insert.
+        /// @param times How many occurrences of the value to add. Defaults to 1.
+        /// @return `false` if the filter is full, in which case it is left unchanged. Use `resize` to make room.
+        bool insert(T const &value, std::uint64_t times = 1)
+        {
+            if (times == 0)
+                return true;
+
+            auto const [q, r] = locate(value);
+            auto run = read_run(q);
+
+            auto const it = std::lower_bound(run.begin(), run.end(), entry{r, 0});
+
+            if (it != run.end() && it->first == r)
+                it->second += times;
+            else
+                run.insert(it, entry{r, times});
+
+            return rewrite(q, run);
+        }
+
+        /// @brief Remove occurrences of the value from the filter. Only erase values that were inserted, as erasing a false positive removes another value.
+        /// @param value The value to remove.
+        /// @param times How many occurrences of the value to remove. Defaults to 1.
+        /// @return `true` if the fingerprint of the value was found.
+        template <typename U>
+        bool erase(U &&value, std::uint64_t times = 1)
+        {
+            auto const [q, r] = locate(value);
+            auto run = read_run(q);
+
+            auto const it = std::lower_bound(run.begin(), run.end(), entry{r, 0});
+
+            if (it == run.end() || it->first != r)
+                return false;
+
+            if (it->second <= times)
+                run.erase(it);
+            else
+                it->second -= times;
+
+            // removing a run or shortening a counter never needs more room.
+            rewrite(q, run);
+            return true;
+        }
+
+        /// @brief Estimate how many times the value was inserted. The estimate is never lower than the real count,
+        /// and only higher if another value shares the same fingerprint.
+        /// @param value The value to count.
+        template <typename U>
+        std::uint64_t count(U &&value) const
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            auto const [q, r] = locate(value);
+
+            for (auto const &[remainder, times] : read_run(q))
+            {
+                if (remainder == r)
+                    return times;
+            }
+
+            return 0;
+        }
+
+        /// @brief Check whether the given value *might* be present in the filter. While this function can return false positives, it will never return false negatives.
+        /// @param value The value to check.
+        template <typename U>
+        bool matches(U &&value) const
+        {
+            return count(static_cast<U &&>(value)) != 0;
+        }
+
+        /// @brief Add all the elements of another filter, with their counts, in a single sequential pass over both filters.
+        /// Both filters must use the same hash function and the same number of fingerprint bits, ie. they were created for
+        /// the same number of elements, or one was resized from a filter of the other's size.
+        /// @param rhs The filter to merge into this one.
+        /// @return `false` if the fingerprints are not compatible or the result does not fit, in which case this filter is left unchanged.
+        bool merge(counting_quotient_filter const &rhs)
+        {
+            if (quotient_bits + remainder_bits != rhs.quotient_bits + rhs.remainder_bits)
+                return false;
+
+            counting_quotient_filter tmp{layout{}, quotient_bits, remainder_bits, *this, *this};
+
+            cursor lhs_it{*this};
+            cursor rhs_it{rhs};
+
+            auto const filled = tmp.fill([&](std::uint64_t &fp, std::uint64_t &times)
+                                         {
+                                             if (lhs_it.done() && rhs_it.done())
+                                                 return false;
+
+                                             if (rhs_it.done() || (!lhs_it.done() && lhs_it.fingerprint() < rhs_it.fingerprint()))
+                                             {
+                                                 fp = lhs_it.fingerprint();
+                                                 times = lhs_it.count();
+                                                 lhs_it.next();
+                                             }
+                                             else if (lhs_it.done() || rhs_it.fingerprint() < lhs_it.fingerprint())
+                                             {
+                                                 fp = rhs_it.fingerprint();
+                                                 times = rhs_it.count();
+                                                 rhs_it.next();
+                                             }
+                                             else
+                                             {
+                                                 fp = lhs_it.fingerprint();
+                                                 times = lhs_it.count() + rhs_it.count();
+                                                 lhs_it.next();
+                                                 rhs_it.next();
+                                             }
+
+                                             return true; });
+
+            if (filled)
+                swap(*this, tmp);
+
+            return filled;
+        }
+
+        /// @brief Change the number of slots of the filter, keeping its elements. Each doubling of the slots moves one bit of the
+        /// fingerprint from the remainder to the quotient, so the false positive rate at full load stays the same, but the filter can only grow
+        /// while at least 2 remainder bits are left. Shrinking the filter moves the bits back.
+        /// @param n The number of slots the filter should hold.
+        /// @return `false` if the elements do not fit, or the new size needs less than 2 or more than `sizeof(Remainder) * 8` remainder bits.
+        /// The filter is left unchanged in that case.
+        bool resize(std::size_t n)
+        {
+            auto const q = quotient_bits_for(n);
+            auto const fingerprint_bits = quotient_bits + remainder_bits;
+
+            if (fingerprint_bits < q + 2 || fingerprint_bits > q + width)
+                return false;
+
+            counting_quotient_filter tmp{layout{}, q, fingerprint_bits - q, *this, *this};
+
+            cursor it{*this};
+
+            auto const filled = tmp.fill([&](std::uint64_t &fp, std::uint64_t &times)
+                                         {
+                                             if (it.done())
+                                                 return false;
+
+                                             fp = it.fingerprint();
+                                             times = it.count();
+                                             it.next();
+
+                                             return true; });
+
+            if (filled)
+                swap(*this, tmp);
+
+            return filled;
+        }
+
+        /// @brief Remove all elements from the filter.
+        CONST_ALLOC void clear() noexcept
+        {
+            std::fill_n(blocks, block_count, block{});
+            used = 0;
+        }
+
+        /// @brief The number of bytes written by `serialize`.
+        std::size_t serialized_size() const noexcept
+        {
+            return header_words * sizeof(std::uint64_t) + block_count * sizeof(block);
+        }
+
+        /// @brief Write the filter into a flat buffer of `serialized_size()` bytes: a fixed header of 5 64-bit words followed by the blocks of the filter,
+        /// in native byte order. The buffer has no pointers, so it can be written to a file and memory-mapped later.
+        /// @param out The beginning of the buffer.
+        void serialize(void *out) const noexcept
+        {
+            std::uint64_t const header[header_words]{magic, width, quotient_bits, remainder_bits, used};
+
+            std::memcpy(out, header, sizeof(header));
+            std::memcpy(static_cast<unsigned char *>(out) + sizeof(header), blocks, block_count * sizeof(block));
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend CONST_SWAP void swap(counting_quotient_filter &lhs, counting_quotient_filter &rhs) noexcept
+        {
+            std::swap(static_cast<Hash &>(lhs), static_cast<Hash &>(rhs));
+            std::swap(lhs.quotient_bits, rhs.quotient_bits);
+            std::swap(lhs.remainder_bits, rhs.remainder_bits);
+            std::swap(lhs.used, rhs.used);
+            std::swap(lhs.block_count, rhs.block_count);
+            std::swap(lhs.blocks, rhs.blocks);
+            std::swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+        }
+
+    private:
+        // walks the entries of a filter, sorted by fingerprint, one run at a time.
+        struct cursor final
+        {
+            explicit cursor(counting_quotient_filter const &filter)
+                : filter{filter},
+                  quotient{filter.next_occupied(0)}
+            {
+                load();
+            }
+
+            bool done() const noexcept
+            {
+                return quotient >= filter.slots();
+            }
+
+            std::uint64_t fingerprint() const noexcept
+            {
+                return (std::uint64_t{quotient} << filter.remainder_bits) | run[index].first;
+            }
+
+            std::uint64_t count() const noexcept
+            {
+                return run[index].second;
+            }
+
+            void next()
+            {
+                if (++index == run.size())
+                {
+                    quotient = filter.next_occupied(quotient + 1);
+                    load();
+                }
+            }
+
+        private:
+            void load()
+            {
+                if (done())
+                    return;
+
+                auto const start = std::max(static_cast<position>(quotient), last + 1);
+                last = filter.select_after(last, 1);
+
+                run = filter.decode(start, last);
+                index = 0;
+            }
+
+            counting_quotient_filter const &filter;
+            std::size_t quotient;
+            position last{-1};
+            std::vector<entry> run;
+            std::size_t index{};
+        };
+
+        counting_quotient_filter(
+            layout,
+            std::size_t quotient_bits,
+            std::size_t remainder_bits,
+            Hash const &hash,
+            allocator_type const &alloc)
+            : Hash(hash),
+              allocator_type(alloc),
+              quotient_bits{quotient_bits},
+              remainder_bits{remainder_bits},
+              block_count{blocks_for(quotient_bits)}
+        {
+            blocks = allocator_type::allocate(block_count);
+            clear();
+        }
+
+        // about 95% load at full capacity.
+        static std::size_t quotient_bits_for(std::size_t n) noexcept
+        {
+            std::size_t q{6};
+
+            while ((std::size_t{1} << q) / 20 * 19 < n)
+                ++q;
+
+            return q;
+        }
+
+        // runs of the last quotients spill past the end of the table, so some slack is kept there.
+        static std::size_t blocks_for(std::size_t quotient_bits) noexcept
+        {
+            auto const slots = std::size_t{1} << quotient_bits;
+            return slots / block::slots + static_cast<std::size_t>(10 * std::sqrt(static_cast<double>(slots))) / block::slots + 1;
+        }
+
+        std::size_t slots() const noexcept
+        {
+            return std::size_t{1} << quotient_bits;
+        }
+
+        std::uint64_t base() const noexcept
+        {
+            return (std::uint64_t{1} << remainder_bits) - 1;
+        }
+
+        template <typename U>
+        std::pair<std::size_t, std::uint64_t> locate(U const &value) const noexcept
+        {
+            auto const h = utils::mix64(static_cast<Hash const &>(*this)(value));
+            auto const fp = h >> (64 - quotient_bits - remainder_bits);
+
+            return {static_cast<std::size_t>(fp >> remainder_bits), fp & base()};
+        }
+
+        Remainder &slot(position p) noexcept
+        {
+            return blocks[static_cast<std::size_t>(p) / block::slots].remainders[static_cast<std::size_t>(p) % block::slots];
+        }
+
+        Remainder slot(position p) const noexcept
+        {
+            return blocks[static_cast<std::size_t>(p) / block::slots].remainders[static_cast<std::size_t>(p) % block::slots];
+        }
+
+        bool occupied(std::size_t q) const noexcept
+        {
+            return (blocks[q / block::slots].occupieds >> (q % block::slots)) & 1;
+        }
+
+        // the first occupied quotient at or after `q`, or `slots()` if there is none.
+        std::size_t next_occupied(std::size_t q) const noexcept
+        {
+            auto const end = slots();
+
+            if (q >= end)
+                return end;
+
+            auto i = q / block::slots;
+            auto word = blocks[i].occupieds & (~std::uint64_t{} << (q % block::slots));
+
+            while (!word)
+            {
+                if (++i * block::slots >= end)
+                    return end;
+
+                word = blocks[i].occupieds;
+            }
+
+            return i * block::slots + utils::countr_zero(word);
+        }
+
+        // the position of the `rank`-th runend (starting at 1) after `p`.
+        position select_after(position p, std::size_t rank) const noexcept
+        {
+            auto const from = static_cast<std::size_t>(p + 1);
+            auto i = from / block::slots;
+
+            if (i >= block_count)
+                return static_cast<position>(block_count * block::slots);
+
+            auto word = blocks[i].runends & (~std::uint64_t{} << (from % block::slots));
+
+            while (true)
+            {
+                if (auto const found = utils::popcount(word); rank <= found)
+                    return static_cast<position>(i * block::slots + utils::select64(word, rank - 1));
+                else
+                    rank -= found;
+
+                if (++i == block_count)
+                    return static_cast<position>(block_count * block::slots);
+
+                word = blocks[i].runends;
+            }
+        }
+
+        // the end of the run of the last occupied quotient at or before `x`. If that run ends before the block of `x`, any position before the block is returned.
+        position run_end(std::size_t x) const noexcept
+        {
+            auto const i = x / block::slots;
+            auto const bit = x % block::slots;
+
+            auto const p = static_cast<position>(i * block::slots + blocks[i].offset) - 1;
+            auto const mask = (bit == 63 ? ~std::uint64_t{} : (std::uint64_t{1} << (bit + 1)) - 1) & ~std::uint64_t{1};
+            auto const rank = utils::popcount(blocks[i].occupieds & mask);
+
+            return rank ? select_after(p, rank) : p;
+        }
+
+        void update_offsets(std::size_t first, std::size_t last) noexcept
+        {
+            for (auto i = first; i <= last && i < block_count; ++i)
+            {
+                position end{-1};
+
+                if (i == 0)
+                {
+                    if (blocks[0].occupieds & 1)
+                        end = select_after(-1, 1);
+                }
+                else
+                {
+                    auto const p = static_cast<position>((i - 1) * block::slots + blocks[i - 1].offset) - 1;
+                    auto const rank = utils::popcount(blocks[i - 1].occupieds >> 1) + (blocks[i].occupieds & 1);
+
+                    end = rank ? select_after(p, rank) : p;
+                }
+
+                auto const offset = end - static_cast<position>(i * block::slots) + 1;
+                blocks[i].offset = offset > 0 ? static_cast<std::uint64_t>(offset) : 0;
+            }
+        }
+
+        std::vector<entry> read_run(std::size_t q) const
+        {
+            if (!occupied(q))
+                return {};
+
+            auto const prev = q == 0 ? position{-1} : run_end(q - 1);
+            auto const start = std::max(static_cast<position>(q), prev + 1);
+
+            return decode(start, select_after(start - 1, 1));
+        }
+
+        // Counter encoding, for a remainder x inserted c times:
+        // - c == 1: x
+        // - c == 2: x x
+        // - c > 2, x > 0: x d... x, where the digits d encode c - 3 in base 2^r - 1, skipping the symbol x. The first digit is less than x
+        //   (a leading 0 is added if needed), which breaks the ascending order of the run and marks the counter.
+        // - c > 2, x == 0: 0 0 0 d... 0, where the digits encode c - 3 with symbols 1 to 2^r - 1, and are omitted for c == 3.
+        std::vector<entry> decode(position first, position last) const
+        {
+            std::vector<entry> run;
+
+            for (auto i = first; i <= last;)
+            {
+                std::uint64_t const x = slot(i);
+                std::uint64_t value{};
+
+                if (x == 0)
+                {
+                    if (i + 2 <= last && slot(i + 1) == 0 && slot(i + 2) == 0)
+                    {
+                        for (i += 3; slot(i) != 0; ++i)
+                            value = value * base() + (slot(i) - 1);
+
+                        run.emplace_back(x, value + 3);
+                        i += 1;
+                    }
+                    else if (i + 1 <= last && slot(i + 1) == 0)
+                    {
+                        run.emplace_back(x, 2);
+                        i += 2;
+                    }
+                    else
+                    {
+                        run.emplace_back(x, 1);
+                        i += 1;
+                    }
+                }
+                else if (i + 1 <= last && slot(i + 1) == x)
+                {
+                    run.emplace_back(x, 2);
+                    i += 2;
+                }
+                else if (i + 1 <= last && slot(i + 1) < x)
+                {
+                    for (i += 1; slot(i) != x; ++i)
+                        value = value * base() + (slot(i) < x ? slot(i) : slot(i) - 1);
+
+                    run.emplace_back(x, value + 3);
+                    i += 1;
+                }
+                else
+                {
+                    run.emplace_back(x, 1);
+                    i += 1;
+                }
+            }
+
+            return run;
+        }
+
+        std::vector<Remainder> encode(std::vector<entry> const &run) const
+        {
+            std::vector<Remainder> out;
+            std::vector<std::uint64_t> digits;
+
+            for (auto const &[x, c] : run)
+            {
+                auto const r = static_cast<Remainder>(x);
+
+                if (c <= 2)
+                {
+                    out.insert(out.end(), static_cast<std::size_t>(c), r);
+                    continue;
+                }
+
+                digits.clear();
+
+                for (auto value = c - 3; value; value /= base())
+                    digits.push_back(value % base());
+
+                if (x == 0)
+                {
+                    out.insert(out.end(), 3, Remainder{});
+
+                    for (auto it = digits.rbegin(); it != digits.rend(); ++it)
+                        out.push_back(static_cast<Remainder>(*it + 1));
+
+                    out.push_back(Remainder{});
+                }
+                else
+                {
+                    if (digits.empty())
+                        digits.push_back(0);
+
+                    out.push_back(r);
+
+                    if (auto const msd = digits.back(); (msd < x ? msd : msd + 1) > x)
+                        out.push_back(Remainder{});
+
+                    for (auto it = digits.rbegin(); it != digits.rend(); ++it)
+                        out.push_back(static_cast<Remainder>(*it < x ? *it : *it + 1));
+
+                    out.push_back(r);
+                }
+            }
+
+            return out;
+        }
+
+        // replace the run of `q0`, shifting the following runs of its cluster as needed.
+        bool rewrite(std::size_t q0, std::vector<entry> const &run)
+        {
+            auto const was_occupied = occupied(q0);
+            auto const prev_end = q0 == 0 ? position{-1} : run_end(q0 - 1);
+            auto const first = std::max(static_cast<position>(q0), prev_end + 1);
+
+            std::vector<std::pair<position, std::vector<Remainder>>> moved;
+
+            auto old_last = was_occupied ? select_after(first - 1, 1) : prev_end;
+            auto new_last = prev_end;
+
+            auto const old_size = static_cast<std::size_t>(old_last - (first - 1));
+            std::size_t new_size{};
+
+            if (!run.empty())
+            {
+                moved.emplace_back(first, encode(run));
+                new_size = moved.back().second.size();
+                new_last = first + static_cast<position>(new_size) - 1;
+            }
+
+            if (used - (was_occupied ? old_size : 0) + new_size > slots())
+                return false;
+
+            // the following runs move until one of them lands where it already was.
+            for (auto q = next_occupied(q0 + 1); q < slots(); q = next_occupied(q + 1))
+            {
+                auto const old_start = std::max(static_cast<position>(q), old_last + 1);
+                auto const new_start = std::max(static_cast<position>(q), new_last + 1);
+
+                if (old_start == new_start)
+                    break;
+
+                auto const end = select_after(old_last, 1);
+
+                std::vector<Remainder> slots_of_run;
+                for (auto i = old_start; i <= end; ++i)
+                    slots_of_run.push_back(slot(i));
+
+                moved.emplace_back(new_start, std::move(slots_of_run));
+
+                old_last = end;
+                new_last = new_start + (end - old_start);
+            }
+
+            if (new_last >= static_cast<position>(block_count * block::slots))
+                return false;
+
+            for (auto i = first; i <= old_last; ++i)
+                blocks[static_cast<std::size_t>(i) / block::slots].runends &= ~(std::uint64_t{1} << (i % block::slots));
+
+            for (auto const &[start, content] : moved)
+            {
+                for (std::size_t i{}; i < content.size(); ++i)
+                    slot(start + static_cast<position>(i)) = content[i];
+
+                auto const end = static_cast<std::size_t>(start) + content.size() - 1;
+                blocks[end / block::slots].runends |= std::uint64_t{1} << (end % block::slots);
+            }
+
+            if (run.empty())
+                blocks[q0 / block::slots].occupieds &= ~(std::uint64_t{1} << (q0 % block::slots));
+            else
+                blocks[q0 / block::slots].occupieds |= std::uint64_t{1} << (q0 % block::slots);
+
+            used = used - (was_occupied ? old_size : 0) + new_size;
+
+            auto const touched = static_cast<std::size_t>(std::max({old_last, new_last, static_cast<position>(q0)}));
+            update_offsets((q0 + block::slots - 1) / block::slots, touched / block::slots + 1);
+
+            return true;
+        }
+
+        // fill an empty filter from entries sorted by fingerprint. `next(fp, times)` returns `false` at the end of the entries.
+        template <typename Next>
+        bool fill(Next &&next)
+        {
+            std::vector<entry> run;
+            std::size_t run_quotient{};
+            position last{-1};
+
+            auto const append = [&]
+            {
+                auto const content = encode(run);
+                auto const start = std::max(static_cast<position>(run_quotient), last + 1);
+
+                if (start + static_cast<position>(content.size()) > static_cast<position>(block_count * block::slots))
+                    return false;
+
+                for (std::size_t i{}; i < content.size(); ++i)
+                    slot(start + static_cast<position>(i)) = content[i];
+
+                last = start + static_cast<position>(content.size()) - 1;
+                used += content.size();
+
+                blocks[run_quotient / block::slots].occupieds |= std::uint64_t{1} << (run_quotient % block::slots);
+                blocks[static_cast<std::size_t>(last) / block::slots].runends |= std::uint64_t{1} << (last % block::slots);
+
+                run.clear();
+                return true;
+            };
+
+            std::uint64_t fp{};
+            std::uint64_t times{};
+
+            while (next(fp, times))
+            {
+                auto const q = static_cast<std::size_t>(fp >> remainder_bits);
+
+                if (!run.empty() && q != run_quotient && !append())
+                    return false;
+
+                run_quotient = q;
+                run.emplace_back(fp & base(), times);
+            }
+
+            if (!run.empty() && !append())
+                return false;
+
+            if (used > slots())
+                return false;
+
+            update_offsets(0, block_count - 1);
+            return true;
+        }
+
+        std::size_t quotient_bits{};
+        std::size_t remainder_bits{};
+        std::size_t used{};
+        std::size_t block_count{};
+        block *blocks{};
+    };
+
+    namespace pmr
+    {
+        /// @brief Specialization of counting_quotient_filter using a polymorphic allocator.
+        /// @tparam T The type of the elements to be inserted into the filter.
+        /// @tparam Remainder The unsigned type used to store remainders. Defaults to std::uint8_t.
+        /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+        template <typename T, typename Remainder = std::uint8_t, typename Hash = std::hash<T>>
+        using counting_quotient_filter = tnt::counting_quotient_filter<
+            T, Remainder, Hash,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
+    }
+}
+
+#undef CONST_ALLOC
+#undef CONST_SWAP
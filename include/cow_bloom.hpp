@@ -0,0 +1,482 @@
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "bloom_filter.hpp"
+
+#if defined(__linux__) && __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(MFD_CLOEXEC)
+#define TNT_COW_MEMFD 1
+#endif
+#endif
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // A zeroed array of words that can be copied without copying its contents.
+    // The contents live in a memfd that is never written to while more than one copy maps it. Each copy maps it `MAP_PRIVATE`,
+    // so the kernel duplicates a page only when a copy writes to it, and copies remember which pages they wrote to (the dirty pages),
+    // since those are the only ones that differ from the memfd. Without memfd, the words are allocated on the heap and copied as a whole.
+    class cow_storage final
+    {
+#if defined(TNT_COW_MEMFD)
+        struct memfd final
+        {
+            int fd;
+
+            ~memfd() noexcept
+            {
+                ::close(fd);
+            }
+        };
+#endif
+
+    public:
+        inline explicit cow_storage(std::size_t words)
+            : len{words}
+        {
+#if defined(TNT_COW_MEMFD)
+            auto const page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+
+            page_words = page / sizeof(std::uint64_t);
+            bytes = (len * sizeof(std::uint64_t) + page - 1) / page * page;
+            bytes = bytes ? bytes : page;
+
+            // the memfd starts filled with zeros, which no page of memory has to hold until it is written to.
+            if (auto const fd = ::memfd_create("tnt::cow_bloom", MFD_CLOEXEC); fd != -1)
+            {
+                file.reset(new memfd{fd});
+
+                if (::ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+                {
+                    if (auto const addr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0); addr != MAP_FAILED)
+                    {
+                        words_ = static_cast<std::uint64_t *>(addr);
+                        dirty.assign((pages() + 63) / 64, 0);
+
+                        return;
+                    }
+                }
+
+                file.reset();
+            }
+#endif
+
+            words_ = new std::uint64_t[len ? len : 1]{};
+        }
+
+        inline cow_storage(cow_storage const &rhs)
+            : len{rhs.len}
+        {
+#if defined(TNT_COW_MEMFD)
+            // the heap fallback still reports its size in pages.
+            page_words = rhs.page_words;
+            bytes = rhs.bytes;
+
+            if (rhs.file)
+            {
+                auto const addr = ::mmap(nullptr, rhs.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, rhs.file->fd, 0);
+
+                if (addr == MAP_FAILED)
+                    throw std::bad_alloc{};
+
+                file = rhs.file;
+                words_ = static_cast<std::uint64_t *>(addr);
+                dirty = rhs.dirty;
+
+                // only the pages that `rhs` wrote to differ from the memfd.
+                for_each_dirty_run(
+                    [this, &rhs](std::size_t first, std::size_t count)
+                    { std::memcpy(words_ + first * page_words, rhs.words_ + first * page_words, count * page_words * sizeof(std::uint64_t)); });
+
+                return;
+            }
+#endif
+
+            words_ = new std::uint64_t[len ? len : 1];
+            std::copy_n(rhs.words_, len, words_);
+        }
+
+        inline cow_storage(cow_storage &&rhs) noexcept
+        {
+            swap(*this, rhs);
+        }
+
+        inline cow_storage &operator=(cow_storage rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        inline ~cow_storage() noexcept
+        {
+#if defined(TNT_COW_MEMFD)
+            if (file)
+            {
+                ::munmap(words_, bytes);
+                return;
+            }
+#endif
+
+            delete[] words_;
+        }
+
+        inline std::uint64_t *words() const noexcept
+        {
+            return words_;
+        }
+
+        inline std::size_t size() const noexcept
+        {
+            return len;
+        }
+
+        // remember that the page holding the given word was written to.
+        inline void touch(std::size_t word) noexcept
+        {
+#if defined(TNT_COW_MEMFD)
+            if (file)
+            {
+                auto const page = word / page_words;
+                dirty[page >> 6] |= std::uint64_t{1} << (page & 63);
+            }
+#else
+            (void)word;
+#endif
+        }
+
+        // the number of pages a copy made now would have to copy.
+        inline std::size_t dirty_pages() const noexcept
+        {
+#if defined(TNT_COW_MEMFD)
+            if (file)
+                return popcount(dirty.data(), dirty.size());
+
+            // a moved-from storage has no pages at all.
+            return page_words ? (len + page_words - 1) / page_words : 0;
+#else
+            return (len * sizeof(std::uint64_t) + 4095) / 4096;
+#endif
+        }
+
+        // if no other copy maps the memfd, write the dirty pages into it and drop their private copies, so that the next copy is free.
+        inline void flush() noexcept
+        {
+#if defined(TNT_COW_MEMFD)
+            if (!file || file.use_count() != 1)
+                return;
+
+            for_each_dirty_run(
+                [this](std::size_t first, std::size_t count)
+                {
+                    auto const page_bytes = page_words * sizeof(std::uint64_t);
+                    auto const from = reinterpret_cast<char const *>(words_ + first * page_words);
+                    auto const size = count * page_bytes;
+
+                    std::size_t written{};
+
+                    while (written < size)
+                    {
+                        auto const n = ::pwrite(file->fd, from + written, size - written, static_cast<off_t>(first * page_bytes + written));
+
+                        if (n <= 0)
+                            return;
+
+                        written += static_cast<std::size_t>(n);
+                    }
+
+                    // the memfd now holds the same contents, so the private pages can be dropped and read back from it.
+                    ::madvise(words_ + first * page_words, size, MADV_DONTNEED);
+
+                    for (auto page = first; page < first + count; ++page)
+                        dirty[page >> 6] &= ~(std::uint64_t{1} << (page & 63));
+                });
+#endif
+        }
+
+        friend inline void swap(cow_storage &lhs, cow_storage &rhs) noexcept
+        {
+            std::swap(lhs.len, rhs.len);
+            std::swap(lhs.words_, rhs.words_);
+#if defined(TNT_COW_MEMFD)
+            std::swap(lhs.file, rhs.file);
+            std::swap(lhs.page_words, rhs.page_words);
+            std::swap(lhs.bytes, rhs.bytes);
+            std::swap(lhs.dirty, rhs.dirty);
+#endif
+        }
+
+    private:
+#if defined(TNT_COW_MEMFD)
+        inline std::size_t pages() const noexcept
+        {
+            return bytes / (page_words * sizeof(std::uint64_t));
+        }
+
+        // call `f(first, count)` for each run of consecutive dirty pages.
+        template <typename F>
+        inline void for_each_dirty_run(F &&f) const
+        {
+            std::size_t const total = pages();
+
+            for (std::size_t page{}; page < total;)
+            {
+                if (((dirty[page >> 6] >> (page & 63)) & 1) == 0)
+                {
+                    ++page;
+                    continue;
+                }
+
+                auto const first = page;
+
+                while (page < total && ((dirty[page >> 6] >> (page & 63)) & 1) != 0)
+                    ++page;
+
+                f(first, page - first);
+            }
+        }
+
+        std::shared_ptr<memfd> file;
+        std::size_t page_words{};
+        std::size_t bytes{};
+        std::vector<std::uint64_t> dirty;
+#endif
+        std::size_t len{};
+        std::uint64_t *words_{};
+    };
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief A bloom filter whose bit array is shared copy-on-write between the filter and its snapshots, so that taking a consistent snapshot of a large filter
+    /// (eg. to serialize it in the background while insertions go on) does not copy the whole array.
+    /// On Linux, the array is mapped from a memfd: the filter and each snapshot map it privately, so a page is duplicated by the kernel only when one of them writes to it.
+    /// A snapshot is not free though: the pages the filter wrote to since the previous snapshot only exist in its private mapping, so they are written into the memfd
+    /// (or copied into the snapshot), and the filter faults them back in on its next writes. Its cost is thus proportional to `dirty_pages()`, not to the size of the array.
+    /// Elsewhere, or if memfd is not available, snapshots copy the whole array. It uses the same probing and bit layout as `tnt::bloom_filter`.
+    /// @tparam T The type of the elements to be inserted into the filter.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    template <
+        typename T,
+        typename Hash = std::hash<T>>
+    class cow_bloom final
+        : private Hash
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+    public:
+        /// @brief Construct a new instance of the filter, given the number of elements and the desired false positive rate.
+        /// @param n The number of elements to be inserted into the filter.
+        /// @param eps The desired false positive rate. Defaults to 0.01 (1% false positives).
+        /// @param hash The hash function to be used for hashing the elements.
+        inline cow_bloom(
+            std::size_t n,
+            float eps = 0.01f,
+            Hash const &hash = Hash{})
+            : Hash(hash),
+              storage{words_for(n, eps)}
+        {
+            auto const nlog_eps = -std::log(eps);
+            auto const log_2 = 0.6931471805599453f;
+
+            m = std::max(static_cast<std::size_t>(n * nlog_eps / (log_2 * log_2)), std::size_t{1});
+            k = static_cast<std::size_t>(nlog_eps / log_2);
+            mod = utils::fast_modulo{m};
+        }
+
+        /// @brief The copy constructor. It only copies the pages that `rhs` wrote to since its last snapshot, see `snapshot`.
+        /// @throw std::bad_alloc if the array cannot be mapped.
+        cow_bloom(cow_bloom const &) = default;
+
+        /// @brief The copy assignment operator.
+        cow_bloom &operator=(cow_bloom const &) = default;
+
+        /// @brief The move constructor.
+        cow_bloom(cow_bloom &&) noexcept = default;
+
+        /// @brief The move assignment operator.
+        cow_bloom &operator=(cow_bloom &&) noexcept = default;
+
+        /// @brief Take a snapshot of the filter, that keeps matching exactly what the filter matches now, whatever happens to the filter afterwards.
+        /// It costs O(`dirty_pages()`): if no other snapshot of the filter is alive, the pages written since the last snapshot are written into the shared array
+        /// and dropped from the filter, so the snapshot itself maps the array without copying. Otherwise, the snapshot copies these pages.
+        /// Taking snapshots often keeps them cheap. The snapshot can then be read, and destroyed, on another thread while the filter keeps changing.
+        /// @throw std::bad_alloc if the array cannot be mapped.
+        inline cow_bloom snapshot()
+        {
+            storage.flush();
+            return *this;
+        }
+
+        /// @brief Add the value into the filter.
+        inline void insert(T const &value) noexcept
+        {
+            insert_hash(static_cast<Hash const &>(*this)(value));
+        }
+
+        /// @brief Add a value into the filter, given its hash computed with `hash_function()`.
+        inline void insert_hash(std::size_t hash) noexcept
+        {
+            auto const step = hash & utils::size_traits::low_mask;
+
+            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            auto const bits = storage.words();
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+
+                auto const index = mod(h);
+                auto const mask = std::uint64_t{1} << (index & 63);
+
+                // pages are only written to, and thus duplicated, when a bit actually changes.
+                if ((bits[index >> 6] & mask) == 0)
+                {
+                    bits[index >> 6] |= mask;
+                    storage.touch(index >> 6);
+                }
+            }
+
+            ++inserts;
+        }
+
+        /// @brief Check whether the given value *might* be present in the filter. While this function can return false positives, it will never return false negatives.
+        /// Ie. `matches(x)` might be wrong, but `!matches(x)` is always correct.
+        /// @param value The value to check.
+        template <typename U>
+        inline bool matches(U &&value) const noexcept
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            return matches_hash(static_cast<Hash const &>(*this)(value));
+        }
+
+        /// @brief Check whether a value *might* be present in the filter, given its hash computed with `hash_function()`.
+        inline bool matches_hash(std::size_t hash) const noexcept
+        {
+            auto const step = hash & utils::size_traits::low_mask;
+
+            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            auto const bits = storage.words();
+
+            bool found{true};
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+
+                auto const index = mod(h);
+                found = found && (bits[index >> 6] & (std::uint64_t{1} << (index & 63))) != 0;
+            }
+
+            return found;
+        }
+
+        /// @brief Remove all elements from the filter. The filter gets a new zeroed array, so snapshots keep the old one and nothing is copied.
+        /// @throw std::bad_alloc if the new array cannot be allocated.
+        inline void clear()
+        {
+            storage = utils::cow_storage{storage.size()};
+
+            ++clears;
+        }
+
+        /// @brief The hash function used by the filter.
+        inline Hash const &hash_function() const noexcept
+        {
+            return *this;
+        }
+
+        /// @brief A counter that changes whenever an element is inserted. A value that did not match keeps not matching as long as the version stays the same.
+        inline std::size_t version() const noexcept
+        {
+            return inserts;
+        }
+
+        /// @brief A counter that changes whenever the filter is cleared. A value that matched keeps matching as long as the generation stays the same.
+        inline std::size_t generation() const noexcept
+        {
+            return clears;
+        }
+
+        /// @brief The number of pages of the array that the filter holds a private copy of, and that the next copy would have to copy if a snapshot is alive.
+        inline std::size_t dirty_pages() const noexcept
+        {
+            return storage.dirty_pages();
+        }
+
+        /// @brief The bit array of the filter, in the same layout as `tnt::bloom_filter`, eg. to serialize a snapshot.
+        inline void const *data() const noexcept
+        {
+            return storage.words();
+        }
+
+        /// @brief The size of the bit array in bytes.
+        inline std::size_t size() const noexcept
+        {
+            return storage.size() * sizeof(std::uint64_t);
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend inline void swap(cow_bloom &lhs, cow_bloom &rhs) noexcept
+        {
+            using std::swap;
+
+            swap(static_cast<Hash &>(lhs), static_cast<Hash &>(rhs));
+
+            auto const m = lhs.m;
+            auto const k = lhs.k;
+
+            lhs.m = rhs.m;
+            lhs.k = rhs.k;
+            rhs.m = m;
+            rhs.k = k;
+
+            swap(lhs.mod, rhs.mod);
+            swap(lhs.inserts, rhs.inserts);
+            swap(lhs.clears, rhs.clears);
+            swap(lhs.storage, rhs.storage);
+        }
+
+    private:
+        static inline std::size_t words_for(std::size_t n, float eps) noexcept
+        {
+            auto const nlog_eps = -std::log(eps);
+            auto const log_2 = 0.6931471805599453f;
+
+            auto const m = std::max(static_cast<std::size_t>(n * nlog_eps / (log_2 * log_2)), std::size_t{1});
+
+            return (m >> 6) + ((m & 63) != 0);
+        }
+
+        std::size_t m : sizeof(std::size_t) * 8 - 8;
+        std::size_t k : 8;
+        utils::fast_modulo mod;
+        std::size_t inserts{};
+        std::size_t clears{};
+        utils::cow_storage storage;
+    };
+}
+
+#undef TNT_COW_MEMFD
@@ -0,0 +1,270 @@
+
+#pragma once
+
+#include "bloom_filter.hpp"
+
+#if defined(__cpp_constexpr_dynamic_alloc) && (__cpp_constexpr_dynamic_alloc >= 201907L)
+#define CONST_ALLOC constexpr
+#else
+#define CONST_ALLOC inline
+#endif
+
+#if defined(__cpp_lib_constexpr_algorithms) && (__cpp_lib_constexpr_algorithms >= 202306L)
+#define CONST_SWAP constexpr
+#else
+#define CONST_SWAP inline
+#endif
+
+namespace tnt
+{
+    /// @brief A bloom filter that supports (probabilistic) removal of elements, based on the Deletable Bloom Filter by Rothenberg et al.
+    /// The bit array is split into regions, and a small bitmap keeps track of the regions where two insertions set the same bit.
+    /// Bits in collision-free regions can be safely reset, so an element can be erased as long as at least one of its bits lies in such a region.
+    /// The bit array has the same size and layout as `tnt::bloom_filter`, with one extra bit for each region.
+    /// @tparam T The type of the elements to be inserted into the bloom filter.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class deletable_bloom final
+        : private Hash,
+          private utils::deduce_allocator<Alloc>::type
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        using allocator_type = typename utils::deduce_allocator<Alloc>::type;
+
+    public:
+        /// @brief Construct a new instance of the bloom filter, given the number of elements and the desired false positive rate.
+        /// @param n The number of elements to be inserted into the filter.
+        /// @param eps The desired false positive rate. Defaults to 0.01 (1% false positives).
+        /// @param region_bits The number of bits covered by each region, rounded up to a power of two. Defaults to 16 bits, which costs about 6% of extra memory and keeps roughly a third of the elements deletable in a full filter.
+        /// Smaller regions make more elements deletable, at the cost of a bigger collision bitmap.
+        /// @param hash The hash function to be used for hashing the elements.
+        /// @param alloc The allocator to be used for memory management.
+        CONST_ALLOC deletable_bloom(
+            std::size_t n,
+            float eps = 0.01f,
+            std::size_t region_bits = 16,
+            Hash const &hash = Hash{},
+            allocator_type const &alloc = allocator_type{})
+            : Hash(hash),
+              allocator_type(alloc)
+        {
+            auto const nlog_eps = -std::log(eps);
+            auto const log_2 = 0.6931471805599453f;
+
+            m = std::max(static_cast<std::size_t>(n * nlog_eps / (log_2 * log_2)), std::size_t{1});
+            k = static_cast<std::size_t>(nlog_eps / log_2);
+            mod = utils::fast_modulo{m};
+
+            shift = 0;
+            while ((std::size_t{1} << shift) < region_bits)
+                ++shift;
+
+            auto const len = words();
+            bits = allocator_type::allocate(len);
+            std::fill_n(bits, len, 0);
+        }
+
+        /// @brief The copy constructor.
+        CONST_ALLOC deletable_bloom(deletable_bloom const &rhs) noexcept
+            : Hash(rhs),
+              allocator_type(rhs),
+              m{rhs.m}, k{rhs.k}, mod{rhs.mod}, shift{rhs.shift}
+        {
+            auto const len = words();
+            bits = allocator_type::allocate(len);
+            std::copy_n(rhs.bits, len, bits);
+        }
+
+        /// @brief The copy assignment operator.
+        CONST_ALLOC deletable_bloom &operator=(deletable_bloom const &rhs) noexcept
+        {
+            deletable_bloom tmp{rhs};
+            swap(*this, tmp);
+
+            return *this;
+        }
+
+        /// @brief The move constructor.
+        CONST_SWAP deletable_bloom(deletable_bloom &&rhs) noexcept
+            : Hash(rhs),
+              allocator_type(rhs),
+              m{}, k{}, bits{}
+        {
+            swap(*this, rhs);
+        }
+
+        /// @brief The move assignment operator.
+        CONST_SWAP deletable_bloom &operator=(deletable_bloom &&rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        /// @brief The destructor.
+        CONST_ALLOC ~deletable_bloom() noexcept
+        {
+            allocator_type::deallocate(bits, words());
+        }
+
+        /// @brief Add the value into the filter.
+        /// Any bit that was already set by a previous insertion marks its region as a collision region.
+        constexpr void insert(T const &value) noexcept
+        {
+            auto const hash = static_cast<Hash const &>(*this)(value);
+            auto const step = hash & utils::size_traits::low_mask;
+
+            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            auto const collisions = bits + bit_words();
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+
+                auto const index = mod(h);
+                auto const mask = std::size_t{1} << (index & 63);
+
+                if (bits[index >> 6] & mask)
+                {
+                    auto const region = index >> shift;
+                    collisions[region >> 6] |= std::size_t{1} << (region & 63);
+                }
+
+                bits[index >> 6] |= mask;
+            }
+        }
+
+        /// @brief Try to remove the value from the filter. Only the bits that lie in collision-free regions are reset.
+        /// @param value The value to remove.
+        /// @return `true` if the value was removed, `false` if it was not present or all of its bits lie in collision regions.
+        /// @note Erasing a value that was never inserted but happens to match (a false positive) will remove other values as well. Only erase values that are known to be present.
+        template <typename U>
+        constexpr bool erase(U &&value) noexcept
+        {
+            if (!matches(value))
+                return false;
+
+            auto const hash = static_cast<Hash const &>(*this)(value);
+            auto const step = hash & utils::size_traits::low_mask;
+
+            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            auto const collisions = bits + bit_words();
+
+            bool erased{false};
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+
+                auto const index = mod(h);
+                auto const region = index >> shift;
+
+                if ((collisions[region >> 6] & (std::size_t{1} << (region & 63))) == 0)
+                {
+                    bits[index >> 6] &= ~(std::size_t{1} << (index & 63));
+                    erased = true;
+                }
+            }
+
+            return erased;
+        }
+
+        /// @brief Check whether the given value *might* be present in the bloom filter. While this function can return false positives, it will never return false negatives.
+        /// Ie. `matches(x)` might be wrong, but `!matches(x)` is always correct, as long as only inserted values have been erased.
+        /// @param value The value to check.
+        template <typename U>
+        constexpr bool matches(U &&value) const noexcept
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            auto const hash = static_cast<Hash const &>(*this)(value);
+            auto const step = hash & utils::size_traits::low_mask;
+
+            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            bool found{true};
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+
+                auto const index = mod(h);
+                found = found && (bits[index >> 6] & (std::size_t{1} << (index & 63))) != 0;
+            }
+
+            return found;
+        }
+
+        /// @brief Remove all elements from the filter, and reset all the regions to collision-free.
+        constexpr void clear() noexcept
+        {
+            std::fill_n(bits, words(), 0);
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend CONST_SWAP void swap(deletable_bloom &lhs, deletable_bloom &rhs) noexcept
+        {
+            std::swap(static_cast<Hash &>(lhs), static_cast<Hash &>(rhs));
+
+            // bit-fields cannot bind to references, so they are swapped through copies.
+            std::size_t const m = lhs.m;
+            std::size_t const k = lhs.k;
+
+            lhs.m = rhs.m;
+            lhs.k = rhs.k;
+            rhs.m = m;
+            rhs.k = k;
+
+            std::swap(lhs.mod, rhs.mod);
+            std::swap(lhs.shift, rhs.shift);
+            std::swap(lhs.bits, rhs.bits);
+            std::swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+        }
+
+    private:
+        constexpr std::size_t bit_words() const noexcept
+        {
+            return (m >> 6) + ((m & 63) != 0);
+        }
+
+        // the collision bitmap lives right after the bit array, in the same allocation.
+        constexpr std::size_t words() const noexcept
+        {
+            auto const regions = (m >> shift) + ((m & ((std::size_t{1} << shift) - 1)) != 0);
+            return bit_words() + (regions >> 6) + ((regions & 63) != 0);
+        }
+
+        std::size_t m : sizeof(std::size_t) * 8 - 8;
+        std::size_t k : 8;
+        utils::fast_modulo mod;
+        std::size_t shift{};
+        std::uint64_t *bits;
+    };
+
+    namespace pmr
+    {
+        /// @brief Specialization of deletable_bloom using a polymorphic allocator.
+        /// @tparam T The type of the elements to be inserted into the bloom filter.
+        /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+        template <typename T, typename Hash = std::hash<T>>
+        using deletable_bloom = tnt::deletable_bloom<
+            T, Hash,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
+    }
+}
+
+#undef CONST_ALLOC
+#undef CONST_SWAP
@@ -0,0 +1,260 @@
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+#include "internal/utils.hpp"
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // the counters of the threads that share a slot, on a cache line of their own.
+    struct alignas(64) fpr_slot final
+    {
+        std::atomic<std::uint64_t> negatives{};
+        std::atomic<std::uint64_t> positives{};
+        std::atomic<std::uint64_t> sampled{};
+        std::atomic<std::uint64_t> false_positives{};
+
+        // the number of answers and of reports of this slot, never decayed, added to the shared clocks in batches.
+        std::atomic<std::uint64_t> answers{};
+        std::atomic<std::uint64_t> reports{};
+
+        // the epochs of the shared clocks that the counters above were decayed up to.
+        std::atomic<std::uint64_t> answer_epoch{};
+        std::atomic<std::uint64_t> report_epoch{};
+    };
+
+    // the number of answers and of reports of all the threads, which drives the decay of every slot.
+    struct alignas(64) fpr_clock final
+    {
+        std::atomic<std::uint64_t> answers{};
+        std::atomic<std::uint64_t> reports{};
+    };
+
+    // the slot of the calling thread, picked once per thread.
+    inline std::size_t fpr_slot_of(std::size_t slots) noexcept
+    {
+        static thread_local std::size_t const id = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        return static_cast<std::size_t>(mix64(id)) & (slots - 1);
+    }
+
+    // a counter halved `halvings` times.
+    inline std::uint64_t decayed(std::uint64_t counter, std::uint64_t halvings) noexcept
+    {
+        return halvings < 64 ? counter >> halvings : 0;
+    }
+
+    // halve a counter `halvings` times without losing the increments of other threads in the meantime.
+    inline void decay(std::atomic<std::uint64_t> &counter, std::uint64_t halvings) noexcept
+    {
+        auto const value = counter.load(std::memory_order_relaxed);
+        counter.fetch_sub(value - decayed(value, halvings), std::memory_order_relaxed);
+    }
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief An estimate of the live false positive rate of a filter, from the answers of the filter and the ground truth of a sample of its positive answers.
+    /// Callers record every answer of the filter (or use `matches`, which does it for them), and report whether a sampled positive answer was right, eg. after the real lookup.
+    /// Any unbiased sample of the positive answers works, such as one in 16 of them. The observed false positive rate is then
+    /// `fp / (fp + negatives)`, where `fp` is the number of positive answers times the ratio of false positives among the sampled ones.
+    /// Counters are kept per thread, on separate cache lines, and updated with relaxed atomic operations, so recording and reporting are lock-free.
+    /// They decay exponentially, so the estimate follows a filter that fills up over time: the answers of all threads halve every `half_life` answers recorded by any thread,
+    /// and the reports every `half_life` reports, so that answers and reports can come from different threads, at different rates. Threads add their answers and reports
+    /// to these shared clocks in small batches, and the counters of a thread that went idle are halved as many times as they missed when they are next read or updated.
+    /// A callback fires once when the estimate crosses a threshold, eg. to rebuild the filter, and again only after the estimate went back below it or `reset()`.
+    class fpr_monitor final
+    {
+        inline static constexpr std::size_t slot_count = 32;
+
+    public:
+        /// @brief The type of the callback, which gets the estimated false positive rate.
+        using callback_type = std::function<void(double)>;
+
+        /// @brief Construct a monitor, optionally with a callback fired when the estimate crosses a threshold.
+        /// @param threshold The false positive rate above which the callback fires. Defaults to 1, which never fires.
+        /// @param on_crossed The callback, called from the thread whose report crossed the threshold.
+        /// @param half_life The number of answers (or reports) of all threads after which they are halved. Defaults to 65536.
+        /// @param min_samples The number of (decayed) sampled positive answers needed before the callback can fire, so that it does not fire on noise. Defaults to 100.
+        inline explicit fpr_monitor(
+            double threshold = 1.0,
+            callback_type on_crossed = {},
+            std::size_t half_life = std::size_t{1} << 16,
+            std::size_t min_samples = 100)
+            : on_crossed{std::move(on_crossed)},
+              threshold{threshold},
+              half_life{half_life ? half_life : 1},
+              batch{std::max<std::size_t>(half_life / 256, 1)},
+              min_samples{min_samples}
+        {
+        }
+
+        /// @brief Check a value against a filter, and record the answer.
+        /// @param filter Any filter with a `matches` function.
+        /// @param value The value to check.
+        /// @return The answer of the filter.
+        template <typename Filter, typename U>
+        inline bool matches(Filter const &filter, U &&value) noexcept
+        {
+            auto const found = filter.matches(static_cast<U &&>(value));
+            record(found);
+
+            return found;
+        }
+
+        /// @brief Record an answer of the filter.
+        inline void record(bool found) noexcept
+        {
+            auto &slot = slots[utils::fpr_slot_of(slot_count)];
+
+            catch_up(slot.answer_epoch, clock.answers.load(std::memory_order_relaxed) / half_life, slot.negatives, slot.positives);
+
+            (found ? slot.positives : slot.negatives).fetch_add(1, std::memory_order_relaxed);
+            publish(slot.answers, clock.answers);
+        }
+
+        /// @brief Report the ground truth of a sampled positive answer, and fire the callback if the estimate crossed the threshold.
+        /// @param present Whether the value was really present. If not, the answer was a false positive.
+        inline void report(bool present)
+        {
+            auto &slot = slots[utils::fpr_slot_of(slot_count)];
+
+            // reports decay on their own clock, as a thread might report without recording anything.
+            catch_up(slot.report_epoch, clock.reports.load(std::memory_order_relaxed) / half_life, slot.sampled, slot.false_positives);
+
+            slot.sampled.fetch_add(1, std::memory_order_relaxed);
+
+            if (!present)
+                slot.false_positives.fetch_add(1, std::memory_order_relaxed);
+
+            publish(slot.reports, clock.reports);
+
+            if (on_crossed)
+                check();
+        }
+
+        /// @brief The estimated false positive rate, or 0 if no positive answer was sampled yet.
+        inline double estimate() const noexcept
+        {
+            auto const totals = sum();
+
+            if (totals.sampled == 0)
+                return 0.0;
+
+            auto const fp = static_cast<double>(totals.positives) * totals.false_positives / totals.sampled;
+            auto const negatives = fp + totals.negatives;
+
+            return negatives > 0.0 ? fp / negatives : 0.0;
+        }
+
+        /// @brief The (decayed) number of sampled positive answers behind the estimate.
+        inline std::size_t samples() const noexcept
+        {
+            return static_cast<std::size_t>(sum().sampled);
+        }
+
+        /// @brief Forget all answers and reports, eg. after rebuilding the filter, and re-arm the callback.
+        inline void reset() noexcept
+        {
+            for (auto &slot : slots)
+            {
+                slot.negatives.store(0, std::memory_order_relaxed);
+                slot.positives.store(0, std::memory_order_relaxed);
+                slot.sampled.store(0, std::memory_order_relaxed);
+                slot.false_positives.store(0, std::memory_order_relaxed);
+            }
+
+            armed.store(true, std::memory_order_relaxed);
+        }
+
+    private:
+        struct totals final
+        {
+            std::uint64_t negatives;
+            std::uint64_t positives;
+            std::uint64_t sampled;
+            std::uint64_t false_positives;
+        };
+
+        // count an event of a slot, and add the events of the slot to the shared clock once per batch, so that threads rarely write to the same cache line.
+        inline void publish(std::atomic<std::uint64_t> &events, std::atomic<std::uint64_t> &shared) const noexcept
+        {
+            if ((events.fetch_add(1, std::memory_order_relaxed) + 1) % batch == 0)
+                shared.fetch_add(batch, std::memory_order_relaxed);
+        }
+
+        // halve the counters of a slot once for each epoch of the shared clock they missed, so that the ratio of all the counters fed by a clock is kept.
+        static inline void catch_up(
+            std::atomic<std::uint64_t> &applied,
+            std::uint64_t epoch,
+            std::atomic<std::uint64_t> &first,
+            std::atomic<std::uint64_t> &second) noexcept
+        {
+            // only the thread that moves the epoch of the slot forward halves its counters.
+            if (auto seen = applied.load(std::memory_order_relaxed); seen < epoch && applied.compare_exchange_strong(seen, epoch, std::memory_order_relaxed))
+            {
+                utils::decay(first, epoch - seen);
+                utils::decay(second, epoch - seen);
+            }
+        }
+
+        // the counters of all the slots, each one decayed up to the current epochs without writing to the slots.
+        inline totals sum() const noexcept
+        {
+            auto const answers = clock.answers.load(std::memory_order_relaxed) / half_life;
+            auto const reports = clock.reports.load(std::memory_order_relaxed) / half_life;
+
+            totals result{};
+
+            for (auto const &slot : slots)
+            {
+                auto const answer_epoch = slot.answer_epoch.load(std::memory_order_relaxed);
+                auto const report_epoch = slot.report_epoch.load(std::memory_order_relaxed);
+
+                auto const answer_halvings = answers > answer_epoch ? answers - answer_epoch : 0;
+                auto const report_halvings = reports > report_epoch ? reports - report_epoch : 0;
+
+                result.negatives += utils::decayed(slot.negatives.load(std::memory_order_relaxed), answer_halvings);
+                result.positives += utils::decayed(slot.positives.load(std::memory_order_relaxed), answer_halvings);
+                result.sampled += utils::decayed(slot.sampled.load(std::memory_order_relaxed), report_halvings);
+                result.false_positives += utils::decayed(slot.false_positives.load(std::memory_order_relaxed), report_halvings);
+            }
+
+            return result;
+        }
+
+        inline void check()
+        {
+            if (samples() < min_samples)
+                return;
+
+            auto const fpr = estimate();
+
+            if (fpr < threshold)
+            {
+                armed.store(true, std::memory_order_relaxed);
+                return;
+            }
+
+            // only the thread that disarms the callback fires it.
+            if (bool expected{true}; armed.compare_exchange_strong(expected, false, std::memory_order_relaxed))
+                on_crossed(fpr);
+        }
+
+        utils::fpr_slot slots[slot_count];
+        utils::fpr_clock clock;
+        callback_type on_crossed;
+        double threshold;
+        std::size_t half_life;
+        std::size_t batch;
+        std::size_t min_samples;
+        std::atomic<bool> armed{true};
+    };
+}
@@ -0,0 +1,338 @@
+
+#pragma once
+
+#include <atomic>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bloom_filter.hpp"
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    template <typename T, typename = void>
+    struct is_char_sequence final
+    {
+        inline static constexpr bool value = false;
+    };
+
+    template <typename T>
+    struct is_char_sequence<T, std::void_t<typename T::traits_type, decltype(std::declval<T const &>().data()), decltype(std::declval<T const &>().size())>> final
+    {
+        inline static constexpr bool value = std::is_constructible_v<T, typename T::value_type const *, std::size_t>;
+    };
+
+    // call `f` with copies of `key` where a single bit was flipped, for up to 64 bits spread over the key.
+    // Return `false` if keys of this type cannot be changed bit by bit.
+    template <typename T, typename F>
+    bool for_each_flip(T const &key, F &&f)
+    {
+        if constexpr (is_char_sequence<T>::value)
+        {
+            using char_type = typename T::value_type;
+
+            std::basic_string<char_type, typename T::traits_type> buffer(key.data(), key.size());
+
+            auto const bits = buffer.size() * sizeof(char_type) * 8;
+            auto const step = bits / 64 + 1;
+
+            for (std::size_t bit{}; bit < bits; bit += step)
+            {
+                auto const bytes = reinterpret_cast<unsigned char *>(buffer.data());
+
+                bytes[bit / 8] ^= static_cast<unsigned char>(1 << (bit % 8));
+                f(T(buffer.data(), buffer.size()));
+                bytes[bit / 8] ^= static_cast<unsigned char>(1 << (bit % 8));
+            }
+
+            return true;
+        }
+        else if constexpr (std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>)
+        {
+            auto const bits = sizeof(T) * 8;
+            auto const step = bits / 64 + 1;
+
+            for (std::size_t bit{}; bit < bits; bit += step)
+            {
+                T copy = key;
+
+                reinterpret_cast<unsigned char *>(&copy)[bit / 8] ^= static_cast<unsigned char>(1 << (bit % 8));
+                f(static_cast<T const &>(copy));
+            }
+
+            return true;
+        }
+        else
+        {
+            (void)key;
+            (void)f;
+
+            return false;
+        }
+    }
+
+    // run `f(first, last, thread)` over `threads` contiguous slices of [0, count).
+    template <typename F>
+    void parallel_for(std::size_t count, std::size_t threads, F &&f)
+    {
+        threads = threads == 0 ? 1 : (threads < count ? threads : (count ? count : 1));
+
+        std::vector<std::thread> pool;
+
+        for (std::size_t t{1}; t < threads; ++t)
+            pool.emplace_back([&f, t, count, threads]
+                              { f(count * t / threads, count * (t + 1) / threads, t); });
+
+        f(0, count / threads, 0);
+
+        for (auto &thread : pool)
+            thread.join();
+    }
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief The result of `diagnose_hash`.
+    struct hash_report final
+    {
+        /// @brief The number of sample keys.
+        std::size_t keys;
+
+        /// @brief Pearson's chi-square statistic of the probe positions of the inserted keys, spread over `degrees_of_freedom + 1` equal regions of the filter.
+        /// For a good hash it is close to `degrees_of_freedom`, give or take a few times `sqrt(2 * degrees_of_freedom)`.
+        double chi_square;
+
+        /// @brief The degrees of freedom of the chi-square statistic.
+        std::size_t degrees_of_freedom;
+
+        /// @brief The largest bias of a single bit of the low half of the hashes, ie. `|2 * P(bit is set) - 1|`. 0 is ideal, 1 means the bit never changes.
+        /// The low half of the hash is the step of the probe sequence of `bloom_filter`.
+        double low_bias;
+
+        /// @brief The largest bias of a single bit of the high half of the hashes. The high half of the hash is the start of the probe sequence.
+        double high_bias;
+
+        /// @brief How well flipping one bit of a key flips each bit of the low half of its hash: `1 - mean(|2 * P(bit flips) - 1|)`. 1 is ideal, 0 means the bits never (or always) flip.
+        /// NaN if the keys are neither trivially copyable nor strings, so they cannot be changed bit by bit.
+        double low_avalanche;
+
+        /// @brief The avalanche score of the high half of the hashes.
+        double high_avalanche;
+
+        /// @brief The false positive rate of a `bloom_filter` holding the first half of the keys, measured with the second half.
+        double measured_fpr;
+
+        /// @brief The false positive rate the same filter would have with an ideal hash function.
+        double theoretical_fpr;
+    };
+
+    /// @brief Check how well a hash function suits `bloom_filter`, by running it over sample keys.
+    /// The first half of the keys is inserted into a simulated `bloom_filter` sized for them, and the second half is used to measure false positives,
+    /// so all the keys should be distinct. Avalanche scores are computed on up to 65536 of the keys, flipping up to 64 bits of each.
+    /// The work is spread over multiple threads, and the hash function must be safe to call concurrently.
+    /// @tparam Hash The hash function to check.
+    /// @param first The beginning of the range of sample keys. Must be a random access iterator.
+    /// @param last The end of the range of sample keys.
+    /// @param hash The hash function to check.
+    /// @param eps The false positive rate the simulated filter is sized for. Defaults to 0.01 (1% false positives).
+    /// @param threads The number of threads to use. Defaults to the number of hardware threads.
+    template <
+        typename It,
+        typename Hash = std::hash<typename std::iterator_traits<It>::value_type>>
+    hash_report diagnose_hash(
+        It first, It last,
+        Hash const &hash = Hash{},
+        float eps = 0.01f,
+        std::size_t threads = std::thread::hardware_concurrency())
+    {
+        using key_type = typename std::iterator_traits<It>::value_type;
+
+        static_assert(
+            std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<It>::iterator_category>,
+            "Sample keys must be given as a random access range!");
+
+        static_assert(
+            utils::is_hashable_with<key_type, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        constexpr auto hash_bits = sizeof(std::size_t) * 8;
+        constexpr auto half = utils::size_traits::high_shift;
+        constexpr std::size_t avalanche_keys = 1 << 16;
+        constexpr std::size_t max_regions = 1024;
+
+        hash_report report{};
+
+        auto const n = static_cast<std::size_t>(last - first);
+        auto const inserted = n - n / 2;
+        auto const queried = n / 2;
+
+        report.keys = n;
+
+        // the same sizing as `bloom_filter`.
+        auto const nlog_eps = -std::log(eps);
+        auto const log_2 = 0.6931471805599453f;
+
+        auto const m = std::max(static_cast<std::size_t>(inserted * nlog_eps / (log_2 * log_2)), std::size_t{1});
+        auto const k = static_cast<std::size_t>(nlog_eps / log_2);
+        auto const mod = utils::fast_modulo{m};
+
+        auto const regions = m < max_regions ? m : max_regions;
+
+        std::vector<std::size_t> hashes(n);
+        std::vector<std::atomic<std::uint64_t>> bits((m >> 6) + 1);
+
+        std::vector<std::vector<std::size_t>> set_bits(threads ? threads : 1, std::vector<std::size_t>(hash_bits));
+        std::vector<std::vector<std::size_t>> region_probes(threads ? threads : 1, std::vector<std::size_t>(regions));
+        std::vector<std::vector<std::size_t>> flipped(threads ? threads : 1, std::vector<std::size_t>(hash_bits));
+        std::vector<std::size_t> flips(threads ? threads : 1);
+        std::atomic<std::size_t> false_positives{};
+
+        // mirrors the double hashing of `bloom_filter`.
+        auto const for_each_probe = [&](std::size_t h, auto &&f)
+        {
+            auto const step = h & utils::size_traits::low_mask;
+            h = (h & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+                f(mod(h));
+            }
+        };
+
+        // hash the keys and insert the first half.
+        utils::parallel_for(n, threads, [&](std::size_t begin, std::size_t end, std::size_t t)
+                            {
+                                for (auto i = begin; i < end; ++i)
+                                {
+                                    auto const h = hash(first[static_cast<std::ptrdiff_t>(i)]);
+                                    hashes[i] = h;
+
+                                    for (std::size_t bit{}; bit < hash_bits; ++bit)
+                                        set_bits[t][bit] += (h >> bit) & 1;
+
+                                    if (i < inserted)
+                                    {
+                                        for_each_probe(h, [&](std::uint64_t index)
+                                                       {
+                                                           bits[index >> 6].fetch_or(std::uint64_t{1} << (index & 63), std::memory_order_relaxed);
+                                                           auto const region = static_cast<std::size_t>(static_cast<double>(index) * regions / m);
+                                                           ++region_probes[t][region < regions ? region : regions - 1]; });
+                                    }
+                                } });
+
+        // query the second half.
+        utils::parallel_for(queried, threads, [&](std::size_t begin, std::size_t end, std::size_t)
+                            {
+                                std::size_t found{};
+
+                                for (auto i = begin; i < end; ++i)
+                                {
+                                    bool all{true};
+
+                                    for_each_probe(hashes[inserted + i], [&](std::uint64_t index)
+                                                   { all = all && (bits[index >> 6].load(std::memory_order_relaxed) >> (index & 63)) & 1; });
+
+                                    found += all;
+                                }
+
+                                false_positives += found; });
+
+        // flip single bits of a sample of the keys.
+        auto const sampled = n < avalanche_keys ? n : avalanche_keys;
+        bool mutable_keys{true};
+
+        utils::parallel_for(sampled, threads, [&](std::size_t begin, std::size_t end, std::size_t t)
+                            {
+                                for (auto i = begin; i < end; ++i)
+                                {
+                                    auto const index = i * n / sampled;
+                                    auto const h = hashes[index];
+
+                                    auto const ok = utils::for_each_flip(first[static_cast<std::ptrdiff_t>(index)], [&](key_type const &key)
+                                                                         {
+                                                                             auto const diff = h ^ hash(key);
+
+                                                                             for (std::size_t bit{}; bit < hash_bits; ++bit)
+                                                                                 flipped[t][bit] += (diff >> bit) & 1;
+
+                                                                             ++flips[t]; });
+
+                                    if (!ok)
+                                    {
+                                        // the same for every key, and every thread.
+                                        if (t == 0)
+                                            mutable_keys = false;
+
+                                        return;
+                                    }
+                                } });
+
+        // merge the per-thread counters.
+        for (std::size_t t{1}; t < set_bits.size(); ++t)
+        {
+            for (std::size_t bit{}; bit < hash_bits; ++bit)
+            {
+                set_bits[0][bit] += set_bits[t][bit];
+                flipped[0][bit] += flipped[t][bit];
+            }
+
+            for (std::size_t r{}; r < regions; ++r)
+                region_probes[0][r] += region_probes[t][r];
+
+            flips[0] += flips[t];
+        }
+
+        // each region covers the positions p with r <= p * regions / m < r + 1.
+        auto const total_probes = static_cast<double>(inserted * k);
+
+        for (std::size_t r{}; r < regions; ++r)
+        {
+            auto const from = std::ceil(static_cast<double>(r) * m / regions);
+            auto const to = std::ceil(static_cast<double>(r + 1) * m / regions);
+
+            if (auto const expected = total_probes * (to - from) / m; expected > 0)
+            {
+                auto const delta = region_probes[0][r] - expected;
+                report.chi_square += delta * delta / expected;
+            }
+        }
+
+        report.degrees_of_freedom = regions - 1;
+
+        for (std::size_t bit{}; bit < hash_bits && n; ++bit)
+        {
+            auto const bias = std::abs(2.0 * set_bits[0][bit] / n - 1.0);
+            auto &worst = bit < half ? report.low_bias : report.high_bias;
+
+            worst = bias > worst ? bias : worst;
+        }
+
+        if (mutable_keys && flips[0])
+        {
+            double low{}, high{};
+
+            for (std::size_t bit{}; bit < hash_bits; ++bit)
+                (bit < half ? low : high) += std::abs(2.0 * flipped[0][bit] / flips[0] - 1.0);
+
+            report.low_avalanche = 1.0 - low / half;
+            report.high_avalanche = 1.0 - high / (hash_bits - half);
+        }
+        else
+        {
+            report.low_avalanche = std::numeric_limits<double>::quiet_NaN();
+            report.high_avalanche = std::numeric_limits<double>::quiet_NaN();
+        }
+
+        report.measured_fpr = queried ? static_cast<double>(false_positives) / queried : 0.0;
+        report.theoretical_fpr = std::pow(1.0 - std::exp(-static_cast<double>(k) * inserted / m), static_cast<double>(k));
+
+        return report;
+    }
+}
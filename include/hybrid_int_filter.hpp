@@ -0,0 +1,627 @@
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "bloom_filter.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TNT_HYBRID_SSE2
+#endif
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // the exact containers a chunk of 2^16 consecutive integers can be stored in.
+    enum class int_container : std::uint8_t
+    {
+        array,
+        bitmap,
+        elias_fano,
+    };
+
+    // the integers of a chunk, as the 16 low bits of the keys that share the same high bits.
+    template <typename Alloc>
+    struct int_chunk final
+    {
+        using value_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<std::uint16_t>;
+
+        inline explicit int_chunk(Alloc const &alloc)
+            : values(value_allocator(alloc)),
+              words(alloc)
+        {
+        }
+
+        int_container kind{int_container::array};
+
+        // the number of low bits of an Elias-Fano chunk.
+        std::uint8_t shift{};
+        std::size_t count{};
+
+        // the sorted values of an array chunk.
+        std::vector<std::uint16_t, value_allocator> values;
+
+        // the bits of a bitmap or Elias-Fano chunk.
+        std::vector<std::uint64_t, Alloc> words;
+    };
+
+    // integer keys, and the high bits of chunks, are often consecutive, so they are mixed before being hashed.
+    struct int_key_hash
+    {
+        inline std::size_t operator()(std::uint64_t key) const noexcept
+        {
+            return static_cast<std::size_t>(mix64(key));
+        }
+    };
+
+    // find a value in a sorted array of 16-bit values: a branchless binary search narrows it down to 16 values at most, which are compared at once.
+    inline bool sorted_contains(std::uint16_t const *values, std::size_t n, std::uint16_t value) noexcept
+    {
+        while (n > 16)
+        {
+            auto const half = n / 2;
+            values = values[half] <= value ? values + half : values;
+            n -= half;
+        }
+
+#ifdef TNT_HYBRID_SSE2
+        // two overlapping loads cover the remaining 9 to 16 values.
+        if (n >= 8)
+        {
+            auto const needle = _mm_set1_epi16(static_cast<short>(value));
+            auto const front = _mm_loadu_si128(reinterpret_cast<__m128i const *>(values));
+            auto const back = _mm_loadu_si128(reinterpret_cast<__m128i const *>(values + n - 8));
+
+            return _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(front, needle), _mm_cmpeq_epi16(back, needle))) != 0;
+        }
+#endif
+
+        bool found{};
+
+        for (std::size_t i{}; i < n; ++i)
+            found |= values[i] == value;
+
+        return found;
+    }
+
+    // Elias-Fano chunks are laid out as the low bits of every value, then the high bits as a unary-coded bit vector
+    // (value i sets bit (v_i >> shift) + i, so that each bucket of high bits ends with a zero), then the start of every
+    // 64th bucket in the high bits, so that a lookup skips at most 63 buckets.
+    struct elias_fano_layout final
+    {
+        inline elias_fano_layout(std::size_t count, std::size_t shift) noexcept
+            : buckets{std::size_t{1} << (16 - shift)},
+              lows{(count * shift + 63) >> 6},
+              highs{(count + buckets + 63) >> 6},
+              samples{(buckets + 63) >> 6}
+        {
+        }
+
+        // the number of low bits that keeps the high bits at about two bits per value.
+        static inline std::size_t shift_for(std::size_t count) noexcept
+        {
+            std::size_t shift{};
+
+            while (shift < 15 && (count << (shift + 1)) <= (std::size_t{1} << 16))
+                ++shift;
+
+            return shift;
+        }
+
+        inline std::size_t words() const noexcept
+        {
+            return lows + highs + samples;
+        }
+
+        std::size_t buckets;
+        std::size_t lows;
+        std::size_t highs;
+        std::size_t samples;
+    };
+
+    inline std::uint64_t read_bits(std::uint64_t const *words, std::size_t bit, std::size_t width) noexcept
+    {
+        if (width == 0)
+            return 0;
+
+        auto const offset = bit & 63;
+        auto value = words[bit >> 6] >> offset;
+
+        if (offset + width > 64)
+            value |= words[(bit >> 6) + 1] << (64 - offset);
+
+        return value & ((std::uint64_t{1} << width) - 1);
+    }
+
+    inline void write_bits(std::uint64_t *words, std::size_t bit, std::size_t width, std::uint64_t value) noexcept
+    {
+        if (width == 0)
+            return;
+
+        auto const offset = bit & 63;
+        words[bit >> 6] |= value << offset;
+
+        if (offset + width > 64)
+            words[(bit >> 6) + 1] |= value >> (64 - offset);
+    }
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief A filter for sets of integers that splits the integers in chunks of 2^16 consecutive values, and picks the smallest container for each chunk.
+    /// Dense chunks are exact bitmaps, sparser chunks are exact sorted arrays or Elias-Fano lists, and chunks so sparse that a bloom filter is smaller
+    /// than any exact container (including the cost of the chunk itself) are folded into a bloom segment shared by all of them, with the requested false positive rate.
+    /// Insertions go into exact chunks (arrays, which become bitmaps past 4096 values), and `optimize()` then moves every chunk to its smallest container.
+    /// Each `optimize()` that folds chunks adds one segment sized for exactly their values, so segments never fill up, but every segment adds to the false positive rate:
+    /// call it once most values are inserted.
+    /// For dense sets, eg. 40 million integers out of 50 million, the filter is exact and smaller than a `tnt::bloom_filter` at 1%.
+    /// For sparse sets, eg. random 64-bit integers, the filter takes about as much memory as a `tnt::bloom_filter` once optimized.
+    /// @tparam T The type of the integers.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T = std::uint64_t,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class hybrid_int_filter final
+        : private std::allocator_traits<Alloc>::template rebind_alloc<std::uint64_t>
+    {
+        static_assert(std::is_integral_v<T>, "hybrid_int_filter only holds integers!");
+
+        using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<std::uint64_t>;
+        using chunk = utils::int_chunk<allocator_type>;
+        using chunk_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<std::uint64_t const, chunk>>;
+        using chunk_map = std::unordered_map<std::uint64_t, chunk, utils::int_key_hash, std::equal_to<std::uint64_t>, chunk_allocator>;
+        using segment = bloom_filter<std::uint64_t, utils::int_key_hash, allocator_type>;
+        using segment_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<segment>;
+        using container = utils::int_container;
+
+        // past this many values, an array is larger than a bitmap.
+        inline static constexpr std::size_t array_limit = 4'096;
+        inline static constexpr std::size_t bitmap_words = (std::size_t{1} << 16) / 64;
+
+        // the bits a chunk costs besides its values: the chunk, its node in the index and its bucket.
+        inline static constexpr std::size_t chunk_bits = (sizeof(typename chunk_map::value_type) + 2 * sizeof(void *)) * 8;
+
+    public:
+        /// @brief Construct an empty filter.
+        /// @param eps The false positive rate of the chunks that are too sparse to be stored exactly. Defaults to 0.01 (1% false positives). Use 0 to keep every chunk exact.
+        /// @param alloc The allocator to be used for memory management.
+        inline explicit hybrid_int_filter(
+            float eps = 0.01f,
+            allocator_type const &alloc = allocator_type{})
+            : allocator_type(alloc),
+              chunks(chunk_allocator(alloc)),
+              segments(segment_allocator(alloc))
+        {
+            if (eps > 0.0f && eps < 1.0f)
+            {
+                auto const nlog_eps = -std::log(eps);
+                auto const log_2 = 0.6931471805599453f;
+
+                rate = eps;
+                bits_per_key = nlog_eps / (log_2 * log_2);
+            }
+        }
+
+        /// @brief Add the value into the filter.
+        inline void insert(T value)
+        {
+            insert_into(find_or_add(key(value) >> 16), key(value));
+        }
+
+        /// @brief Add a range of values into the filter. Consecutive values of the same chunk only look the chunk up once, so sorted ranges are faster.
+        template <typename It>
+        inline void insert(It first, It last)
+        {
+            chunk *last_chunk{};
+            std::uint64_t last_high{};
+
+            for (; first != last; ++first)
+            {
+                auto const k = key(*first);
+
+                if (!last_chunk || last_high != (k >> 16))
+                {
+                    last_high = k >> 16;
+                    last_chunk = &find_or_add(last_high);
+                }
+
+                insert_into(*last_chunk, k);
+            }
+        }
+
+        /// @brief Check whether the given value *might* be present in the filter. While the filter has no bloom segment, there are no false positives at all.
+        inline bool matches(T value) const noexcept
+        {
+            auto const k = key(value);
+            auto const c = find(k >> 16);
+
+            return (c && contains(*c, k)) || segments_contain(k);
+        }
+
+        /// @brief Check a range of values at once. Consecutive values of the same chunk only look the chunk up once, so sorted ranges are faster.
+        /// @param out Where to write whether each value might be present.
+        /// @return The number of values that might be present.
+        template <typename It>
+        inline std::size_t matches(It first, It last, bool *out) const noexcept
+        {
+            std::size_t count{};
+            std::uint64_t high{~std::uint64_t{}};
+            chunk const *c{};
+
+            for (; first != last; ++first)
+            {
+                auto const k = key(*first);
+
+                if ((k >> 16) != high)
+                {
+                    high = k >> 16;
+                    c = find(high);
+                }
+
+                auto const found = (c && contains(*c, k)) || segments_contain(k);
+
+                *out++ = found;
+                count += found;
+            }
+
+            return count;
+        }
+
+        /// @brief Move every chunk to its smallest container. Chunks sparse enough are folded into a new bloom segment, sized for their values.
+        inline void optimize()
+        {
+            std::vector<std::uint64_t> sparse;
+
+            for (auto it = chunks.begin(); it != chunks.end();)
+            {
+                auto &c = it->second;
+                auto values = sorted_values(c);
+                auto const n = values.size();
+
+                auto const shift = utils::elias_fano_layout::shift_for(n);
+                auto const ef_bits = utils::elias_fano_layout{n, shift}.words() * 64;
+                auto const exact_bits = std::min({std::size_t{1} << 16, n * 16, ef_bits});
+
+                if (bits_per_key > 0.0f && n * bits_per_key < exact_bits + chunk_bits)
+                {
+                    for (auto const value : values)
+                        sparse.push_back((it->first << 16) | value);
+
+                    it = chunks.erase(it);
+                    continue;
+                }
+
+                if (c.kind != container::elias_fano && ef_bits < std::min(std::size_t{1} << 16, n * 16))
+                    to_elias_fano(c, values, shift);
+                else
+                    c.values.shrink_to_fit();
+
+                ++it;
+            }
+
+            if (sparse.empty())
+                return;
+
+            // the index keeps its buckets after erasing, so it is shrunk to the chunks that are left.
+            chunks.rehash(0);
+
+            auto &bloom = segments.emplace_back(sparse.size(), rate, utils::int_key_hash{}, static_cast<allocator_type const &>(*this));
+
+            for (auto const k : sparse)
+                bloom.insert(k);
+
+            folded += sparse.size();
+        }
+
+        /// @brief Remove all values from the filter.
+        inline void clear() noexcept
+        {
+            chunks.clear();
+            segments.clear();
+            folded = 0;
+        }
+
+        /// @brief Whether the filter has no bloom segment, ie. whether `matches` has no false positives at all.
+        inline bool exact() const noexcept
+        {
+            return segments.empty();
+        }
+
+        /// @brief The number of values in the filter. Values inserted again after being folded into a bloom segment count twice.
+        inline std::size_t size() const noexcept
+        {
+            auto total = folded;
+
+            for (auto const &[high, c] : chunks)
+                total += c.count;
+
+            return total;
+        }
+
+        /// @brief The number of bytes used by the containers of the filter, including the index of the chunks.
+        inline std::size_t bytes() const noexcept
+        {
+            auto total = chunks.bucket_count() * sizeof(void *) + chunks.size() * chunk_bits / 8;
+
+            for (auto const &[high, c] : chunks)
+                total += c.values.capacity() * sizeof(std::uint16_t) + c.words.capacity() * sizeof(std::uint64_t);
+
+            for (auto const &bloom : segments)
+                total += sizeof(segment) + bloom.length() * sizeof(std::uint64_t);
+
+            return total;
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend inline void swap(hybrid_int_filter &lhs, hybrid_int_filter &rhs) noexcept
+        {
+            std::swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+            lhs.chunks.swap(rhs.chunks);
+            lhs.segments.swap(rhs.segments);
+            std::swap(lhs.folded, rhs.folded);
+            std::swap(lhs.rate, rhs.rate);
+            std::swap(lhs.bits_per_key, rhs.bits_per_key);
+        }
+
+    private:
+        static inline std::uint64_t key(T value) noexcept
+        {
+            return static_cast<std::uint64_t>(value);
+        }
+
+        inline chunk const *find(std::uint64_t high) const noexcept
+        {
+            auto const it = chunks.find(high);
+
+            return it != chunks.end() ? &it->second : nullptr;
+        }
+
+        inline chunk &find_or_add(std::uint64_t high)
+        {
+            return chunks.try_emplace(high, static_cast<allocator_type const &>(*this)).first->second;
+        }
+
+        inline bool segments_contain(std::uint64_t k) const noexcept
+        {
+            return std::any_of(segments.begin(), segments.end(), [k](segment const &bloom)
+                               { return bloom.matches(k); });
+        }
+
+        inline bool contains(chunk const &c, std::uint64_t k) const noexcept
+        {
+            auto const low = static_cast<std::uint16_t>(k);
+
+            switch (c.kind)
+            {
+            case container::array:
+                return utils::sorted_contains(c.values.data(), c.values.size(), low);
+
+            case container::bitmap:
+                return (c.words[low >> 6] >> (low & 63)) & 1;
+
+            default:
+                return elias_fano_contains(c, low);
+            }
+        }
+
+        inline void insert_into(chunk &c, std::uint64_t k)
+        {
+            auto const low = static_cast<std::uint16_t>(k);
+
+            switch (c.kind)
+            {
+            case container::elias_fano:
+            {
+                // Elias-Fano lists cannot grow in place, so the chunk goes back to an array or a bitmap.
+                auto values = sorted_values(c);
+
+                if (values.size() < array_limit)
+                    to_array(c, std::move(values));
+                else
+                    to_bitmap(c, values);
+
+                insert_into(c, k);
+                return;
+            }
+
+            case container::array:
+            {
+                auto const it = std::lower_bound(c.values.begin(), c.values.end(), low);
+
+                if (it != c.values.end() && *it == low)
+                    return;
+
+                if (c.values.size() < array_limit)
+                {
+                    c.values.insert(it, low);
+                    ++c.count;
+                    return;
+                }
+
+                std::vector<std::uint16_t> values(c.values.begin(), c.values.end());
+                to_bitmap(c, values);
+
+                [[fallthrough]];
+            }
+
+            case container::bitmap:
+            {
+                auto &word = c.words[low >> 6];
+                auto const bit = std::uint64_t{1} << (low & 63);
+
+                c.count += (word & bit) == 0;
+                word |= bit;
+            }
+            }
+        }
+
+        inline std::vector<std::uint16_t> sorted_values(chunk const &c) const
+        {
+            std::vector<std::uint16_t> values;
+            values.reserve(c.count);
+
+            switch (c.kind)
+            {
+            case container::array:
+                values.assign(c.values.begin(), c.values.end());
+                break;
+
+            case container::bitmap:
+                for (std::size_t i{}; i < bitmap_words; ++i)
+                {
+                    for (auto word = c.words[i]; word; word &= word - 1)
+                        values.push_back(static_cast<std::uint16_t>(i * 64 + utils::countr_zero(word)));
+                }
+
+                break;
+
+            default:
+            {
+                utils::elias_fano_layout const layout{c.count, c.shift};
+                auto const highs = c.words.data() + layout.lows;
+
+                std::size_t index{};
+
+                for (std::size_t i{}; i < layout.highs; ++i)
+                {
+                    for (auto word = highs[i]; word; word &= word - 1, ++index)
+                    {
+                        auto const high = i * 64 + utils::countr_zero(word) - index;
+                        auto const low = utils::read_bits(c.words.data(), index * c.shift, c.shift);
+
+                        values.push_back(static_cast<std::uint16_t>((high << c.shift) | low));
+                    }
+                }
+            }
+            }
+
+            return values;
+        }
+
+        inline void to_array(chunk &c, std::vector<std::uint16_t> values)
+        {
+            c.values.assign(values.begin(), values.end());
+            c.words.clear();
+            c.words.shrink_to_fit();
+            c.kind = container::array;
+            c.count = values.size();
+        }
+
+        inline void to_bitmap(chunk &c, std::vector<std::uint16_t> const &values)
+        {
+            c.words.assign(bitmap_words, 0);
+
+            for (auto const value : values)
+                c.words[value >> 6] |= std::uint64_t{1} << (value & 63);
+
+            c.values.clear();
+            c.values.shrink_to_fit();
+            c.kind = container::bitmap;
+            c.count = values.size();
+        }
+
+        inline void to_elias_fano(chunk &c, std::vector<std::uint16_t> const &values, std::size_t shift)
+        {
+            utils::elias_fano_layout const layout{values.size(), shift};
+
+            c.words.assign(layout.words(), 0);
+
+            auto const highs = c.words.data() + layout.lows;
+            auto const samples = highs + layout.highs;
+
+            for (std::size_t i{}; i < values.size(); ++i)
+            {
+                auto const high = std::size_t{values[i]} >> shift;
+
+                utils::write_bits(c.words.data(), i * shift, shift, values[i] & ((std::uint64_t{1} << shift) - 1));
+                highs[(high + i) >> 6] |= std::uint64_t{1} << ((high + i) & 63);
+            }
+
+            // bucket b starts after the values of the buckets before it, and after their b terminating zeros.
+            for (std::size_t b{}, index{}; b < layout.buckets; b += 64)
+            {
+                while (index < values.size() && (std::size_t{values[index]} >> shift) < b)
+                    ++index;
+
+                samples[b >> 6] = b + index;
+            }
+
+            c.values.clear();
+            c.values.shrink_to_fit();
+            c.kind = container::elias_fano;
+            c.shift = static_cast<std::uint8_t>(shift);
+            c.count = values.size();
+        }
+
+        inline bool elias_fano_contains(chunk const &c, std::uint16_t value) const noexcept
+        {
+            utils::elias_fano_layout const layout{c.count, c.shift};
+
+            auto const highs = c.words.data() + layout.lows;
+            auto const samples = highs + layout.highs;
+            auto const high = std::size_t{value} >> c.shift;
+            auto const low = value & ((std::uint64_t{1} << c.shift) - 1);
+
+            // skip the terminating zeros of the buckets before this one, starting from the closest sample.
+            auto position = static_cast<std::size_t>(samples[high >> 6]);
+
+            for (auto zeros = high & 63; zeros;)
+            {
+                auto const free = ~highs[position >> 6] >> (position & 63);
+                auto const available = utils::popcount(free);
+
+                if (available >= zeros)
+                {
+                    position += utils::select64(free, zeros - 1) + 1;
+                    break;
+                }
+
+                zeros -= available;
+                position += 64 - (position & 63);
+            }
+
+            // the values of the bucket are the ones up to the next zero, sorted by their low bits.
+            for (auto index = position - high; (highs[position >> 6] >> (position & 63)) & 1; ++position, ++index)
+            {
+                auto const candidate = utils::read_bits(c.words.data(), index * c.shift, c.shift);
+
+                if (candidate >= low)
+                    return candidate == low;
+            }
+
+            return false;
+        }
+
+        chunk_map chunks;
+        // segments are never moved, as filters with a polymorphic allocator cannot be.
+        std::deque<segment, segment_allocator> segments;
+        std::size_t folded{};
+        float rate{};
+        float bits_per_key{};
+    };
+
+    namespace pmr
+    {
+        /// @brief Specialization of hybrid_int_filter using a polymorphic allocator.
+        /// @tparam T The type of the integers.
+        template <typename T = std::uint64_t>
+        using hybrid_int_filter = tnt::hybrid_int_filter<
+            T,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
+    }
+}
+
+#undef TNT_HYBRID_SSE2
@@ -1,8 +1,23 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <type_traits>
 
+#if __has_include(<version>)
+#include <version>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__BMI2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 /// @cond NO_DOXYGEN
 
 namespace tnt::utils
@@ -37,6 +52,348 @@ namespace tnt::utils
         inline static constexpr bool value = true;
     };
 
+    // number of set bits in the word.
+    inline std::size_t popcount(std::uint64_t x) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_popcountll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+        return static_cast<std::size_t>(__popcnt64(x));
+#else
+        std::size_t count{};
+        for (; x; x &= x - 1)
+            ++count;
+        return count;
+#endif
+    }
+
+    // number of set bits in a range of words, in a single pass.
+    inline std::size_t popcount(std::uint64_t const *words, std::size_t n) noexcept
+    {
+        std::size_t count{};
+        std::size_t i{};
+
+#if defined(__AVX512VPOPCNTDQ__) && defined(__AVX512F__)
+        auto acc = _mm512_setzero_si512();
+
+        for (; i + 8 <= n; i += 8)
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_loadu_si512(words + i)));
+
+        alignas(64) std::uint64_t lanes[8];
+        _mm512_store_si512(lanes, acc);
+
+        for (auto const lane : lanes)
+            count += static_cast<std::size_t>(lane);
+#elif defined(__AVX2__)
+        // nibble lookup table (Mula et al.), with the byte counts summed into 64-bit lanes.
+        auto const lookup = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        auto const low_mask = _mm256_set1_epi8(0x0f);
+        auto acc = _mm256_setzero_si256();
+
+        for (; i + 4 <= n; i += 4)
+        {
+            auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(words + i));
+            auto const lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_mask));
+            auto const hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask));
+
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+        }
+
+        count += static_cast<std::size_t>(_mm256_extract_epi64(acc, 0)) + static_cast<std::size_t>(_mm256_extract_epi64(acc, 1)) +
+                 static_cast<std::size_t>(_mm256_extract_epi64(acc, 2)) + static_cast<std::size_t>(_mm256_extract_epi64(acc, 3));
+#endif
+
+        for (; i < n; ++i)
+            count += popcount(words[i]);
+
+        return count;
+    }
+
+    // number of trailing zero bits, the word must not be zero.
+    inline std::size_t countr_zero(std::uint64_t x) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<std::size_t>(__builtin_ctzll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, x);
+        return static_cast<std::size_t>(index);
+#else
+        std::size_t count{};
+        for (; (x & 1) == 0; x >>= 1)
+            ++count;
+        return count;
+#endif
+    }
+
+    // position of the set bit of the given rank (starting at 0), the word must have more than `rank` bits set.
+    inline std::size_t select64(std::uint64_t x, std::size_t rank) noexcept
+    {
+#if defined(__BMI2__)
+        return countr_zero(_pdep_u64(std::uint64_t{1} << rank, x));
+#else
+        for (; rank; --rank)
+            x &= x - 1;
+
+        return countr_zero(x);
+#endif
+    }
+
+    // hint the cache line holding the given address into the cache, so that its miss overlaps with other work.
+    inline void prefetch(void const *p) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_prefetch(static_cast<char const *>(p), _MM_HINT_T0);
+#else
+        (void)p;
+#endif
+    }
+
+    // atomically set the bits of `mask` in a word that other threads might be writing too.
+    inline void atomic_or(std::uint64_t *word, std::uint64_t mask) noexcept
+    {
+#if defined(__cpp_lib_atomic_ref)
+        std::atomic_ref<std::uint64_t>{*word}.fetch_or(mask, std::memory_order_relaxed);
+#elif defined(_MSC_VER)
+        _InterlockedOr64(reinterpret_cast<long long volatile *>(word), static_cast<long long>(mask));
+#else
+        __atomic_fetch_or(word, mask, __ATOMIC_RELAXED);
+#endif
+    }
+
+    // read a word that other threads might be writing to.
+    inline std::uint64_t atomic_load(std::uint64_t const *word) noexcept
+    {
+#if defined(__cpp_lib_atomic_ref)
+        return std::atomic_ref<std::uint64_t>{*const_cast<std::uint64_t *>(word)}.load(std::memory_order_relaxed);
+#elif defined(_MSC_VER)
+        return static_cast<std::uint64_t>(*reinterpret_cast<long long const volatile *>(word));
+#else
+        return __atomic_load_n(word, __ATOMIC_RELAXED);
+#endif
+    }
+
+    // write a word that other threads might be reading.
+    inline void atomic_store(std::uint64_t *word, std::uint64_t value) noexcept
+    {
+#if defined(__cpp_lib_atomic_ref)
+        std::atomic_ref<std::uint64_t>{*word}.store(value, std::memory_order_relaxed);
+#elif defined(_MSC_VER)
+        _InterlockedExchange64(reinterpret_cast<long long volatile *>(word), static_cast<long long>(value));
+#else
+        __atomic_store_n(word, value, __ATOMIC_RELAXED);
+#endif
+    }
+
+    // little-endian loads and stores, for formats that are the same whatever the host.
+    inline std::uint32_t load_le32(unsigned char const *p) noexcept
+    {
+        return std::uint32_t{p[0]} | std::uint32_t{p[1]} << 8 | std::uint32_t{p[2]} << 16 | std::uint32_t{p[3]} << 24;
+    }
+
+    inline std::uint64_t load_le64(unsigned char const *p) noexcept
+    {
+        return std::uint64_t{load_le32(p)} | std::uint64_t{load_le32(p + 4)} << 32;
+    }
+
+    inline void store_le32(unsigned char *p, std::uint32_t x) noexcept
+    {
+        p[0] = static_cast<unsigned char>(x);
+        p[1] = static_cast<unsigned char>(x >> 8);
+        p[2] = static_cast<unsigned char>(x >> 16);
+        p[3] = static_cast<unsigned char>(x >> 24);
+    }
+
+    inline void store_le64(unsigned char *p, std::uint64_t x) noexcept
+    {
+        store_le32(p, static_cast<std::uint32_t>(x));
+        store_le32(p + 4, static_cast<std::uint32_t>(x >> 32));
+    }
+
+#if defined(__SIZEOF_INT128__)
+    // `__extension__` keeps -Wpedantic quiet about the non-standard type.
+    __extension__ typedef unsigned __int128 uint128;
+#endif
+
+    // high half of the 128-bit product of two words, from their 32-bit halves.
+    constexpr std::uint64_t mulhi_portable(std::uint64_t a, std::uint64_t b) noexcept
+    {
+        auto const a_lo = a & 0xffffffff, a_hi = a >> 32;
+        auto const b_lo = b & 0xffffffff, b_hi = b >> 32;
+
+        auto const lo_lo = a_lo * b_lo;
+        auto const hi_lo = a_hi * b_lo;
+        auto const lo_hi = a_lo * b_hi;
+
+        auto const cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+        return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+    }
+
+    // high half of the 128-bit product of two words.
+    constexpr std::uint64_t mulhi(std::uint64_t a, std::uint64_t b) noexcept
+    {
+#if defined(__SIZEOF_INT128__)
+        return static_cast<std::uint64_t>((static_cast<uint128>(a) * b) >> 64);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64)) && defined(__cpp_lib_is_constant_evaluated)
+        if (std::is_constant_evaluated())
+            return mulhi_portable(a, b);
+
+        return __umulh(a, b);
+#else
+        return mulhi_portable(a, b);
+#endif
+    }
+
+#if defined(__AVX512F__)
+    // high half of the 128-bit products of the words of each lane.
+    inline __m512i mulhi(__m512i a, __m512i b) noexcept
+    {
+        auto const a_hi = _mm512_srli_epi64(a, 32);
+        auto const b_hi = _mm512_srli_epi64(b, 32);
+
+        auto const lo_lo = _mm512_mul_epu32(a, b);
+        auto const hi_lo = _mm512_mul_epu32(a_hi, b);
+        auto const lo_hi = _mm512_mul_epu32(a, b_hi);
+        auto const hi_hi = _mm512_mul_epu32(a_hi, b_hi);
+
+        auto const cross = _mm512_add_epi64(
+            _mm512_add_epi64(_mm512_srli_epi64(lo_lo, 32), _mm512_and_si512(hi_lo, _mm512_set1_epi64(0xffffffff))),
+            lo_hi);
+
+        return _mm512_add_epi64(_mm512_add_epi64(hi_hi, _mm512_srli_epi64(hi_lo, 32)), _mm512_srli_epi64(cross, 32));
+    }
+
+    // low half of the products of the words of each lane.
+    inline __m512i mullo(__m512i a, __m512i b) noexcept
+    {
+#if defined(__AVX512DQ__)
+        return _mm512_mullo_epi64(a, b);
+#else
+        auto const cross = _mm512_add_epi64(
+            _mm512_mul_epu32(_mm512_srli_epi64(a, 32), b),
+            _mm512_mul_epu32(a, _mm512_srli_epi64(b, 32)));
+
+        return _mm512_add_epi64(_mm512_mul_epu32(a, b), _mm512_slli_epi64(cross, 32));
+#endif
+    }
+#endif
+
+    // Exact `n % d` for a divisor known at runtime, using a precomputed reciprocal instead of a hardware division
+    // (the unsigned 64-bit algorithm of libdivide). The results are the same as `%` for every n. The divisor must not be zero.
+    class fast_modulo final
+    {
+    public:
+        constexpr fast_modulo() noexcept = default;
+
+        constexpr explicit fast_modulo(std::uint64_t d) noexcept
+            : divisor{d}
+        {
+            // powers of two are handled with a mask.
+            if ((d & (d - 1)) == 0)
+                return;
+
+            std::size_t log2_d{63};
+            while ((d >> log2_d) == 0)
+                --log2_d;
+
+            // floor(2^(64 + log2_d) / d), with a long division since the quotient fits in 64 bits.
+            std::uint64_t quotient{};
+            std::uint64_t rem{std::uint64_t{1} << log2_d};
+
+            for (std::size_t i{}; i < 64; ++i)
+            {
+                auto const carry = rem >> 63;
+
+                rem <<= 1;
+                quotient <<= 1;
+
+                if (carry || rem >= d)
+                {
+                    rem -= d;
+                    quotient |= 1;
+                }
+            }
+
+            if (d - rem < (std::uint64_t{1} << log2_d))
+            {
+                // the reciprocal fits in 64 bits.
+                magic = quotient + 1;
+                shift = static_cast<std::uint8_t>(log2_d);
+            }
+            else
+            {
+                // one more bit of precision, whose top bit is added back in `divide`.
+                auto const twice_rem = rem + rem;
+
+                magic = quotient + quotient + (twice_rem >= d || twice_rem < rem) + 1;
+                shift = static_cast<std::uint8_t>(log2_d);
+                add = true;
+            }
+        }
+
+        constexpr std::uint64_t divide(std::uint64_t n) const noexcept
+        {
+            if (magic == 0)
+                return divisor ? n >> countr_zero_constexpr(divisor) : 0;
+
+            auto const q = mulhi(magic, n);
+
+            return add ? (((n - q) >> 1) + q) >> shift : q >> shift;
+        }
+
+        constexpr std::uint64_t operator()(std::uint64_t n) const noexcept
+        {
+            if (magic == 0)
+                return n & (divisor - 1);
+
+            return n - divide(n) * divisor;
+        }
+
+#if defined(__AVX512F__)
+        // the same as above, on each of the 8 lanes.
+        inline __m512i operator()(__m512i n) const noexcept
+        {
+            if (magic == 0)
+                return _mm512_and_si512(n, _mm512_set1_epi64(static_cast<long long>(divisor - 1)));
+
+            auto q = mulhi(_mm512_set1_epi64(static_cast<long long>(magic)), n);
+
+            if (add)
+                q = _mm512_add_epi64(_mm512_srli_epi64(_mm512_sub_epi64(n, q), 1), q);
+
+            q = _mm512_srl_epi64(q, _mm_cvtsi32_si128(shift));
+
+            return _mm512_sub_epi64(n, mullo(q, _mm512_set1_epi64(static_cast<long long>(divisor))));
+        }
+#endif
+
+    private:
+        static constexpr std::size_t countr_zero_constexpr(std::uint64_t x) noexcept
+        {
+            std::size_t count{};
+            for (; (x & 1) == 0; x >>= 1)
+                ++count;
+            return count;
+        }
+
+        std::uint64_t divisor{};
+        std::uint64_t magic{};
+        std::uint8_t shift{};
+        bool add{};
+    };
+
+    // splitmix64 finalizer, used to remix weak hashes.
+    constexpr std::uint64_t mix64(std::uint64_t h) noexcept
+    {
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+        return h ^ (h >> 31);
+    }
+
     constexpr std::size_t next_power_of_two(std::size_t n, std::size_t i = sizeof(std::size_t)) noexcept
     {
         return (n & (std::size_t{1} << i))
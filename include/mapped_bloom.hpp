@@ -0,0 +1,127 @@
+
+#pragma once
+
+#include <new>
+
+#include "bloom_filter.hpp"
+
+#if (defined(__unix__) || defined(__APPLE__)) && __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+
+#if defined(MAP_ANONYMOUS)
+#define TNT_MMAP_STORAGE 1
+#endif
+#endif
+
+namespace tnt
+{
+    /// @brief Bits stored in an anonymous memory mapping, so that pages only take memory once a bit is set in them, and clearing gives them back to the system on Linux.
+    /// Useful for very large filters that fill up slowly, or that are cleared often. Where `mmap` is not available, the bits are allocated on the heap instead.
+    class mmap_storage
+    {
+    public:
+        /// @brief Mapped storage takes no allocator.
+        using allocator_type = utils::no_allocator;
+
+        /// @brief The number of words of a fixed-size storage, or 0 if the size is picked at runtime.
+        inline static constexpr std::size_t fixed_words = 0;
+
+        /// @brief Whether insertions and queries can run from several threads at once.
+        inline static constexpr bool concurrent = false;
+
+        inline mmap_storage(allocator_type = {}) noexcept {}
+
+        // copies map their own pages, the filter then copies the words.
+        inline mmap_storage(mmap_storage const &) noexcept {}
+
+        inline allocator_type get_allocator() const noexcept
+        {
+            return {};
+        }
+
+        inline void allocate(std::size_t len)
+        {
+            if (len == 0)
+                return;
+
+#if defined(TNT_MMAP_STORAGE)
+#if defined(MAP_NORESERVE)
+            constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+#else
+            constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#endif
+
+            auto const addr = ::mmap(nullptr, len * sizeof(std::uint64_t), PROT_READ | PROT_WRITE, flags, -1, 0);
+
+            if (addr == MAP_FAILED)
+                throw std::bad_alloc{};
+
+            words_ = static_cast<std::uint64_t *>(addr);
+#else
+            words_ = new std::uint64_t[len]{};
+#endif
+        }
+
+        inline void deallocate(std::size_t len) noexcept
+        {
+            if (!words_)
+                return;
+
+#if defined(TNT_MMAP_STORAGE)
+            ::munmap(words_, len * sizeof(std::uint64_t));
+#else
+            (void)len;
+            delete[] words_;
+#endif
+
+            words_ = nullptr;
+        }
+
+        inline void clear(std::size_t len) noexcept
+        {
+#if defined(TNT_MMAP_STORAGE) && defined(__linux__) && defined(MADV_DONTNEED)
+            // private anonymous pages read back as zeros once dropped.
+            if (len != 0 && ::madvise(words_, len * sizeof(std::uint64_t), MADV_DONTNEED) == 0)
+                return;
+#endif
+
+            std::fill_n(words_, len, 0);
+        }
+
+        inline std::uint64_t *words() noexcept
+        {
+            return words_;
+        }
+
+        inline std::uint64_t const *words() const noexcept
+        {
+            return words_;
+        }
+
+        static inline void set(std::uint64_t *word, std::uint64_t mask) noexcept
+        {
+            *word |= mask;
+        }
+
+        static inline std::uint64_t load(std::uint64_t const *word) noexcept
+        {
+            return *word;
+        }
+
+        friend inline void swap(mmap_storage &lhs, mmap_storage &rhs) noexcept
+        {
+            std::swap(lhs.words_, rhs.words_);
+        }
+
+    private:
+        std::uint64_t *words_{};
+    };
+
+    /// @brief A bloom filter whose bits live in an anonymous memory mapping. See `tnt::mmap_storage`.
+    /// @tparam T The type of the elements to be inserted into the bloom filter.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    template <typename T, typename Hash = std::hash<T>>
+    using mapped_bloom = basic_bloom<T, Hash, classic_layout, modulo_reducer, early_exit_probe, mmap_storage>;
+}
+
+#undef TNT_MMAP_STORAGE
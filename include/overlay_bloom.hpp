@@ -0,0 +1,407 @@
+
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+
+#include "bloom_filter.hpp"
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // A sparse set of bit masks keyed by word index, stored as an open-addressing table of (index + 1, mask) pairs,
+    // so that both halves of a slot share a cache line. An index of zero marks an empty slot.
+    template <typename Alloc>
+    class word_delta final
+        : private Alloc
+    {
+    public:
+        inline explicit word_delta(Alloc const &alloc) noexcept
+            : Alloc(alloc)
+        {
+        }
+
+        inline word_delta(word_delta const &rhs)
+            : Alloc(rhs),
+              capacity{rhs.capacity},
+              count{rhs.count}
+        {
+            if (capacity)
+            {
+                slots = Alloc::allocate(capacity * 2);
+                std::copy_n(rhs.slots, capacity * 2, slots);
+            }
+        }
+
+        inline word_delta(word_delta &&rhs) noexcept
+            : Alloc(rhs)
+        {
+            swap(*this, rhs);
+        }
+
+        inline word_delta &operator=(word_delta rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        inline ~word_delta() noexcept
+        {
+            if (capacity)
+                Alloc::deallocate(slots, capacity * 2);
+        }
+
+        // the slot where the given word would be looked up first.
+        inline std::uint64_t const *slot_of(std::size_t word) const noexcept
+        {
+            return slots + (home(word) << 1);
+        }
+
+        // the mask of the given word, or zero if it has none.
+        inline std::uint64_t find(std::size_t word) const noexcept
+        {
+            if (count == 0)
+                return 0;
+
+            for (auto i = home(word);; i = (i + 1) & (capacity - 1))
+            {
+                auto const key = slots[i << 1];
+
+                if (key == word + 1)
+                    return slots[(i << 1) + 1];
+
+                if (key == 0)
+                    return 0;
+            }
+        }
+
+        // add the bits of `mask` to the mask of the given word.
+        inline void set(std::size_t word, std::uint64_t mask)
+        {
+            // keep the table at most half full, so that lookups of missing words stop early.
+            if ((count + 1) * 2 > capacity)
+                grow();
+
+            auto const i = locate(word);
+
+            count += slots[i << 1] == 0;
+            slots[i << 1] = word + 1;
+            slots[(i << 1) + 1] |= mask;
+        }
+
+        // call `f(word, mask)` for each word of the set.
+        template <typename F>
+        inline void for_each(F &&f) const
+        {
+            for (std::size_t i{}; i < capacity; ++i)
+            {
+                if (slots[i << 1] != 0)
+                    f(static_cast<std::size_t>(slots[i << 1] - 1), slots[(i << 1) + 1]);
+            }
+        }
+
+        inline std::size_t size() const noexcept
+        {
+            return count;
+        }
+
+        inline std::size_t bytes() const noexcept
+        {
+            return capacity * 2 * sizeof(std::uint64_t);
+        }
+
+        inline void clear() noexcept
+        {
+            std::fill_n(slots, capacity * 2, 0);
+            count = 0;
+        }
+
+        friend inline void swap(word_delta &lhs, word_delta &rhs) noexcept
+        {
+            std::swap(lhs.slots, rhs.slots);
+            std::swap(lhs.capacity, rhs.capacity);
+            std::swap(lhs.count, rhs.count);
+            std::swap(static_cast<Alloc &>(lhs), static_cast<Alloc &>(rhs));
+        }
+
+    private:
+        inline std::size_t home(std::size_t word) const noexcept
+        {
+            return static_cast<std::size_t>(mix64(word)) & (capacity - 1);
+        }
+
+        // the slot holding the given word, or the empty slot where it belongs.
+        inline std::size_t locate(std::size_t word) const noexcept
+        {
+            auto i = home(word);
+
+            while (slots[i << 1] != 0 && slots[i << 1] != word + 1)
+                i = (i + 1) & (capacity - 1);
+
+            return i;
+        }
+
+        inline void grow()
+        {
+            auto const old_slots = slots;
+            auto const old_capacity = capacity;
+
+            capacity = capacity ? capacity * 2 : 16;
+            slots = Alloc::allocate(capacity * 2);
+            std::fill_n(slots, capacity * 2, 0);
+
+            for (std::size_t i{}; i < old_capacity; ++i)
+            {
+                if (old_slots[i << 1] != 0)
+                {
+                    auto const j = locate(static_cast<std::size_t>(old_slots[i << 1] - 1));
+
+                    slots[j << 1] = old_slots[i << 1];
+                    slots[(j << 1) + 1] = old_slots[(i << 1) + 1];
+                }
+            }
+
+            if (old_capacity)
+                Alloc::deallocate(old_slots, old_capacity * 2);
+        }
+
+        std::uint64_t *slots{};
+        std::size_t capacity{};
+        std::size_t count{};
+    };
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief A bloom filter made of a shared, read-only base filter and a small private delta, for many filters that hold a large common set plus a few keys of their own (eg. one per tenant).
+    /// The delta only keeps the words of the bit array where the overlay set bits that the base does not have, so each overlay costs memory in proportion to its own keys,
+    /// instead of a full copy of the base. It matches exactly like a copy of the base into which the same values were inserted.
+    /// Queries compute all the probe positions first and prefetch them in both the base and the delta, so that their cache misses overlap.
+    /// @tparam T The type of the elements to be inserted into the filter.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    /// @tparam Alloc The allocator of the base filter, also used for the delta. Defaults to std::allocator.
+    template <
+        typename T,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class overlay_bloom final
+        : private utils::deduce_allocator<Alloc>::type
+    {
+        using allocator_type = typename utils::deduce_allocator<Alloc>::type;
+
+        // probe positions are computed and prefetched this many at a time.
+        inline static constexpr std::size_t probe_group = 8;
+
+    public:
+        /// @brief The type of the base filter.
+        using base_type = bloom_filter<T, Hash, Alloc>;
+
+        /// @brief Construct an overlay with an empty delta over the given base.
+        /// @param base The base filter, which must not be changed while overlays use it.
+        /// @param alloc The allocator to be used for the delta.
+        /// @throw std::invalid_argument if there is no base.
+        inline explicit overlay_bloom(
+            std::shared_ptr<base_type const> base,
+            allocator_type const &alloc = allocator_type{})
+            : allocator_type(alloc),
+              shared{std::move(base)},
+              delta{alloc}
+        {
+            if (!shared)
+                throw std::invalid_argument{"An overlay needs a base filter!"};
+        }
+
+        /// @brief Add the value into the overlay. The base is left untouched.
+        inline void insert(T const &value)
+        {
+            insert_hash(hash_function()(value));
+        }
+
+        /// @brief Add a value into the overlay, given its hash computed with `hash_function()`.
+        inline void insert_hash(std::size_t hash)
+        {
+            auto const &base = *shared;
+            auto const step = hash & utils::size_traits::low_mask;
+
+            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            for (std::size_t i{}; i < base.k; ++i)
+            {
+                h += i * step;
+
+                auto const index = base.reduce(h);
+                auto const bit = std::uint64_t{1} << (index & 63);
+
+                if ((base.words()[index >> 6] & bit) == 0)
+                    delta.set(index >> 6, bit);
+            }
+
+            ++inserts;
+        }
+
+        /// @brief Check whether the given value *might* be present in the base or in the overlay. While this function can return false positives, it will never return false negatives.
+        /// Ie. `matches(x)` might be wrong, but `!matches(x)` is always correct.
+        /// @param value The value to check.
+        template <typename U>
+        inline bool matches(U &&value) const noexcept
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            return matches_hash(hash_function()(value));
+        }
+
+        /// @brief Check whether a value *might* be present in the base or in the overlay, given its hash computed with `hash_function()`.
+        inline bool matches_hash(std::size_t hash) const noexcept
+        {
+            auto const &base = *shared;
+            auto const step = hash & utils::size_traits::low_mask;
+            auto const sparse = delta.size() != 0;
+
+            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            std::size_t index[probe_group];
+
+            for (std::size_t i{}; i < base.k; i += probe_group)
+            {
+                auto const n = base.k - i < probe_group ? base.k - i : probe_group;
+
+                for (std::size_t j{}; j < n; ++j)
+                {
+                    h += (i + j) * step;
+                    index[j] = base.reduce(h);
+
+                    utils::prefetch(base.words() + (index[j] >> 6));
+
+                    if (sparse)
+                        utils::prefetch(delta.slot_of(index[j] >> 6));
+                }
+
+                for (std::size_t j{}; j < n; ++j)
+                {
+                    auto const bit = std::uint64_t{1} << (index[j] & 63);
+
+                    // the delta is only looked up for the bits the base does not have.
+                    if ((base.words()[index[j] >> 6] & bit) == 0 && (!sparse || (delta.find(index[j] >> 6) & bit) == 0))
+                        return false;
+                }
+            }
+
+            return true;
+        }
+
+        /// @brief Fold the delta into a copy of the base, which becomes the base of this overlay, and empty the delta.
+        /// Other overlays of the old base are not affected, and can move to the new base with `rebase`.
+        /// @return The new base.
+        inline std::shared_ptr<base_type const> compact()
+        {
+            auto next = std::make_shared<base_type>(*shared);
+
+            delta.for_each(
+                [&next](std::size_t word, std::uint64_t mask)
+                { next->words()[word] |= mask; });
+
+            shared = std::move(next);
+            delta.clear();
+
+            return shared;
+        }
+
+        /// @brief Move the overlay onto another base with the same size and number of hash functions, such as one returned by `compact`.
+        /// The delta keeps the bits that the new base does not have, so the overlay still matches everything it matched before if the new base contains the old one.
+        /// @param base The new base.
+        /// @throw std::invalid_argument if there is no base, or if its size or number of hash functions differs.
+        inline void rebase(std::shared_ptr<base_type const> base)
+        {
+            if (!base || base->m != shared->m || base->k != shared->k)
+                throw std::invalid_argument{"The new base must have the same size and number of hash functions!"};
+
+            utils::word_delta<allocator_type> next{static_cast<allocator_type const &>(*this)};
+
+            delta.for_each(
+                [&next, &base](std::size_t word, std::uint64_t mask)
+                {
+                    if (auto const rest = mask & ~base->words()[word]; rest != 0)
+                        next.set(word, rest);
+                });
+
+            shared = std::move(base);
+            swap(delta, next);
+
+            // the new base might not contain the old one, so previous results are no longer valid.
+            ++rebases;
+        }
+
+        /// @brief The base of the overlay.
+        inline std::shared_ptr<base_type const> const &base() const noexcept
+        {
+            return shared;
+        }
+
+        /// @brief The number of 64-bit words of the bit array held by the delta.
+        inline std::size_t delta_words() const noexcept
+        {
+            return delta.size();
+        }
+
+        /// @brief The memory taken by the delta, in bytes.
+        inline std::size_t delta_bytes() const noexcept
+        {
+            return delta.bytes();
+        }
+
+        /// @brief The hash function used by the filter, the one of the base.
+        inline Hash const &hash_function() const noexcept
+        {
+            return shared->hash_function();
+        }
+
+        /// @brief A counter that changes whenever an element is inserted. A value that did not match keeps not matching as long as the version stays the same.
+        inline std::size_t version() const noexcept
+        {
+            return inserts;
+        }
+
+        /// @brief A counter that changes whenever the overlay moves to another base. A value that matched keeps matching as long as the generation stays the same.
+        inline std::size_t generation() const noexcept
+        {
+            return rebases;
+        }
+
+        /// @brief Swap the contents of two overlays together.
+        friend inline void swap(overlay_bloom &lhs, overlay_bloom &rhs) noexcept
+        {
+            using std::swap;
+
+            swap(lhs.shared, rhs.shared);
+            swap(lhs.delta, rhs.delta);
+            swap(lhs.inserts, rhs.inserts);
+            swap(lhs.rebases, rhs.rebases);
+            swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+        }
+
+    private:
+        std::shared_ptr<base_type const> shared;
+        utils::word_delta<allocator_type> delta;
+        std::size_t inserts{};
+        std::size_t rebases{};
+    };
+
+    namespace pmr
+    {
+        /// @brief Specialization of overlay_bloom using a polymorphic allocator.
+        /// @tparam T The type of the elements to be inserted into the filter.
+        /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+        template <typename T, typename Hash = std::hash<T>>
+        using overlay_bloom = tnt::overlay_bloom<
+            T, Hash,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
+    }
+}
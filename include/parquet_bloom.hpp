@@ -0,0 +1,452 @@
+
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+#include "bloom_filter.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__cpp_constexpr_dynamic_alloc) && (__cpp_constexpr_dynamic_alloc >= 201907L)
+#define CONST_ALLOC constexpr
+#else
+#define CONST_ALLOC inline
+#endif
+
+#if defined(__cpp_lib_constexpr_algorithms) && (__cpp_lib_constexpr_algorithms >= 202306L)
+#define CONST_SWAP constexpr
+#else
+#define CONST_SWAP inline
+#endif
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    constexpr std::uint64_t rotl64(std::uint64_t x, int r) noexcept
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    // XXH64 by Yann Collet, the hash function of Parquet bloom filters.
+    inline std::uint64_t xxhash64(void const *data, std::size_t len, std::uint64_t seed = 0) noexcept
+    {
+        constexpr std::uint64_t p1 = 0x9e3779b185ebca87;
+        constexpr std::uint64_t p2 = 0xc2b2ae3d27d4eb4f;
+        constexpr std::uint64_t p3 = 0x165667b19e3779f9;
+        constexpr std::uint64_t p4 = 0x85ebca77c2b2ae63;
+        constexpr std::uint64_t p5 = 0x27d4eb2f165667c5;
+
+        auto const round = [](std::uint64_t acc, std::uint64_t input)
+        {
+            return rotl64(acc + input * p2, 31) * p1;
+        };
+
+        auto const merge = [&](std::uint64_t acc, std::uint64_t value)
+        {
+            return (acc ^ round(0, value)) * p1 + p4;
+        };
+
+        auto p = static_cast<unsigned char const *>(data);
+        auto const end = p + len;
+
+        std::uint64_t h;
+
+        if (len >= 32)
+        {
+            std::uint64_t v1 = seed + p1 + p2;
+            std::uint64_t v2 = seed + p2;
+            std::uint64_t v3 = seed;
+            std::uint64_t v4 = seed - p1;
+
+            for (; end - p >= 32; p += 32)
+            {
+                v1 = round(v1, load_le64(p));
+                v2 = round(v2, load_le64(p + 8));
+                v3 = round(v3, load_le64(p + 16));
+                v4 = round(v4, load_le64(p + 24));
+            }
+
+            h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+            h = merge(h, v1);
+            h = merge(h, v2);
+            h = merge(h, v3);
+            h = merge(h, v4);
+        }
+        else
+            h = seed + p5;
+
+        h += len;
+
+        for (; end - p >= 8; p += 8)
+            h = rotl64(h ^ round(0, load_le64(p)), 27) * p1 + p4;
+
+        if (end - p >= 4)
+        {
+            h = rotl64(h ^ (load_le32(p) * p1), 23) * p2 + p3;
+            p += 4;
+        }
+
+        for (; p != end; ++p)
+            h = rotl64(h ^ (*p * p5), 11) * p1;
+
+        h ^= h >> 33;
+        h *= p2;
+        h ^= h >> 29;
+        h *= p3;
+        h ^= h >> 32;
+
+        return h;
+    }
+
+    // A block of a split-block bloom filter: 8 little-endian 32-bit words, with one bit set in each word.
+    struct sbbf_block final
+    {
+        inline static constexpr std::size_t bytes = 32;
+
+        inline static constexpr std::uint32_t salt[8]{
+            0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+            0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31};
+
+        // the block of the given hash, out of `count` blocks.
+        static inline std::size_t index(std::uint64_t hash, std::size_t count) noexcept
+        {
+            return static_cast<std::size_t>(((hash >> 32) * count) >> 32);
+        }
+
+        static inline void insert(unsigned char *block, std::uint32_t key) noexcept
+        {
+            for (std::size_t i{}; i < 8; ++i)
+            {
+                auto const word = block + i * 4;
+                store_le32(word, load_le32(word) | std::uint32_t{1} << ((key * salt[i]) >> 27));
+            }
+        }
+
+        static inline bool check(unsigned char const *block, std::uint32_t key) noexcept
+        {
+#if defined(__AVX2__)
+            // x86 is little-endian, so the block can be loaded as it is.
+            auto const salts = _mm256_setr_epi32(
+                0x47b6137b, 0x44974d91, static_cast<int>(0x8824ad5b), static_cast<int>(0xa2b7289d),
+                0x705495c7, 0x2df1424b, static_cast<int>(0x9efc4947), 0x5c6bfb31);
+
+            auto const shifts = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(key)), salts), 27);
+            auto const mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+
+            return _mm256_testc_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(block)), mask);
+#else
+            bool found{true};
+
+            for (std::size_t i{}; i < 8; ++i)
+                found = found && (load_le32(block + i * 4) >> ((key * salt[i]) >> 27)) & 1;
+
+            return found;
+#endif
+        }
+    };
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief The hash function of Parquet bloom filters: XXH64 with a seed of 0, over the plain encoding of the value.
+    /// Integers of up to 32 bits are hashed as Parquet `INT32`, 64-bit integers as `INT64`, `float` and `double` as `FLOAT` and `DOUBLE`,
+    /// and strings (anything convertible to `std::string_view`) as `BYTE_ARRAY`, without the length prefix.
+    struct parquet_hash
+    {
+        using is_transparent = void;
+
+        template <typename T>
+        inline std::size_t operator()(T const &value) const noexcept
+        {
+            static_assert(
+                std::is_arithmetic_v<T> || std::is_convertible_v<T const &, std::string_view>,
+                "Only numbers and strings can be hashed the way Parquet does!");
+
+            if constexpr (std::is_convertible_v<T const &, std::string_view>)
+            {
+                std::string_view const bytes = value;
+                return static_cast<std::size_t>(utils::xxhash64(bytes.data(), bytes.size()));
+            }
+            else
+            {
+                using bits_type = std::conditional_t<
+                    std::is_floating_point_v<T>,
+                    std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>,
+                    std::conditional_t<sizeof(T) <= 4, std::uint32_t, std::uint64_t>>;
+
+                bits_type bits;
+
+                if constexpr (std::is_floating_point_v<T>)
+                {
+                    static_assert(sizeof(T) == 4 || sizeof(T) == 8, "Only float and double can be hashed the way Parquet does!");
+                    std::memcpy(&bits, &value, sizeof(bits));
+                }
+                else
+                {
+                    // smaller integers are widened to INT32 (sign-extended if signed).
+                    using wide_type = std::conditional_t<std::is_signed_v<T>, std::make_signed_t<bits_type>, bits_type>;
+                    bits = static_cast<bits_type>(static_cast<wide_type>(value));
+                }
+
+                unsigned char bytes[sizeof(bits)];
+
+                for (std::size_t i{}; i < sizeof(bits); ++i)
+                    bytes[i] = static_cast<unsigned char>(bits >> (i * 8));
+
+                return static_cast<std::size_t>(utils::xxhash64(bytes, sizeof(bytes)));
+            }
+        }
+    };
+
+    /// @brief Calculate the size of a Parquet bloom filter bitset, the same way Parquet writers do.
+    /// @param ndv The number of distinct values to be inserted.
+    /// @param eps The desired false positive rate.
+    /// @return The size of the bitset in bytes: a power of two between 32 bytes and 128 MiB.
+    inline std::size_t parquet_bloom_bytes(std::size_t ndv, float eps) noexcept
+    {
+        constexpr std::size_t min_bytes = 32;
+        constexpr std::size_t max_bytes = std::size_t{128} << 20;
+
+        auto const bits = -8.0 * static_cast<double>(ndv) / std::log(1.0 - std::pow(static_cast<double>(eps), 1.0 / 8));
+        auto bytes = static_cast<std::size_t>(bits / 8 < static_cast<double>(max_bytes) ? bits / 8 : static_cast<double>(max_bytes));
+
+        std::size_t size{min_bytes};
+
+        while (size < bytes && size < max_bytes)
+            size <<= 1;
+
+        return size;
+    }
+
+    /// @brief A read-only view over the bitset of a Parquet split-block bloom filter, eg. read straight from a Parquet file or a memory-mapped one.
+    /// The bitset is used in place and never copied, so it must outlive the view.
+    /// Only the bitset is read: the Thrift `BloomFilterHeader` before it in the file must be parsed by the caller, which is also where its size comes from.
+    /// @tparam T The type of the values of the column.
+    /// @tparam Hash The hash function used to write the filter. Defaults to `tnt::parquet_hash`, which is the only one Parquet defines.
+    template <
+        typename T,
+        typename Hash = parquet_hash>
+    class parquet_bloom_view final
+        : private Hash
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+    public:
+        /// @brief Wrap an existing bitset.
+        /// @param data The beginning of the bitset. It does not need to be aligned.
+        /// @param size The size of the bitset, in bytes.
+        /// @param hash The hash function used to write the filter.
+        /// @throw std::invalid_argument if the size is not a non-zero multiple of 32 bytes.
+        parquet_bloom_view(void const *data, std::size_t size, Hash const &hash = Hash{})
+            : Hash(hash),
+              bytes{static_cast<unsigned char const *>(data)},
+              blocks{size / utils::sbbf_block::bytes}
+        {
+            if (size == 0 || size % utils::sbbf_block::bytes != 0)
+                throw std::invalid_argument{"A Parquet bloom filter must be made of 32-byte blocks!"};
+        }
+
+        /// @brief Check whether the given value *might* be present in the filter. While this function can return false positives, it will never return false negatives.
+        /// @param value The value to check.
+        template <typename U>
+        inline bool matches(U &&value) const noexcept
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            // numbers are hashed through their Parquet type, so `matches(7)` works on an INT64 column.
+            if constexpr (std::is_arithmetic_v<raw_u> && std::is_arithmetic_v<T>)
+                return matches_hash(static_cast<Hash const &>(*this)(static_cast<T>(value)));
+            else
+                return matches_hash(static_cast<Hash const &>(*this)(value));
+        }
+
+        /// @brief Check whether a value *might* be present in the filter, given its 64-bit hash.
+        inline bool matches_hash(std::uint64_t hash) const noexcept
+        {
+            auto const block = bytes + utils::sbbf_block::index(hash, blocks) * utils::sbbf_block::bytes;
+            return utils::sbbf_block::check(block, static_cast<std::uint32_t>(hash));
+        }
+
+        /// @brief The beginning of the bitset.
+        inline void const *data() const noexcept
+        {
+            return bytes;
+        }
+
+        /// @brief The size of the bitset, in bytes.
+        inline std::size_t size() const noexcept
+        {
+            return blocks * utils::sbbf_block::bytes;
+        }
+
+    private:
+        unsigned char const *bytes;
+        std::size_t blocks;
+    };
+
+    /// @brief A Parquet split-block bloom filter, whose bitset can be written as it is into a Parquet file.
+    /// Each value sets 8 bits in a single 32-byte block, with the hashing and the layout of the Parquet format specification, so that any Parquet reader can use it.
+    /// @tparam T The type of the values of the column.
+    /// @tparam Hash The hash function to be used. Defaults to `tnt::parquet_hash`, which is the only one Parquet readers understand.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        typename Hash = parquet_hash,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class parquet_bloom final
+        : private Hash,
+          private std::allocator_traits<Alloc>::template rebind_alloc<unsigned char>
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<unsigned char>;
+
+    public:
+        /// @brief Construct an empty filter, sized the way Parquet writers size it.
+        /// @param ndv The number of distinct values to be inserted.
+        /// @param eps The desired false positive rate. Defaults to 0.01 (1% false positives).
+        /// @param hash The hash function to be used for hashing the elements.
+        /// @param alloc The allocator to be used for memory management.
+        CONST_ALLOC parquet_bloom(
+            std::size_t ndv,
+            float eps = 0.01f,
+            Hash const &hash = Hash{},
+            allocator_type const &alloc = allocator_type{})
+            : Hash(hash),
+              allocator_type(alloc),
+              len{parquet_bloom_bytes(ndv, eps)}
+        {
+            bytes = allocator_type::allocate(len);
+            std::fill_n(bytes, len, 0);
+        }
+
+        /// @brief The copy constructor.
+        CONST_ALLOC parquet_bloom(parquet_bloom const &rhs)
+            : Hash(rhs),
+              allocator_type(rhs),
+              len{rhs.len}
+        {
+            bytes = allocator_type::allocate(len);
+            std::copy_n(rhs.bytes, len, bytes);
+        }
+
+        /// @brief The copy assignment operator.
+        CONST_ALLOC parquet_bloom &operator=(parquet_bloom const &rhs)
+        {
+            parquet_bloom tmp{rhs};
+            swap(*this, tmp);
+
+            return *this;
+        }
+
+        /// @brief The move constructor.
+        CONST_SWAP parquet_bloom(parquet_bloom &&rhs) noexcept
+            : Hash(rhs),
+              allocator_type(rhs)
+        {
+            swap(*this, rhs);
+        }
+
+        /// @brief The move assignment operator.
+        CONST_SWAP parquet_bloom &operator=(parquet_bloom &&rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        /// @brief The destructor.
+        CONST_ALLOC ~parquet_bloom() noexcept
+        {
+            if (bytes)
+                allocator_type::deallocate(bytes, len);
+        }
+
+        /// @brief Add the value into the filter.
+        inline void insert(T const &value) noexcept
+        {
+            insert_hash(static_cast<Hash const &>(*this)(value));
+        }
+
+        /// @brief Add a value into the filter, given its 64-bit hash.
+        inline void insert_hash(std::uint64_t hash) noexcept
+        {
+            auto const block = bytes + utils::sbbf_block::index(hash, len / utils::sbbf_block::bytes) * utils::sbbf_block::bytes;
+            utils::sbbf_block::insert(block, static_cast<std::uint32_t>(hash));
+        }
+
+        /// @brief Check whether the given value *might* be present in the filter. While this function can return false positives, it will never return false negatives.
+        /// @param value The value to check.
+        template <typename U>
+        inline bool matches(U &&value) const noexcept
+        {
+            return view().matches(static_cast<U &&>(value));
+        }
+
+        /// @brief Remove all elements from the filter.
+        inline void clear() noexcept
+        {
+            std::fill_n(bytes, len, 0);
+        }
+
+        /// @brief A view over the bitset of the filter. It is invalidated when the filter is destroyed, assigned to or swapped.
+        inline parquet_bloom_view<T, Hash> view() const noexcept
+        {
+            return parquet_bloom_view<T, Hash>{bytes, len, static_cast<Hash const &>(*this)};
+        }
+
+        /// @brief The bitset of the filter, ready to be written into a Parquet file after its `BloomFilterHeader`.
+        inline void const *data() const noexcept
+        {
+            return bytes;
+        }
+
+        /// @brief The size of the bitset, in bytes. This is the `numBytes` field of the `BloomFilterHeader`.
+        inline std::size_t size() const noexcept
+        {
+            return len;
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend CONST_SWAP void swap(parquet_bloom &lhs, parquet_bloom &rhs) noexcept
+        {
+            std::swap(static_cast<Hash &>(lhs), static_cast<Hash &>(rhs));
+            std::swap(lhs.len, rhs.len);
+            std::swap(lhs.bytes, rhs.bytes);
+            std::swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+        }
+
+    private:
+        std::size_t len{};
+        unsigned char *bytes{};
+    };
+
+    namespace pmr
+    {
+        /// @brief Specialization of parquet_bloom using a polymorphic allocator.
+        /// @tparam T The type of the values of the column.
+        /// @tparam Hash The hash function to be used. Defaults to `tnt::parquet_hash`.
+        template <typename T, typename Hash = parquet_hash>
+        using parquet_bloom = tnt::parquet_bloom<
+            T, Hash,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
+    }
+}
+
+#undef CONST_ALLOC
+#undef CONST_SWAP
@@ -0,0 +1,313 @@
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "bloom_filter.hpp"
+
+namespace tnt
+{
+    /// @brief A static membership filter built from a perfect hash function (PTHash, Pibiri and Trani) and an array of fingerprints.
+    /// A lookup computes the slot of the key with the perfect hash function, then compares the fingerprint stored in that slot.
+    /// That is two memory accesses per query: one for the pilot of the bucket of the key, and one for the fingerprint.
+    /// With 8-bit fingerprints the filter uses about 12 bits per key and has a false positive rate of about 0.4%.
+    /// Keys are split into independent partitions, which are built in parallel.
+    /// @tparam T The type of the keys.
+    /// @tparam Fingerprint The unsigned type used to store fingerprints. Defaults to std::uint8_t, ie. a false positive rate of 1/255.
+    /// @tparam Hash The hash function to be used for hashing the keys. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        typename Fingerprint = std::uint8_t,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class perfect_hash_filter final : private Hash
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        static_assert(
+            std::is_unsigned_v<Fingerprint>,
+            "Fingerprints must be stored in an unsigned integer type!");
+
+        template <typename U>
+        using vector_type = std::vector<U, typename std::allocator_traits<Alloc>::template rebind_alloc<U>>;
+
+        using pilot_type = std::uint16_t;
+
+        inline static constexpr std::size_t partition_keys = 1 << 16;
+        inline static constexpr std::size_t max_pilot = 0xffff;
+        inline static constexpr std::size_t max_seeds = 16;
+
+    public:
+        /// @brief Build the filter from a range of keys. Duplicate keys are allowed.
+        /// @param first The beginning of the range of keys.
+        /// @param last The end of the range of keys.
+        /// @param threads The number of threads used to build the partitions. Defaults to the number of hardware threads.
+        /// @param hash The hash function to be used for hashing the keys.
+        /// @param alloc The allocator to be used for memory management.
+        /// @throw std::invalid_argument if a partition cannot be placed with any seed, eg. because distinct keys have colliding hashes.
+        template <typename It>
+        perfect_hash_filter(
+            It first, It last,
+            std::size_t threads = std::thread::hardware_concurrency(),
+            Hash const &hash = Hash{},
+            Alloc const &alloc = Alloc{})
+            : Hash(hash),
+              slot_offsets(alloc),
+              bucket_offsets(alloc),
+              seeds(alloc),
+              pilots(alloc),
+              fingerprints(alloc)
+        {
+            vector_type<std::uint64_t> hashes(alloc);
+
+            for (; first != last; ++first)
+                hashes.push_back(utils::mix64(static_cast<Hash const &>(*this)(*first)));
+
+            auto const n = hashes.size();
+            partitions = n / partition_keys + 1;
+
+            // counting sort of the hashes by partition.
+            vector_type<std::size_t> key_offsets(partitions + 1, 0, alloc);
+
+            for (auto const h : hashes)
+                ++key_offsets[partition(h) + 1];
+
+            for (std::size_t p{}; p < partitions; ++p)
+                key_offsets[p + 1] += key_offsets[p];
+
+            vector_type<std::uint64_t> sorted(n, 0, alloc);
+
+            {
+                auto cursor = key_offsets;
+
+                for (auto const h : hashes)
+                    sorted[cursor[partition(h)]++] = h;
+            }
+
+            // the sizes of the partitions are known upfront, so that each partition can be built in place.
+            slot_offsets.assign(partitions + 1, 0);
+            bucket_offsets.assign(partitions + 1, 0);
+            seeds.assign(partitions, 0);
+
+            for (std::size_t p{}; p < partitions; ++p)
+            {
+                auto const size = key_offsets[p + 1] - key_offsets[p];
+
+                slot_offsets[p + 1] = slot_offsets[p] + table_size(size);
+                bucket_offsets[p + 1] = bucket_offsets[p] + bucket_count(size);
+            }
+
+            pilots.assign(bucket_offsets.back(), 0);
+            fingerprints.assign(slot_offsets.back(), 0);
+
+            std::atomic<std::size_t> next{};
+            std::atomic<bool> failed{};
+
+            auto const worker = [&]
+            {
+                for (auto p = next++; p < partitions && !failed; p = next++)
+                {
+                    if (!build(p, sorted.data() + key_offsets[p], sorted.data() + key_offsets[p + 1]))
+                        failed = true;
+                }
+            };
+
+            threads = threads == 0 ? 1 : (threads < partitions ? threads : partitions);
+
+            std::vector<std::thread> pool;
+
+            for (std::size_t i{1}; i < threads; ++i)
+                pool.emplace_back(worker);
+
+            worker();
+
+            for (auto &thread : pool)
+                thread.join();
+
+            if (failed)
+                throw std::invalid_argument{"Cannot build the perfect hash function: no seed places every key!"};
+        }
+
+        /// @brief Check whether the given key *might* be part of the set. While this function can return false positives, it will never return false negatives.
+        /// @param key The key to check.
+        template <typename U>
+        bool matches(U &&key) const noexcept
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            auto const h = utils::mix64(static_cast<Hash const &>(*this)(key));
+            auto const p = partition(h);
+
+            auto const buckets = bucket_offsets[p + 1] - bucket_offsets[p];
+            auto const slots = slot_offsets[p + 1] - slot_offsets[p];
+
+            auto const pilot = pilots[bucket_offsets[p] + bucket(h, buckets)];
+
+            return fingerprints[slot_offsets[p] + position(h, pilot, seeds[p], slots)] == fingerprint(h);
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend void swap(perfect_hash_filter &lhs, perfect_hash_filter &rhs) noexcept
+        {
+            std::swap(static_cast<Hash &>(lhs), static_cast<Hash &>(rhs));
+            std::swap(lhs.partitions, rhs.partitions);
+            lhs.slot_offsets.swap(rhs.slot_offsets);
+            lhs.bucket_offsets.swap(rhs.bucket_offsets);
+            lhs.seeds.swap(rhs.seeds);
+            lhs.pilots.swap(rhs.pilots);
+            lhs.fingerprints.swap(rhs.fingerprints);
+        }
+
+    private:
+        // PTHash parameters: a load factor of 0.97, and about 3.5 * n / log2(n) buckets.
+        static std::size_t table_size(std::size_t n) noexcept
+        {
+            return n + n * 3 / 100 + 1;
+        }
+
+        static std::size_t bucket_count(std::size_t n) noexcept
+        {
+            return static_cast<std::size_t>(3.5 * n / std::log2(n + 2.0)) + 1;
+        }
+
+        std::size_t partition(std::uint64_t h) const noexcept
+        {
+            return static_cast<std::size_t>(((h >> 32) * partitions) >> 32);
+        }
+
+        // the skewed bucket assignment of PTHash: 60% of the keys go to the first 30% of the buckets.
+        static std::size_t bucket(std::uint64_t h, std::size_t buckets) noexcept
+        {
+            auto const x = static_cast<std::uint32_t>(h);
+            auto const dense = buckets * 3 / 10;
+
+            if (x < 0x9999'9999u)
+                return static_cast<std::size_t>((std::uint64_t{x} * dense) >> 32);
+
+            return dense + static_cast<std::size_t>((utils::mix64(x) >> 32) * (buckets - dense) >> 32);
+        }
+
+        static std::size_t position(std::uint64_t h, pilot_type pilot, std::uint8_t seed, std::size_t slots) noexcept
+        {
+            auto const mixed = utils::mix64(h ^ utils::mix64(pilot + (std::uint64_t{seed} << 16)));
+            return static_cast<std::size_t>(((mixed >> 32) * slots) >> 32);
+        }
+
+        // 0 marks an empty slot, so that keys hashing to an empty slot are always rejected.
+        static Fingerprint fingerprint(std::uint64_t h) noexcept
+        {
+            auto const fp = static_cast<Fingerprint>(utils::mix64(~h));
+            return fp == 0 ? Fingerprint{1} : fp;
+        }
+
+        // place the keys of a partition, or return false if no seed works.
+        bool build(std::size_t p, std::uint64_t *first, std::uint64_t *last)
+        {
+            std::sort(first, last);
+            last = std::unique(first, last);
+
+            auto const buckets = bucket_offsets[p + 1] - bucket_offsets[p];
+            auto const slots = slot_offsets[p + 1] - slot_offsets[p];
+
+            // group the keys by bucket, and place the biggest buckets first.
+            std::vector<std::pair<std::size_t, std::uint64_t>> keys;
+            keys.reserve(static_cast<std::size_t>(last - first));
+
+            for (auto it = first; it != last; ++it)
+                keys.emplace_back(bucket(*it, buckets), *it);
+
+            std::sort(keys.begin(), keys.end());
+
+            std::vector<std::pair<std::size_t, std::size_t>> order;
+
+            for (std::size_t i{}; i < keys.size();)
+            {
+                auto j = i;
+                while (j < keys.size() && keys[j].first == keys[i].first)
+                    ++j;
+
+                order.emplace_back(i, j);
+                i = j;
+            }
+
+            std::stable_sort(order.begin(), order.end(), [](auto const &lhs, auto const &rhs)
+                             { return lhs.second - lhs.first > rhs.second - rhs.first; });
+
+            auto const pilot_base = pilots.data() + bucket_offsets[p];
+            auto const fp_base = fingerprints.data() + slot_offsets[p];
+
+            std::vector<bool> taken(slots);
+            std::vector<std::size_t> positions;
+
+            bool ok{};
+
+            for (std::size_t seed{}; seed < max_seeds && !ok; ++seed)
+            {
+                std::fill(taken.begin(), taken.end(), false);
+
+                ok = true;
+
+                for (auto const &[begin, end] : order)
+                {
+                    ok = false;
+
+                    for (std::size_t pilot{}; pilot <= max_pilot && !ok; ++pilot)
+                    {
+                        positions.clear();
+                        ok = true;
+
+                        for (auto i = begin; i < end && ok; ++i)
+                        {
+                            auto const pos = position(keys[i].second, static_cast<pilot_type>(pilot), static_cast<std::uint8_t>(seed), slots);
+
+                            ok = !taken[pos] && std::find(positions.begin(), positions.end(), pos) == positions.end();
+                            positions.push_back(pos);
+                        }
+
+                        if (ok)
+                        {
+                            pilot_base[keys[begin].first] = static_cast<pilot_type>(pilot);
+
+                            for (auto const pos : positions)
+                                taken[pos] = true;
+                        }
+                    }
+
+                    if (!ok)
+                        break;
+                }
+
+                if (ok)
+                    seeds[p] = static_cast<std::uint8_t>(seed);
+            }
+
+            if (!ok)
+                return false;
+
+            for (auto const &[b, h] : keys)
+                fp_base[position(h, pilot_base[b], seeds[p], slots)] = fingerprint(h);
+
+            return true;
+        }
+
+        std::size_t partitions{};
+        vector_type<std::size_t> slot_offsets;
+        vector_type<std::size_t> bucket_offsets;
+        vector_type<std::uint8_t> seeds;
+        vector_type<pilot_type> pilots;
+        vector_type<Fingerprint> fingerprints;
+    };
+}
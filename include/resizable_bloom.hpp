@@ -0,0 +1,488 @@
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "bloom_filter.hpp"
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // A log of 64-bit hashes. Hashes are buffered until a chunk is full, then the chunk is sorted, deduplicated and
+    // stored as Rice-coded deltas: with a chunk of c hashes, deltas are about 2^64 / c, so each of them takes
+    // log2(2^64 / c) + 2 bits instead of 64, ie. about 52 bits with the default chunk size.
+    template <typename Alloc>
+    class hash_log final
+        : private Alloc
+    {
+        struct chunk final
+        {
+            std::uint64_t *words;
+            std::size_t length;
+            std::size_t count;
+            std::size_t shift;
+        };
+
+        using chunk_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<chunk>;
+
+    public:
+        // the number of hashes buffered before they are sorted and encoded.
+        inline static constexpr std::size_t chunk_size = std::size_t{1} << 14;
+
+        inline explicit hash_log(Alloc const &alloc)
+            : Alloc(alloc),
+              pending(alloc),
+              chunks(chunk_allocator(alloc))
+        {
+        }
+
+        inline hash_log(hash_log const &rhs)
+            : Alloc(rhs),
+              pending(rhs.pending),
+              chunks(chunk_allocator(rhs)),
+              sealed{rhs.sealed}
+        {
+            chunks.reserve(rhs.chunks.size());
+
+            for (auto const &c : rhs.chunks)
+            {
+                auto const words = Alloc::allocate(c.length);
+                std::copy_n(c.words, c.length, words);
+                chunks.push_back({words, c.length, c.count, c.shift});
+            }
+        }
+
+        inline hash_log(hash_log &&rhs) noexcept
+            : Alloc(rhs),
+              pending(std::move(rhs.pending)),
+              chunks(std::move(rhs.chunks)),
+              sealed{rhs.sealed}
+        {
+            rhs.chunks.clear();
+            rhs.sealed = 0;
+        }
+
+        inline hash_log &operator=(hash_log rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        inline ~hash_log() noexcept
+        {
+            release();
+        }
+
+        inline void append(std::uint64_t hash)
+        {
+            pending.push_back(hash);
+
+            if (pending.size() == chunk_size)
+                seal();
+        }
+
+        // the number of hashes in the log, where the duplicates of different chunks count more than once.
+        inline std::size_t size() const noexcept
+        {
+            return sealed + pending.size();
+        }
+
+        inline std::size_t bytes() const noexcept
+        {
+            auto total = pending.capacity() * sizeof(std::uint64_t) + chunks.capacity() * sizeof(chunk);
+
+            for (auto const &c : chunks)
+                total += c.length * sizeof(std::uint64_t);
+
+            return total;
+        }
+
+        inline std::size_t chunk_count() const noexcept
+        {
+            return chunks.size();
+        }
+
+        // write the hashes of the given chunk, in increasing order, and return how many were written (at most chunk_size).
+        inline std::size_t decode(std::size_t index, std::uint64_t *out) const noexcept
+        {
+            auto const &c = chunks[index];
+
+            std::size_t bit{};
+            std::uint64_t value{};
+
+            for (std::size_t i{}; i < c.count; ++i)
+            {
+                // unary quotient: skip the zeros up to the next set bit.
+                std::uint64_t quotient{};
+                auto word = c.words[bit >> 6] >> (bit & 63);
+
+                while (word == 0)
+                {
+                    quotient += 64 - (bit & 63);
+                    bit += 64 - (bit & 63);
+                    word = c.words[bit >> 6];
+                }
+
+                auto const zeros = countr_zero(word);
+                quotient += zeros;
+                bit += zeros + 1;
+
+                // binary remainder of `shift` bits.
+                std::uint64_t remainder{};
+
+                if (c.shift)
+                {
+                    auto const offset = bit & 63;
+                    remainder = c.words[bit >> 6] >> offset;
+
+                    if (offset + c.shift > 64)
+                        remainder |= c.words[(bit >> 6) + 1] << (64 - offset);
+
+                    remainder &= (std::uint64_t{1} << c.shift) - 1;
+                    bit += c.shift;
+                }
+
+                value += (quotient << c.shift) | remainder;
+                out[i] = value;
+            }
+
+            return c.count;
+        }
+
+        // the hashes that are not part of a chunk yet.
+        inline std::uint64_t const *tail() const noexcept
+        {
+            return pending.data();
+        }
+
+        inline std::size_t tail_size() const noexcept
+        {
+            return pending.size();
+        }
+
+        inline void clear() noexcept
+        {
+            release();
+
+            chunks.clear();
+            pending.clear();
+            sealed = 0;
+        }
+
+        friend inline void swap(hash_log &lhs, hash_log &rhs) noexcept
+        {
+            std::swap(static_cast<Alloc &>(lhs), static_cast<Alloc &>(rhs));
+            lhs.pending.swap(rhs.pending);
+            lhs.chunks.swap(rhs.chunks);
+            std::swap(lhs.sealed, rhs.sealed);
+        }
+
+    private:
+        inline void seal()
+        {
+            std::sort(pending.begin(), pending.end());
+            pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+            auto const count = pending.size();
+
+            // the Rice parameter: the mean delta, rounded down to a power of two.
+            auto const mean = pending.back() / count;
+
+            std::size_t shift{};
+            while ((mean >> shift) > 1)
+                ++shift;
+
+            // size the chunk exactly: a quotient is written as that many zeros and a one, followed by the remainder.
+            auto bits = count * (shift + 1);
+            std::uint64_t previous{};
+
+            for (auto const hash : pending)
+            {
+                bits += (hash - previous) >> shift;
+                previous = hash;
+            }
+
+            // grow the list of chunks first, so that the words of the chunk cannot leak.
+            if (chunks.size() == chunks.capacity())
+                chunks.reserve(chunks.size() * 2 + 1);
+
+            auto const length = (bits >> 6) + 1;
+            auto const words = Alloc::allocate(length);
+            std::fill_n(words, length, 0);
+
+            std::size_t bit{};
+            previous = 0;
+
+            for (auto const hash : pending)
+            {
+                auto const delta = hash - previous;
+                previous = hash;
+
+                bit += delta >> shift;
+                words[bit >> 6] |= std::uint64_t{1} << (bit & 63);
+                ++bit;
+
+                if (shift)
+                {
+                    auto const remainder = delta & ((std::uint64_t{1} << shift) - 1);
+                    auto const offset = bit & 63;
+
+                    words[bit >> 6] |= remainder << offset;
+
+                    if (offset + shift > 64)
+                        words[(bit >> 6) + 1] |= remainder >> (64 - offset);
+
+                    bit += shift;
+                }
+            }
+
+            chunks.push_back({words, length, count, shift});
+            sealed += count;
+            pending.clear();
+        }
+
+        inline void release() noexcept
+        {
+            for (auto const &c : chunks)
+                Alloc::deallocate(c.words, c.length);
+        }
+
+        std::vector<std::uint64_t, Alloc> pending;
+        std::vector<chunk, chunk_allocator> chunks;
+        std::size_t sealed{};
+    };
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief A bloom filter that also keeps a compact log of the hashes of its elements, so that it can be rebuilt with another size without the elements themselves.
+    /// Hashes are kept sorted and delta-encoded in chunks, taking about 6.5 bytes per element instead of the elements themselves. Keys larger than that, such as strings, are thus much cheaper to retain this way.
+    /// `resize` gives exactly the filter that inserting the same elements into a new `tnt::bloom_filter` would give.
+    /// @tparam T The type of the elements to be inserted into the filter.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class resizable_bloom final
+        : private utils::deduce_allocator<Alloc>::type
+    {
+        using allocator_type = typename utils::deduce_allocator<Alloc>::type;
+
+    public:
+        /// @brief The type of the underlying filter.
+        using filter_type = versioned_bloom<T, Hash, Alloc>;
+
+        /// @brief Construct a new instance of the filter, given the number of elements and the desired false positive rate.
+        /// @param n The number of elements to be inserted into the filter.
+        /// @param eps The desired false positive rate. Defaults to 0.01 (1% false positives).
+        /// @param hash The hash function to be used for hashing the elements.
+        /// @param alloc The allocator to be used for memory management.
+        inline resizable_bloom(
+            std::size_t n,
+            float eps = 0.01f,
+            Hash const &hash = Hash{},
+            allocator_type const &alloc = allocator_type{})
+            : allocator_type(alloc),
+              bloom{n, eps, hash, alloc},
+              log{alloc}
+        {
+        }
+
+        /// @brief Add the value into the filter, and its hash into the log.
+        inline void insert(T const &value)
+        {
+            insert_hash(hash_function()(value));
+        }
+
+        /// @brief Add a value into the filter, given its hash computed with `hash_function()`.
+        inline void insert_hash(std::size_t hash)
+        {
+            bloom.insert_hash(hash);
+            log.append(hash);
+        }
+
+        /// @brief Add a range of values into the filter, with the same result as inserting them one by one.
+        template <typename It>
+        inline void insert(It first, It last)
+        {
+            std::size_t hashes[utils::bloom_batch];
+
+            while (first != last)
+            {
+                std::size_t n{};
+
+                for (; first != last && n < utils::bloom_batch; ++first)
+                    hashes[n++] = hash_function()(*first);
+
+                bloom.insert_hashes(hashes, n);
+
+                for (std::size_t i{}; i < n; ++i)
+                    log.append(hashes[i]);
+            }
+        }
+
+        /// @brief Check whether the given value *might* be present in the filter. While this function can return false positives, it will never return false negatives.
+        /// Ie. `matches(x)` might be wrong, but `!matches(x)` is always correct.
+        /// @param value The value to check.
+        template <typename U>
+        inline bool matches(U &&value) const noexcept
+        {
+            return bloom.matches(std::forward<U>(value));
+        }
+
+        /// @brief Check whether a value *might* be present in the filter, given its hash computed with `hash_function()`.
+        inline bool matches_hash(std::size_t hash) const noexcept
+        {
+            return bloom.matches_hash(hash);
+        }
+
+        /// @brief Rebuild the filter for `n` elements and the false positive rate `eps`, from the retained hashes.
+        /// The chunks of the log are decoded by several threads at once, which set their bits in the new filter with atomic operations.
+        /// The filter is left unchanged if allocating the new one throws.
+        /// @param n The number of elements the filter should be sized for.
+        /// @param eps The desired false positive rate. Defaults to 0.01 (1% false positives).
+        /// @param threads The number of threads used to rebuild the filter. Defaults to the number of hardware threads.
+        inline void resize(
+            std::size_t n,
+            float eps = 0.01f,
+            std::size_t threads = std::thread::hardware_concurrency())
+        {
+            filter_type resized{n, eps, hash_function(), *this};
+
+            // the elements are the same, so query results cached against the old filter stay valid.
+            static_cast<versioned &>(resized) = bloom;
+
+            rebuild(resized, threads);
+            swap(bloom, resized);
+        }
+
+        /// @brief Remove all elements from the filter, and all hashes from the log.
+        inline void clear() noexcept
+        {
+            bloom.clear();
+            log.clear();
+        }
+
+        /// @brief The underlying filter, eg. to be used with `tnt::bloom_cache`.
+        inline filter_type const &filter() const noexcept
+        {
+            return bloom;
+        }
+
+        /// @brief The hash function used by the filter.
+        inline Hash const &hash_function() const noexcept
+        {
+            return bloom.hash_function();
+        }
+
+        /// @brief The number of hashes retained. Duplicates are only removed within a chunk of the log, so this can be more than the number of distinct elements.
+        inline std::size_t size() const noexcept
+        {
+            return log.size();
+        }
+
+        /// @brief The number of bytes used to retain the hashes, excluding the filter itself.
+        inline std::size_t retained_bytes() const noexcept
+        {
+            return log.bytes();
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend inline void swap(resizable_bloom &lhs, resizable_bloom &rhs) noexcept
+        {
+            using std::swap;
+
+            swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+            swap(lhs.bloom, rhs.bloom);
+            swap(lhs.log, rhs.log);
+        }
+
+    private:
+        inline void rebuild(filter_type &into, std::size_t threads) const
+        {
+            auto const chunks = log.chunk_count();
+
+            // the hashes that are not part of a chunk yet are the last work item.
+            std::atomic<std::size_t> next{};
+
+            auto const worker = [&]
+            {
+                auto const hashes = std::make_unique<std::uint64_t[]>(utils::hash_log<allocator_type>::chunk_size);
+
+                for (auto c = next++; c <= chunks; c = next++)
+                {
+                    if (c < chunks)
+                        set(into, hashes.get(), log.decode(c, hashes.get()));
+                    else
+                        set(into, log.tail(), log.tail_size());
+                }
+            };
+
+            threads = threads == 0 ? 1 : (threads < chunks + 1 ? threads : chunks + 1);
+
+            std::vector<std::thread> pool;
+
+            for (std::size_t i{1}; i < threads; ++i)
+                pool.emplace_back(worker);
+
+            worker();
+
+            for (auto &thread : pool)
+                thread.join();
+        }
+
+        // the same probes as `bloom_filter::insert_hash`, computed and prefetched a batch at a time, then set atomically.
+        static inline void set(filter_type &into, std::uint64_t const *hashes, std::size_t n) noexcept
+        {
+            if (into.k == 0)
+                return;
+
+            std::uint64_t positions[utils::bloom_batch];
+            auto const per_batch = utils::bloom_batch / into.k;
+
+            for (std::size_t i{}; i < n;)
+            {
+                std::size_t count{};
+
+                for (auto const end = n - i < per_batch ? n : i + per_batch; i < end; ++i)
+                {
+                    auto const hash = static_cast<std::size_t>(hashes[i]);
+                    auto const step = hash & utils::size_traits::low_mask;
+
+                    auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+                    for (std::size_t probe{}; probe < into.k; ++probe)
+                    {
+                        h += probe * step;
+                        positions[count] = into.reduce(h);
+                        utils::prefetch(into.words() + (positions[count++] >> 6));
+                    }
+                }
+
+                for (std::size_t j{}; j < count; ++j)
+                    utils::atomic_or(into.words() + (positions[j] >> 6), std::uint64_t{1} << (positions[j] & 63));
+            }
+        }
+
+        filter_type bloom;
+        utils::hash_log<allocator_type> log;
+    };
+
+    namespace pmr
+    {
+        /// @brief Specialization of resizable_bloom using a polymorphic allocator.
+        /// @tparam T The type of the elements to be inserted into the filter.
+        /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+        template <typename T, typename Hash = std::hash<T>>
+        using resizable_bloom = tnt::resizable_bloom<
+            T, Hash,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
+    }
+}
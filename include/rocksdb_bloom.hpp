@@ -0,0 +1,472 @@
+
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+
+#include "bloom_filter.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#if defined(__cpp_constexpr_dynamic_alloc) && (__cpp_constexpr_dynamic_alloc >= 201907L)
+#define CONST_ALLOC constexpr
+#else
+#define CONST_ALLOC inline
+#endif
+
+#if defined(__cpp_lib_constexpr_algorithms) && (__cpp_lib_constexpr_algorithms >= 202306L)
+#define CONST_SWAP constexpr
+#else
+#define CONST_SWAP inline
+#endif
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // The cache-local bloom filter of RocksDB (FastLocalBloom): each key sets `probes` bits in a single 64-byte cache line.
+    // The line is picked with the low half of the 64-bit key hash, and the bits with the high half, multiplied by the golden ratio between probes.
+    struct fast_local_bloom final
+    {
+        inline static constexpr std::size_t line_bytes = 64;
+
+        // -1 for the newer implementations, 0 for this one, then the number of probes and two reserved bytes.
+        inline static constexpr std::size_t metadata_bytes = 5;
+
+        inline static constexpr std::uint32_t golden = 0x9e3779b9;
+
+        // same as RocksDB's `ChooseNumProbes`, for a given number of bits per key (times 1000).
+        static constexpr int probes_for(int millibits_per_key) noexcept
+        {
+            if (millibits_per_key <= 2080)
+                return 1;
+            else if (millibits_per_key <= 3580)
+                return 2;
+            else if (millibits_per_key <= 5100)
+                return 3;
+            else if (millibits_per_key <= 6640)
+                return 4;
+            else if (millibits_per_key <= 8300)
+                return 5;
+            else if (millibits_per_key <= 10070)
+                return 6;
+            else if (millibits_per_key <= 11720)
+                return 7;
+            else if (millibits_per_key <= 14001)
+                return 8;
+            else if (millibits_per_key <= 16050)
+                return 9;
+            else if (millibits_per_key <= 18300)
+                return 10;
+            else if (millibits_per_key <= 22001)
+                return 11;
+            else if (millibits_per_key <= 25501)
+                return 12;
+            else if (millibits_per_key > 50000)
+                return 24;
+            else
+                return (millibits_per_key - 1) / 2000 - 1;
+        }
+
+        // the offset of the cache line of a hash, in a filter of `len` bytes (without the metadata).
+        static inline std::size_t line(std::uint64_t hash, std::size_t len) noexcept
+        {
+            auto const h1 = static_cast<std::uint32_t>(hash);
+            return static_cast<std::size_t>((std::uint64_t{h1} * (len >> 6)) >> 32) << 6;
+        }
+
+        static inline void insert(unsigned char *line, std::uint64_t hash, int probes) noexcept
+        {
+            auto h = static_cast<std::uint32_t>(hash >> 32);
+
+            for (int i{}; i < probes; ++i, h *= golden)
+            {
+                auto const bit = h >> (32 - 9);
+                line[bit >> 3] |= static_cast<unsigned char>(1 << (bit & 7));
+            }
+        }
+
+        static inline bool check(unsigned char const *line, std::uint64_t hash, int probes) noexcept
+        {
+            auto h = static_cast<std::uint32_t>(hash >> 32);
+
+#if defined(__AVX2__)
+            // 8 probes at a time: each lane multiplies by its own power of the golden ratio, and picks its 32-bit word of the line.
+            auto const powers = _mm256_setr_epi32(
+                0x00000001, static_cast<int>(0x9e3779b9), static_cast<int>(0xe35e67b1), 0x734297e9,
+                0x35fbe861, static_cast<int>(0xdeb7c719), 0x448b211, 0x3459b749);
+
+            auto const lower = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(line));
+            auto const upper = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(line + 32));
+
+            for (;;)
+            {
+                auto const hashes = _mm256_mullo_epi32(_mm256_set1_epi32(static_cast<int>(h)), powers);
+                auto const bits = _mm256_srli_epi32(hashes, 32 - 9);
+
+                // the top 4 bits of the position select the word, the high one of them the half of the line.
+                auto const words = _mm256_srli_epi32(bits, 5);
+                auto const low_word = _mm256_permutevar8x32_epi32(lower, words);
+                auto const high_word = _mm256_permutevar8x32_epi32(upper, words);
+                auto const word = _mm256_castps_si256(_mm256_blendv_ps(
+                    _mm256_castsi256_ps(low_word), _mm256_castsi256_ps(high_word), _mm256_castsi256_ps(_mm256_slli_epi32(words, 28))));
+
+                auto const masks = _mm256_sllv_epi32(_mm256_set1_epi32(1), _mm256_and_si256(bits, _mm256_set1_epi32(31)));
+
+                // lanes past the number of probes always pass.
+                auto const unused = _mm256_cmpgt_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(probes - 1));
+                auto const found = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_and_si256(word, masks), masks), unused);
+
+                if (!_mm256_testc_si256(found, _mm256_set1_epi32(-1)))
+                    return false;
+
+                if (probes <= 8)
+                    return true;
+
+                // golden^8
+                h *= 0xab25f4c1;
+                probes -= 8;
+            }
+#else
+            for (int i{}; i < probes; ++i, h *= golden)
+            {
+                auto const bit = h >> (32 - 9);
+
+                if ((line[bit >> 3] & (1 << (bit & 7))) == 0)
+                    return false;
+            }
+
+            return true;
+#endif
+        }
+    };
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief A read-only view over a filter block in the cache-local bloom format of RocksDB (`FastLocalBloom`, the format of `NewBloomFilterPolicy` since format_version 5).
+    /// The block is used in place and never copied, so it must outlive the view.
+    /// @note RocksDB hashes keys with its own 64-bit hash (`GetSliceHash64`). To query RocksDB filters by key, `Hash` must compute the same hash; otherwise use `matches_hash`.
+    /// @tparam T The type of the keys.
+    /// @tparam Hash The 64-bit hash function used to write the filter. Defaults to std::hash.
+    template <
+        typename T,
+        typename Hash = std::hash<T>>
+    class rocksdb_bloom_view final
+        : private Hash
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        // keys are checked in groups, so that the cache lines of a whole group are fetched together.
+        inline static constexpr std::size_t batch = 32;
+
+    public:
+        /// @brief Wrap an existing filter block, including its 5 bytes of metadata.
+        /// @param data The beginning of the filter block. It does not need to be aligned.
+        /// @param size The size of the filter block, in bytes.
+        /// @param hash The hash function used to write the filter.
+        /// @throw std::invalid_argument if the block does not hold a cache-local bloom filter with 64-byte lines, eg. a legacy or a ribbon filter.
+        rocksdb_bloom_view(void const *data, std::size_t size, Hash const &hash = Hash{})
+            : Hash(hash),
+              bytes{static_cast<unsigned char const *>(data)}
+        {
+            // like RocksDB, a block made of the metadata only matches nothing.
+            if (size <= utils::fast_local_bloom::metadata_bytes)
+                return;
+
+            len = size - utils::fast_local_bloom::metadata_bytes;
+
+            auto const marker = static_cast<signed char>(bytes[len]);
+            auto const implementation = bytes[len + 1];
+            auto const raw_probes = bytes[len + 2];
+
+            // the upper 3 bits of the number of probes are log2(line bytes) - 6.
+            probes = raw_probes & 0x1f;
+
+            if (marker != -1 || implementation != 0 || (raw_probes >> 5) != 0 || probes < 1 || probes > 30 || len % utils::fast_local_bloom::line_bytes != 0)
+                throw std::invalid_argument{"The block does not hold a RocksDB cache-local bloom filter!"};
+        }
+
+        /// @brief Check whether the given key *might* be present in the filter. While this function can return false positives, it will never return false negatives.
+        /// @param value The key to check.
+        template <typename U>
+        inline bool matches(U &&value) const noexcept
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            return matches_hash(static_cast<Hash const &>(*this)(value));
+        }
+
+        /// @brief Check a range of keys at once, writing a `bool` for each of them into `out`.
+        /// The cache lines of a group of keys are prefetched before any of them is checked, so that their cache misses overlap.
+        /// @param first The beginning of the range of keys.
+        /// @param last The end of the range of keys.
+        /// @param out Where to write the results.
+        /// @return The output iterator past the last result.
+        template <typename It, typename Out>
+        inline Out matches(It first, It last, Out out) const
+        {
+            std::uint64_t hashes[batch];
+
+            while (first != last)
+            {
+                std::size_t n{};
+
+                for (; n < batch && first != last; ++n, ++first)
+                    hashes[n] = static_cast<Hash const &>(*this)(*first);
+
+                bool found[batch];
+                matches_hash(hashes, n, found);
+
+                out = std::copy_n(found, n, out);
+            }
+
+            return out;
+        }
+
+        /// @brief Check whether a key *might* be present in the filter, given its 64-bit hash.
+        inline bool matches_hash(std::uint64_t hash) const noexcept
+        {
+            if (len == 0)
+                return false;
+
+            return utils::fast_local_bloom::check(bytes + utils::fast_local_bloom::line(hash, len), hash, probes);
+        }
+
+        /// @brief Check many keys at once given their 64-bit hashes, prefetching the cache lines of a group of keys before checking them.
+        /// @param hashes The hashes of the keys.
+        /// @param n The number of keys.
+        /// @param found Where to write the results, must have room for `n` values.
+        inline void matches_hash(std::uint64_t const *hashes, std::size_t n, bool *found) const noexcept
+        {
+            if (len == 0)
+            {
+                std::fill_n(found, n, false);
+                return;
+            }
+
+            std::size_t lines[batch];
+
+            for (std::size_t i{}; i < n; i += batch)
+            {
+                auto const count = n - i < batch ? n - i : batch;
+
+                for (std::size_t j{}; j < count; ++j)
+                {
+                    lines[j] = utils::fast_local_bloom::line(hashes[i + j], len);
+                    utils::prefetch(bytes + lines[j]);
+                }
+
+                for (std::size_t j{}; j < count; ++j)
+                    found[i + j] = utils::fast_local_bloom::check(bytes + lines[j], hashes[i + j], probes);
+            }
+        }
+
+        /// @brief The number of bits set by each key.
+        inline int num_probes() const noexcept
+        {
+            return probes;
+        }
+
+    private:
+        unsigned char const *bytes;
+        std::size_t len{};
+        int probes{};
+    };
+
+    /// @brief A bloom filter in the cache-local format of RocksDB (`FastLocalBloom`), whose block can be stored as the filter block of a RocksDB table.
+    /// Each key sets a few bits in a single 64-byte cache line, and the block ends with the 5 bytes of metadata RocksDB reads it with.
+    /// @note RocksDB hashes keys with its own 64-bit hash (`GetSliceHash64`). To build filters that RocksDB can query by key, `Hash` must compute the same hash; otherwise use `insert_hash`.
+    /// @tparam T The type of the keys.
+    /// @tparam Hash The 64-bit hash function to be used. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class rocksdb_bloom final
+        : private Hash,
+          private std::allocator_traits<Alloc>::template rebind_alloc<unsigned char>
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<unsigned char>;
+
+    public:
+        /// @brief Construct an empty filter, sized and tuned the way RocksDB does for the same settings.
+        /// @param n The number of keys to be inserted into the filter.
+        /// @param bits_per_key The number of bits of the filter for each key. Defaults to 10, the usual RocksDB setting (about 1% false positives).
+        /// @param hash The hash function to be used for hashing the keys.
+        /// @param alloc The allocator to be used for memory management.
+        CONST_ALLOC rocksdb_bloom(
+            std::size_t n,
+            double bits_per_key = 10.0,
+            Hash const &hash = Hash{},
+            allocator_type const &alloc = allocator_type{})
+            : Hash(hash),
+              allocator_type(alloc)
+        {
+            auto const millibits = static_cast<std::uint64_t>(bits_per_key * 1000.0 + 0.500001);
+            auto const lines = std::max(std::uint64_t{1}, (std::uint64_t{n} * millibits + 511'999) / 512'000);
+
+            len = static_cast<std::size_t>(lines) * utils::fast_local_bloom::line_bytes;
+            probes = utils::fast_local_bloom::probes_for(static_cast<int>(millibits));
+
+            bytes = allocator_type::allocate(size());
+            std::fill_n(bytes, size(), 0);
+            write_metadata();
+        }
+
+        /// @brief The copy constructor.
+        CONST_ALLOC rocksdb_bloom(rocksdb_bloom const &rhs)
+            : Hash(rhs),
+              allocator_type(rhs),
+              len{rhs.len},
+              probes{rhs.probes}
+        {
+            bytes = allocator_type::allocate(size());
+            std::copy_n(rhs.bytes, size(), bytes);
+        }
+
+        /// @brief The copy assignment operator.
+        CONST_ALLOC rocksdb_bloom &operator=(rocksdb_bloom const &rhs)
+        {
+            rocksdb_bloom tmp{rhs};
+            swap(*this, tmp);
+
+            return *this;
+        }
+
+        /// @brief The move constructor.
+        CONST_SWAP rocksdb_bloom(rocksdb_bloom &&rhs) noexcept
+            : Hash(rhs),
+              allocator_type(rhs)
+        {
+            swap(*this, rhs);
+        }
+
+        /// @brief The move assignment operator.
+        CONST_SWAP rocksdb_bloom &operator=(rocksdb_bloom &&rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        /// @brief The destructor.
+        CONST_ALLOC ~rocksdb_bloom() noexcept
+        {
+            if (bytes)
+                allocator_type::deallocate(bytes, size());
+        }
+
+        /// @brief Add the key into the filter.
+        inline void insert(T const &value) noexcept
+        {
+            insert_hash(static_cast<Hash const &>(*this)(value));
+        }
+
+        /// @brief Add a key into the filter, given its 64-bit hash.
+        inline void insert_hash(std::uint64_t hash) noexcept
+        {
+            utils::fast_local_bloom::insert(bytes + utils::fast_local_bloom::line(hash, len), hash, probes);
+        }
+
+        /// @brief Check whether the given key *might* be present in the filter. While this function can return false positives, it will never return false negatives.
+        /// @param value The key to check.
+        template <typename U>
+        inline bool matches(U &&value) const noexcept
+        {
+            return view().matches(static_cast<U &&>(value));
+        }
+
+        /// @brief Check a range of keys at once, writing a `bool` for each of them into `out`. See `rocksdb_bloom_view::matches`.
+        template <typename It, typename Out>
+        inline Out matches(It first, It last, Out out) const
+        {
+            return view().matches(first, last, out);
+        }
+
+        /// @brief Remove all keys from the filter.
+        inline void clear() noexcept
+        {
+            std::fill_n(bytes, len, 0);
+        }
+
+        /// @brief A view over the block of the filter. It is invalidated when the filter is destroyed, assigned to or swapped.
+        inline rocksdb_bloom_view<T, Hash> view() const
+        {
+            return rocksdb_bloom_view<T, Hash>{bytes, size(), static_cast<Hash const &>(*this)};
+        }
+
+        /// @brief The filter block, with its metadata, ready to be stored as a RocksDB filter block.
+        inline void const *data() const noexcept
+        {
+            return bytes;
+        }
+
+        /// @brief The size of the filter block, in bytes.
+        inline std::size_t size() const noexcept
+        {
+            return len + utils::fast_local_bloom::metadata_bytes;
+        }
+
+        /// @brief The number of bits set by each key.
+        inline int num_probes() const noexcept
+        {
+            return probes;
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend CONST_SWAP void swap(rocksdb_bloom &lhs, rocksdb_bloom &rhs) noexcept
+        {
+            std::swap(static_cast<Hash &>(lhs), static_cast<Hash &>(rhs));
+            std::swap(lhs.len, rhs.len);
+            std::swap(lhs.probes, rhs.probes);
+            std::swap(lhs.bytes, rhs.bytes);
+            std::swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+        }
+
+    private:
+        inline void write_metadata() noexcept
+        {
+            auto const metadata = bytes + len;
+
+            metadata[0] = 0xff;
+            metadata[1] = 0;
+            metadata[2] = static_cast<unsigned char>(probes);
+            metadata[3] = 0;
+            metadata[4] = 0;
+        }
+
+        std::size_t len{};
+        int probes{};
+        unsigned char *bytes{};
+    };
+
+    namespace pmr
+    {
+        /// @brief Specialization of rocksdb_bloom using a polymorphic allocator.
+        /// @tparam T The type of the keys.
+        /// @tparam Hash The 64-bit hash function to be used. Defaults to std::hash.
+        template <typename T, typename Hash = std::hash<T>>
+        using rocksdb_bloom = tnt::rocksdb_bloom<
+            T, Hash,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
+    }
+}
+
+#undef CONST_ALLOC
+#undef CONST_SWAP
@@ -0,0 +1,1163 @@
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "bloom_filter.hpp"
+
+#if (defined(__unix__) || defined(__APPLE__)) && __has_include(<sys/socket.h>) && __has_include(<sys/un.h>)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define TNT_UNIX_SOCKETS 1
+#endif
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // Messages between the filter and the owners of its shards. Numbers are little-endian, so that owners can run on any host.
+    // A request starts with its operation:
+    //   create  start:u64 bits:u64 hashes:u8          -> nothing
+    //   insert  (start:u64 count:u32 hash:u64*count)*  -> nothing
+    //   matches (start:u64 count:u32 hash:u64*count)*  -> one bit per hash, in order
+    //   copy    start:u64                              -> bits:u64 hashes:u8 word:u64*
+    //   paste   start:u64 bits:u64 hashes:u8 word:u64* -> nothing
+    //   stop                                           -> nothing
+    //   list                                           -> count:u32 start:u64*count
+    // A response starts with a status byte, followed by the results, or by an error message if the status is not zero.
+    enum class shard_op : std::uint8_t
+    {
+        create = 1,
+        insert,
+        matches,
+        copy,
+        paste,
+        stop,
+        list,
+    };
+
+    struct shard_writer final
+    {
+        std::vector<std::uint8_t> bytes;
+
+        inline void put8(std::uint8_t x)
+        {
+            bytes.push_back(x);
+        }
+
+        inline void put32(std::uint32_t x)
+        {
+            bytes.resize(bytes.size() + 4);
+            store_le32(bytes.data() + bytes.size() - 4, x);
+        }
+
+        inline void put64(std::uint64_t x)
+        {
+            bytes.resize(bytes.size() + 8);
+            store_le64(bytes.data() + bytes.size() - 8, x);
+        }
+    };
+
+    struct shard_reader final
+    {
+        std::uint8_t const *p;
+        std::uint8_t const *end;
+
+        inline bool done() const noexcept
+        {
+            return p == end;
+        }
+
+        inline void need(std::size_t n) const
+        {
+            if (static_cast<std::size_t>(end - p) < n)
+                throw std::runtime_error{"Truncated shard message!"};
+        }
+
+        inline std::uint8_t get8()
+        {
+            need(1);
+            return *p++;
+        }
+
+        inline std::uint32_t get32()
+        {
+            need(4);
+            p += 4;
+            return load_le32(p - 4);
+        }
+
+        inline std::uint64_t get64()
+        {
+            need(8);
+            p += 8;
+            return load_le64(p - 8);
+        }
+    };
+
+    inline void check_shard_response(std::vector<std::uint8_t> const &response)
+    {
+        if (response.empty())
+            throw std::runtime_error{"Empty response from a shard owner!"};
+
+        if (response[0] != 0)
+            throw std::runtime_error{std::string(response.begin() + 1, response.end())};
+    }
+
+    // Send each request to its owner, then read the response to every request that was sent, even after an error, so that no response is left queued for the next caller.
+    // `done(i, response)` is called with the successful responses; the first error is thrown once everything is read, and `failed` tells whether it came from the transport itself.
+    template <typename Transport, typename F>
+    void shard_round_trip(
+        Transport &transport,
+        std::vector<std::pair<std::size_t, std::vector<std::uint8_t>>> const &requests,
+        bool &failed,
+        F &&done)
+    {
+        std::exception_ptr error;
+        std::size_t sent{};
+
+        try
+        {
+            for (; sent < requests.size(); ++sent)
+                transport.send(requests[sent].first, requests[sent].second);
+        }
+        catch (...)
+        {
+            failed = true;
+            error = std::current_exception();
+        }
+
+        for (std::size_t i{}; i < sent; ++i)
+        {
+            std::vector<std::uint8_t> response;
+
+            try
+            {
+                response = transport.receive(requests[i].first);
+            }
+            catch (...)
+            {
+                failed = true;
+
+                if (!error)
+                    error = std::current_exception();
+
+                continue;
+            }
+
+            try
+            {
+                check_shard_response(response);
+                done(i, response);
+            }
+            catch (...)
+            {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // The bits of one range of hashes on its owner, with the same probing as `bloom_filter`.
+    class shard_filter final
+    {
+        // all the hashes of a range share their prefix, so they are remixed before probing.
+        inline static constexpr std::uint64_t salt = 0x5851'f42d'4c95'7f2d;
+
+    public:
+        inline shard_filter(std::size_t bits, std::size_t hashes)
+            : m{bits ? bits : 1},
+              k{hashes},
+              mod{m},
+              words((m >> 6) + ((m & 63) != 0))
+        {
+        }
+
+        inline void insert_hash(std::uint64_t hash) noexcept
+        {
+            auto const mixed = static_cast<std::size_t>(mix64(hash ^ salt));
+            auto const step = mixed & size_traits::low_mask;
+
+            auto h = (mixed & size_traits::high_mask) >> size_traits::high_shift;
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+
+                auto const index = mod(h);
+                words[index >> 6] |= std::uint64_t{1} << (index & 63);
+            }
+        }
+
+        inline bool matches_hash(std::uint64_t hash) const noexcept
+        {
+            auto const mixed = static_cast<std::size_t>(mix64(hash ^ salt));
+            auto const step = mixed & size_traits::low_mask;
+
+            auto h = (mixed & size_traits::high_mask) >> size_traits::high_shift;
+
+            bool found{true};
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+
+                auto const index = mod(h);
+                found = found && (words[index >> 6] & (std::uint64_t{1} << (index & 63))) != 0;
+            }
+
+            return found;
+        }
+
+        std::size_t m;
+        std::size_t k;
+        fast_modulo mod;
+        std::vector<std::uint64_t> words;
+    };
+
+#if defined(TNT_UNIX_SOCKETS)
+    // frames are a little-endian u64 length followed by the message.
+    // the length is bounded, so that a corrupt or hostile peer cannot make the other side allocate without limit.
+    inline constexpr std::uint64_t max_frame = std::uint64_t{1} << 30;
+
+    inline void write_all(int fd, void const *data, std::size_t size)
+    {
+        auto p = static_cast<char const *>(data);
+
+        while (size)
+        {
+#if defined(MSG_NOSIGNAL)
+            auto const n = ::send(fd, p, size, MSG_NOSIGNAL);
+#else
+            auto const n = ::write(fd, p, size);
+#endif
+
+            if (n < 0 && errno == EINTR)
+                continue;
+
+            if (n <= 0)
+                throw std::system_error{errno, std::generic_category(), "Cannot write to the shard socket"};
+
+            p += n;
+            size -= static_cast<std::size_t>(n);
+        }
+    }
+
+    // false if the peer closed the connection before the first byte.
+    inline bool read_all(int fd, void *data, std::size_t size)
+    {
+        auto p = static_cast<char *>(data);
+        auto const total = size;
+
+        while (size)
+        {
+            auto const n = ::read(fd, p, size);
+
+            if (n < 0 && errno == EINTR)
+                continue;
+
+            if (n == 0 && size == total)
+                return false;
+
+            if (n <= 0)
+                throw std::system_error{n == 0 ? ECONNRESET : errno, std::generic_category(), "Cannot read from the shard socket"};
+
+            p += n;
+            size -= static_cast<std::size_t>(n);
+        }
+
+        return true;
+    }
+
+    inline void write_frame(int fd, std::vector<std::uint8_t> const &message)
+    {
+        if (message.size() > max_frame)
+            throw std::system_error{EMSGSIZE, std::generic_category(), "The shard message is too large"};
+
+        std::uint8_t header[8];
+        store_le64(header, message.size());
+
+        write_all(fd, header, sizeof(header));
+        write_all(fd, message.data(), message.size());
+    }
+
+    inline bool read_frame(int fd, std::vector<std::uint8_t> &message)
+    {
+        std::uint8_t header[8];
+
+        if (!read_all(fd, header, sizeof(header)))
+            return false;
+
+        auto const size = load_le64(header);
+
+        if (size > max_frame)
+            throw std::system_error{EMSGSIZE, std::generic_category(), "The shard message is too large"};
+
+        message.resize(static_cast<std::size_t>(size));
+
+        if (!message.empty() && !read_all(fd, message.data(), message.size()))
+            throw std::system_error{ECONNRESET, std::generic_category(), "Cannot read from the shard socket"};
+
+        return true;
+    }
+
+    inline sockaddr_un socket_address(std::string const &path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+
+        if (path.size() >= sizeof(address.sun_path))
+            throw std::invalid_argument{"The socket path is too long!"};
+
+        std::copy(path.begin(), path.end(), address.sun_path);
+
+        return address;
+    }
+#endif
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief How the space of hashes is split into ranges, and which owner holds each range.
+    /// Values are routed by the prefix of their hash, so splitting a range only moves the values of that range.
+    class shard_map final
+    {
+    public:
+        /// @brief A range of hashes, from its start to the start of the next range (or to the end of the hash space for the last one).
+        struct range final
+        {
+            /// @brief The smallest hash of the range.
+            std::uint64_t start;
+
+            /// @brief The index of the owner of the range.
+            std::size_t owner;
+        };
+
+        /// @brief Split the hash space into one range of equal size per owner.
+        /// @param owners The number of owners.
+        /// @throw std::invalid_argument if there are no owners.
+        inline explicit shard_map(std::size_t owners)
+        {
+            if (owners == 0)
+                throw std::invalid_argument{"A shard map needs at least one owner!"};
+
+            // the width is rounded up, so that the last range ends with the hash space.
+            auto const width = ~std::uint64_t{} / owners + 1;
+
+            table.reserve(owners);
+
+            for (std::size_t i{}; i < owners; ++i)
+                table.push_back(range{width * i, i});
+        }
+
+        /// @brief Use the given ranges, eg. the ones found on the owners by `tnt::sharded_bloom::attach`.
+        /// @param ranges The ranges, sorted by their start.
+        /// @throw std::invalid_argument if the ranges are not sorted, have the same start, or do not start at 0.
+        inline explicit shard_map(std::vector<range> ranges)
+            : table{std::move(ranges)}
+        {
+            if (table.empty() || table[0].start != 0)
+                throw std::invalid_argument{"The first range must start at 0!"};
+
+            for (std::size_t i = 1; i < table.size(); ++i)
+            {
+                if (table[i - 1].start >= table[i].start)
+                    throw std::invalid_argument{"The ranges must be sorted by their start, and start at different hashes!"};
+            }
+        }
+
+        /// @brief The index of the range holding the given hash.
+        inline std::size_t route(std::uint64_t hash) const noexcept
+        {
+            std::size_t first{}, count = table.size();
+
+            while (count > 1)
+            {
+                auto const half = count / 2;
+
+                if (table[first + half].start <= hash)
+                    first += half;
+
+                count -= half;
+            }
+
+            return first;
+        }
+
+        /// @brief Split a range in two halves of equal size, giving the upper half to the given owner.
+        /// @param index The index of the range to split.
+        /// @param owner The owner of the upper half.
+        /// @return The index of the upper half, which is `index + 1`.
+        /// @throw std::invalid_argument if the range does not exist or holds a single hash.
+        inline std::size_t split(std::size_t index, std::size_t owner)
+        {
+            if (index >= table.size())
+                throw std::invalid_argument{"There is no such range!"};
+
+            auto const start = table[index].start;
+            auto const last = index + 1 < table.size() ? table[index + 1].start - 1 : ~std::uint64_t{};
+
+            if (last == start)
+                throw std::invalid_argument{"A range of a single hash cannot be split!"};
+
+            auto const mid = start + ((last - start) >> 1) + 1;
+
+            table.insert(table.begin() + static_cast<std::ptrdiff_t>(index + 1), range{mid, owner});
+
+            return index + 1;
+        }
+
+        /// @brief The ranges, sorted by their start.
+        inline std::vector<range> const &ranges() const noexcept
+        {
+            return table;
+        }
+
+    private:
+        std::vector<range> table;
+    };
+
+    /// @brief The owner side of a sharded filter: it holds the bits of the ranges it owns and answers the requests of `tnt::sharded_bloom`, whatever the transport.
+    class shard_node final
+    {
+    public:
+        /// @brief Answer a request.
+        /// @param request The request, as sent by the transport.
+        /// @return The response. Errors, such as malformed requests or unknown ranges, are reported in the response instead of being thrown.
+        inline std::vector<std::uint8_t> handle(std::vector<std::uint8_t> const &request)
+        {
+            utils::shard_writer response;
+            response.put8(0);
+
+            try
+            {
+                utils::shard_reader reader{request.data(), request.data() + request.size()};
+
+                switch (static_cast<utils::shard_op>(reader.get8()))
+                {
+                case utils::shard_op::create:
+                {
+                    auto const start = reader.get64();
+                    auto const bits = reader.get64();
+                    auto const hashes = reader.get8();
+
+                    // another client may have created the range already, in which case its bits are kept.
+                    auto const [it, created] = filters.try_emplace(start, static_cast<std::size_t>(bits), hashes);
+
+                    if (!created && (it->second.m != (bits ? bits : 1) || it->second.k != hashes))
+                        throw std::runtime_error{"The range already exists with another size!"};
+
+                    break;
+                }
+                case utils::shard_op::insert:
+                    while (!reader.done())
+                    {
+                        auto &filter = find(reader.get64());
+
+                        for (auto count = reader.get32(); count; --count)
+                            filter.insert_hash(reader.get64());
+                    }
+
+                    break;
+                case utils::shard_op::matches:
+                {
+                    std::uint8_t byte{}, bit{};
+
+                    while (!reader.done())
+                    {
+                        auto const &filter = find(reader.get64());
+
+                        for (auto count = reader.get32(); count; --count)
+                        {
+                            byte |= static_cast<std::uint8_t>(filter.matches_hash(reader.get64()) << bit);
+
+                            if (++bit == 8)
+                            {
+                                response.put8(byte);
+                                byte = bit = 0;
+                            }
+                        }
+                    }
+
+                    if (bit)
+                        response.put8(byte);
+
+                    break;
+                }
+                case utils::shard_op::copy:
+                {
+                    auto const &filter = find(reader.get64());
+
+                    response.bytes.reserve(1 + 9 + filter.words.size() * 8);
+                    response.put64(filter.m);
+                    response.put8(static_cast<std::uint8_t>(filter.k));
+
+                    for (auto const word : filter.words)
+                        response.put64(word);
+
+                    break;
+                }
+                case utils::shard_op::paste:
+                {
+                    auto const start = reader.get64();
+                    auto const bits = reader.get64();
+
+                    utils::shard_filter filter{static_cast<std::size_t>(bits), reader.get8()};
+
+                    for (auto &word : filter.words)
+                        word = reader.get64();
+
+                    // the bits of a range that is already there are merged, so that none of its values stop matching.
+                    auto const [it, created] = filters.try_emplace(start, std::move(filter));
+
+                    if (!created)
+                    {
+                        if (it->second.m != filter.m || it->second.k != filter.k)
+                            throw std::runtime_error{"The range already exists with another size!"};
+
+                        for (std::size_t i{}; i < filter.words.size(); ++i)
+                            it->second.words[i] |= filter.words[i];
+                    }
+
+                    break;
+                }
+                case utils::shard_op::stop:
+                    stop = true;
+                    break;
+                case utils::shard_op::list:
+                    response.put32(static_cast<std::uint32_t>(filters.size()));
+
+                    for (auto const &[start, filter] : filters)
+                        response.put64(start);
+
+                    break;
+                default:
+                    throw std::runtime_error{"Unknown shard operation!"};
+                }
+            }
+            catch (std::exception const &e)
+            {
+                std::string const what = e.what();
+
+                response.bytes.assign(1, 1);
+                response.bytes.insert(response.bytes.end(), what.begin(), what.end());
+            }
+
+            return std::move(response.bytes);
+        }
+
+        /// @brief Whether the node was asked to stop, see `tnt::stop_owner`.
+        inline bool stopped() const noexcept
+        {
+            return stop;
+        }
+
+        /// @brief The number of ranges held by the node.
+        inline std::size_t ranges() const noexcept
+        {
+            return filters.size();
+        }
+
+    private:
+        inline utils::shard_filter &find(std::uint64_t start)
+        {
+            auto const it = filters.find(start);
+
+            if (it == filters.end())
+                throw std::runtime_error{"This node does not own the requested range!"};
+
+            return it->second;
+        }
+
+        std::map<std::uint64_t, utils::shard_filter> filters;
+        bool stop{};
+    };
+
+    /// @brief A transport that delivers requests to nodes living in the same process, eg. for tests or to run shards in threads of a single process.
+    class loopback_transport final
+    {
+    public:
+        /// @brief Create one node per owner.
+        inline explicit loopback_transport(std::size_t owners)
+            : nodes(owners),
+              pending(owners)
+        {
+        }
+
+        /// @brief The number of owners.
+        inline std::size_t owners() const noexcept
+        {
+            return nodes.size();
+        }
+
+        /// @brief Send a request to an owner. The request is answered right away.
+        inline void send(std::size_t owner, std::vector<std::uint8_t> const &request)
+        {
+            pending[owner].push_back(nodes[owner].handle(request));
+        }
+
+        /// @brief Receive the response to the oldest request sent to an owner.
+        inline std::vector<std::uint8_t> receive(std::size_t owner)
+        {
+            auto response = std::move(pending[owner].front());
+            pending[owner].pop_front();
+
+            return response;
+        }
+
+        /// @brief The node of an owner.
+        inline shard_node &node(std::size_t owner) noexcept
+        {
+            return nodes[owner];
+        }
+
+    private:
+        std::vector<shard_node> nodes;
+        std::vector<std::deque<std::vector<std::uint8_t>>> pending;
+    };
+
+#if defined(TNT_UNIX_SOCKETS)
+    /// @brief A transport that sends requests to nodes in other processes over Unix domain sockets, see `tnt::unix_socket_server`.
+    /// Requests to different owners are sent before any response is read, so owners work on a batch in parallel.
+    /// Messages are limited to 1 GiB, so a range handed over by `tnt::sharded_bloom::split` must fit in that.
+    class unix_socket_transport final
+    {
+    public:
+        /// @brief Connect to one server per owner.
+        /// @param paths The path of the socket of each owner.
+        /// @throw std::system_error if a server cannot be reached.
+        inline explicit unix_socket_transport(std::vector<std::string> const &paths)
+        {
+            sockets.reserve(paths.size());
+
+            try
+            {
+                for (auto const &path : paths)
+                {
+                    auto const address = utils::socket_address(path);
+                    auto const fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+                    if (fd == -1)
+                        throw std::system_error{errno, std::generic_category(), "Cannot create a shard socket"};
+
+                    sockets.push_back(fd);
+
+                    if (::connect(fd, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) == -1)
+                        throw std::system_error{errno, std::generic_category(), "Cannot connect to " + path};
+                }
+            }
+            catch (...)
+            {
+                // the destructor does not run when the constructor throws.
+                for (auto const fd : sockets)
+                    ::close(fd);
+
+                throw;
+            }
+        }
+
+        unix_socket_transport(unix_socket_transport const &) = delete;
+        unix_socket_transport &operator=(unix_socket_transport const &) = delete;
+
+        /// @brief The move constructor.
+        inline unix_socket_transport(unix_socket_transport &&rhs) noexcept
+            : sockets{std::move(rhs.sockets)}
+        {
+            rhs.sockets.clear();
+        }
+
+        /// @brief The move assignment operator.
+        inline unix_socket_transport &operator=(unix_socket_transport &&rhs) noexcept
+        {
+            std::swap(sockets, rhs.sockets);
+            return *this;
+        }
+
+        /// @brief The destructor, closing the connections.
+        inline ~unix_socket_transport() noexcept
+        {
+            for (auto const fd : sockets)
+                ::close(fd);
+        }
+
+        /// @brief The number of owners.
+        inline std::size_t owners() const noexcept
+        {
+            return sockets.size();
+        }
+
+        /// @brief Send a request to an owner.
+        inline void send(std::size_t owner, std::vector<std::uint8_t> const &request)
+        {
+            utils::write_frame(sockets[owner], request);
+        }
+
+        /// @brief Receive the response to the oldest request sent to an owner.
+        inline std::vector<std::uint8_t> receive(std::size_t owner)
+        {
+            std::vector<std::uint8_t> response;
+
+            if (!utils::read_frame(sockets[owner], response))
+                throw std::system_error{ECONNRESET, std::generic_category(), "The shard owner closed the connection"};
+
+            return response;
+        }
+
+    private:
+        std::vector<int> sockets;
+    };
+
+    /// @brief A Unix domain socket on which a `tnt::shard_node` answers the requests of `tnt::unix_socket_transport`.
+    /// The socket listens as soon as the server is created, so clients can connect before `serve` is called, eg. from a parent process that forks the servers.
+    class unix_socket_server final
+    {
+    public:
+        /// @brief Listen on the given path, replacing any socket file already there.
+        /// @throw std::system_error if the socket cannot be created.
+        inline explicit unix_socket_server(std::string path)
+            : name{std::move(path)}
+        {
+            auto const address = utils::socket_address(name);
+
+            listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+            if (listener == -1)
+                throw std::system_error{errno, std::generic_category(), "Cannot create a shard socket"};
+
+            ::unlink(name.c_str());
+
+            if (::bind(listener, reinterpret_cast<sockaddr const *>(&address), sizeof(address)) == -1 || ::listen(listener, 16) == -1)
+            {
+                auto const error = errno;
+                ::close(listener);
+
+                throw std::system_error{error, std::generic_category(), "Cannot listen on " + name};
+            }
+        }
+
+        unix_socket_server(unix_socket_server const &) = delete;
+        unix_socket_server &operator=(unix_socket_server const &) = delete;
+
+        /// @brief The destructor, closing the socket and removing its file.
+        inline ~unix_socket_server() noexcept
+        {
+            ::close(listener);
+            ::unlink(name.c_str());
+        }
+
+        /// @brief Answer the requests of the clients, one connection after another, until the node is stopped.
+        /// @param node The node answering the requests.
+        /// @throw std::system_error if the socket fails.
+        inline void serve(shard_node &node)
+        {
+            std::vector<std::uint8_t> request;
+
+            while (!node.stopped())
+            {
+                auto const client = ::accept(listener, nullptr, nullptr);
+
+                if (client == -1)
+                {
+                    if (errno == EINTR)
+                        continue;
+
+                    throw std::system_error{errno, std::generic_category(), "Cannot accept a shard client"};
+                }
+
+                try
+                {
+                    while (!node.stopped() && utils::read_frame(client, request))
+                        utils::write_frame(client, node.handle(request));
+                }
+                catch (std::system_error const &)
+                {
+                    // a broken connection only ends that client.
+                }
+
+                ::close(client);
+            }
+        }
+
+    private:
+        std::string name;
+        int listener;
+    };
+#endif
+
+    /// @brief Ask an owner to stop, eg. to end `tnt::unix_socket_server::serve`.
+    /// @param transport The transport to the owner.
+    /// @param owner The index of the owner.
+    template <typename Transport>
+    void stop_owner(Transport &transport, std::size_t owner)
+    {
+        transport.send(owner, {static_cast<std::uint8_t>(utils::shard_op::stop)});
+        transport.receive(owner);
+    }
+
+    /// @brief A bloom filter split by hash ranges over several owners, such as processes or nodes, that are reached through a transport.
+    /// Values are routed by the prefix of their (remixed) hash, and batches are sent as a single request per owner, with every owner working on its part at the same time.
+    /// Ranges can be split and moved to other owners while the filter is in use, in which case the new owner starts from a copy of the bits of the whole range,
+    /// so nothing that was inserted stops matching.
+    /// Several clients can share the owners: the first one creates the ranges, and the others `attach` to them. Creating ranges that already exist keeps their bits.
+    /// The ranges of a client are only read from the owners when it attaches, so ranges should be split before other clients attach.
+    /// If the transport throws, the filter cannot tell which requests were applied, so every later call throws std::runtime_error.
+    /// @tparam T The type of the elements to be inserted into the filter.
+    /// @tparam Transport How requests reach the owners, eg. `tnt::loopback_transport` or `tnt::unix_socket_transport`. It must provide
+    /// `owners()`, `send(owner, request)` and `receive(owner)`, with responses received in the order of the requests of each owner.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    template <
+        typename T,
+        typename Transport,
+        typename Hash = std::hash<T>>
+    class sharded_bloom final
+        : private Hash
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        // large inputs are sent in batches of this many values, so that requests stay small.
+        inline static constexpr std::size_t batch_size = 4'096;
+
+    public:
+        /// @brief Create the filter with one range per owner of the transport, given the number of elements and the desired false positive rate.
+        /// @param transport The transport to the owners, which must outlive the filter.
+        /// @param n The number of elements to be inserted into the filter.
+        /// @param eps The desired false positive rate. Defaults to 0.01 (1% false positives).
+        /// @param hash The hash function to be used for hashing the elements.
+        /// @throw std::runtime_error if an owner fails to create its range.
+        inline sharded_bloom(
+            Transport &transport,
+            std::size_t n,
+            float eps = 0.01f,
+            Hash const &hash = Hash{})
+            : sharded_bloom(transport, shard_map{transport.owners()}, n, eps, hash)
+        {
+        }
+
+        /// @brief Create the filter with the given ranges, given the number of elements and the desired false positive rate.
+        /// @param transport The transport to the owners, which must outlive the filter.
+        /// @param map The ranges and their owners. The bits are spread evenly between the ranges.
+        /// @param n The number of elements to be inserted into the filter.
+        /// @param eps The desired false positive rate. Defaults to 0.01 (1% false positives).
+        /// @param hash The hash function to be used for hashing the elements.
+        /// @throw std::runtime_error if an owner fails to create its range.
+        inline sharded_bloom(
+            Transport &transport,
+            shard_map map,
+            std::size_t n,
+            float eps = 0.01f,
+            Hash const &hash = Hash{})
+            : Hash(hash),
+              transport{&transport},
+              table{std::move(map)}
+        {
+            auto const nlog_eps = -std::log(eps);
+            auto const log_2 = 0.6931471805599453f;
+
+            auto const per_range = n / table.ranges().size() + 1;
+            auto const bits = static_cast<std::uint64_t>(per_range * nlog_eps / (log_2 * log_2));
+            auto const hashes = static_cast<std::uint8_t>(nlog_eps / log_2);
+
+            std::vector<std::pair<std::size_t, std::vector<std::uint8_t>>> requests;
+            requests.reserve(table.ranges().size());
+
+            for (auto const &r : table.ranges())
+            {
+                utils::shard_writer request;
+                request.put8(static_cast<std::uint8_t>(utils::shard_op::create));
+                request.put64(r.start);
+                request.put64(bits);
+                request.put8(hashes);
+
+                requests.emplace_back(r.owner, std::move(request.bytes));
+            }
+
+            round_trip(requests, [](std::size_t, std::vector<std::uint8_t> const &) {});
+        }
+
+        /// @brief Use the ranges already created on the owners, eg. by the filter of another client.
+        /// @param transport The transport to the owners, which must outlive the filter.
+        /// @param hash The hash function to be used for hashing the elements. It must hash like the one of the filter that created the ranges.
+        /// @throw std::runtime_error if an owner fails, or if the ranges of the owners do not cover the hash space.
+        static inline sharded_bloom attach(Transport &transport, Hash const &hash = Hash{})
+        {
+            std::vector<std::pair<std::size_t, std::vector<std::uint8_t>>> requests;
+            requests.reserve(transport.owners());
+
+            for (std::size_t owner{}; owner < transport.owners(); ++owner)
+                requests.emplace_back(owner, std::vector<std::uint8_t>{static_cast<std::uint8_t>(utils::shard_op::list)});
+
+            std::vector<shard_map::range> ranges;
+            bool failed{};
+
+            utils::shard_round_trip(
+                transport, requests, failed,
+                [&ranges](std::size_t owner, std::vector<std::uint8_t> const &response)
+                {
+                    utils::shard_reader reader{response.data() + 1, response.data() + response.size()};
+
+                    for (auto count = reader.get32(); count; --count)
+                        ranges.push_back(shard_map::range{reader.get64(), owner});
+                });
+
+            std::sort(
+                ranges.begin(), ranges.end(),
+                [](shard_map::range const &lhs, shard_map::range const &rhs)
+                { return lhs.start < rhs.start; });
+
+            try
+            {
+                return sharded_bloom(transport, shard_map{std::move(ranges)}, hash);
+            }
+            catch (std::invalid_argument const &e)
+            {
+                throw std::runtime_error{e.what()};
+            }
+        }
+
+        /// @brief Add the value into the filter. Prefer inserting values in batches, which takes a single round trip to each owner.
+        inline void insert(T const &value)
+        {
+            insert(&value, &value + 1);
+        }
+
+        /// @brief Add a range of values into the filter.
+        /// @throw std::runtime_error if an owner fails.
+        template <typename It>
+        inline void insert(It first, It last)
+        {
+            std::vector<std::uint64_t> hashes;
+            hashes.reserve(batch_size);
+
+            while (first != last)
+            {
+                hashes.clear();
+
+                for (; first != last && hashes.size() < batch_size; ++first)
+                    hashes.push_back(utils::mix64(static_cast<Hash const &>(*this)(*first)));
+
+                exchange(utils::shard_op::insert, hashes, nullptr);
+            }
+        }
+
+        /// @brief Check whether the given value *might* be present in the filter. While this function can return false positives, it will never return false negatives.
+        /// Ie. `matches(x)` might be wrong, but `!matches(x)` is always correct.
+        /// @param value The value to check.
+        /// @throw std::runtime_error if an owner fails.
+        template <typename U>
+        inline bool matches(U &&value) const
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            std::vector<std::uint64_t> const hashes{utils::mix64(static_cast<Hash const &>(*this)(value))};
+            bool found;
+
+            exchange(utils::shard_op::matches, hashes, &found);
+
+            return found;
+        }
+
+        /// @brief Check a range of values against the filter.
+        /// @param out Where to write whether each value *might* be present, in order.
+        /// @return The number of values that might be present.
+        /// @throw std::runtime_error if an owner fails.
+        template <typename It>
+        inline std::size_t matches(It first, It last, bool *out) const
+        {
+            std::vector<std::uint64_t> hashes;
+            hashes.reserve(batch_size);
+
+            std::size_t count{};
+
+            while (first != last)
+            {
+                hashes.clear();
+
+                for (; first != last && hashes.size() < batch_size; ++first)
+                    hashes.push_back(utils::mix64(static_cast<Hash const &>(*this)(*first)));
+
+                exchange(utils::shard_op::matches, hashes, out);
+
+                for (std::size_t i{}; i < hashes.size(); ++i)
+                    count += out[i];
+
+                out += hashes.size();
+            }
+
+            return count;
+        }
+
+        /// @brief Split a range in two halves, and hand the upper half over to another owner (or to the same one).
+        /// The new owner gets a copy of the bits of the whole range, so that values inserted before the split keep matching.
+        /// @param range The index of the range in `map().ranges()`.
+        /// @param owner The owner of the upper half.
+        /// @return The index of the upper half.
+        /// @throw std::invalid_argument if the range cannot be split, std::runtime_error if an owner fails.
+        inline std::size_t split(std::size_t range, std::size_t owner)
+        {
+            auto next = table;
+            auto const upper = next.split(range, owner);
+            auto const &from = table.ranges()[range];
+
+            utils::shard_writer request;
+            request.put8(static_cast<std::uint8_t>(utils::shard_op::copy));
+            request.put64(from.start);
+
+            std::vector<std::pair<std::size_t, std::vector<std::uint8_t>>> requests;
+            requests.emplace_back(from.owner, std::move(request.bytes));
+
+            round_trip(
+                requests,
+                [&requests](std::size_t, std::vector<std::uint8_t> const &bits)
+                { requests[0].second = bits; });
+
+            // the copy comes back as `bits hashes words...`, which is the tail of a paste request.
+            auto &bits = requests[0].second;
+
+            bits[0] = static_cast<std::uint8_t>(utils::shard_op::paste);
+            bits.insert(bits.begin() + 1, 8, 0);
+            utils::store_le64(bits.data() + 1, next.ranges()[upper].start);
+
+            requests[0].first = owner;
+            round_trip(requests, [](std::size_t, std::vector<std::uint8_t> const &) {});
+
+            table = std::move(next);
+
+            return upper;
+        }
+
+        /// @brief The ranges of the filter and their owners.
+        inline shard_map const &map() const noexcept
+        {
+            return table;
+        }
+
+        /// @brief The hash function used by the filter.
+        inline Hash const &hash_function() const noexcept
+        {
+            return *this;
+        }
+
+    private:
+        // the ranges already exist on the owners.
+        inline sharded_bloom(Transport &transport, shard_map map, Hash const &hash)
+            : Hash(hash),
+              transport{&transport},
+              table{std::move(map)}
+        {
+        }
+
+        template <typename F>
+        inline void round_trip(std::vector<std::pair<std::size_t, std::vector<std::uint8_t>>> const &requests, F &&done) const
+        {
+            if (broken)
+                throw std::runtime_error{"The transport of the filter failed before, so the state of the owners is unknown!"};
+
+            utils::shard_round_trip(*transport, requests, broken, std::forward<F>(done));
+        }
+
+        // send one request per owner with the hashes of all its ranges, then gather the results back in the order of `hashes`.
+        inline void exchange(utils::shard_op op, std::vector<std::uint64_t> const &hashes, bool *out) const
+        {
+            auto const &ranges = table.ranges();
+            auto const owners = transport->owners();
+
+            // counting sort of the hashes by range.
+            std::vector<std::size_t> route(hashes.size());
+            std::vector<std::size_t> first(ranges.size() + 1);
+
+            for (std::size_t i{}; i < hashes.size(); ++i)
+            {
+                route[i] = table.route(hashes[i]);
+                ++first[route[i] + 1];
+            }
+
+            for (std::size_t r{}; r < ranges.size(); ++r)
+                first[r + 1] += first[r];
+
+            std::vector<std::size_t> order(hashes.size());
+            auto fill = first;
+
+            for (std::size_t i{}; i < hashes.size(); ++i)
+                order[fill[route[i]]++] = i;
+
+            // the values of each owner, in the order of its request.
+            std::vector<std::vector<std::size_t>> sent(owners);
+            std::vector<utils::shard_writer> writers(owners);
+
+            for (std::size_t r{}; r < ranges.size(); ++r)
+            {
+                if (first[r] == first[r + 1])
+                    continue;
+
+                auto &request = writers[ranges[r].owner];
+
+                if (request.bytes.empty())
+                    request.put8(static_cast<std::uint8_t>(op));
+
+                request.put64(ranges[r].start);
+                request.put32(static_cast<std::uint32_t>(first[r + 1] - first[r]));
+
+                for (auto i = first[r]; i < first[r + 1]; ++i)
+                {
+                    request.put64(hashes[order[i]]);
+                    sent[ranges[r].owner].push_back(order[i]);
+                }
+            }
+
+            std::vector<std::pair<std::size_t, std::vector<std::uint8_t>>> requests;
+
+            for (std::size_t owner{}; owner < owners; ++owner)
+            {
+                if (!sent[owner].empty())
+                    requests.emplace_back(owner, std::move(writers[owner].bytes));
+            }
+
+            round_trip(
+                requests,
+                [&](std::size_t i, std::vector<std::uint8_t> const &response)
+                {
+                    if (op != utils::shard_op::matches)
+                        return;
+
+                    auto const &values = sent[requests[i].first];
+
+                    if (response.size() < 1 + (values.size() + 7) / 8)
+                        throw std::runtime_error{"Truncated response from a shard owner!"};
+
+                    for (std::size_t j{}; j < values.size(); ++j)
+                        out[values[j]] = (response[1 + j / 8] >> (j & 7)) & 1;
+                });
+        }
+
+        Transport *transport;
+        shard_map table;
+        mutable bool broken{};
+    };
+}
+
+#undef TNT_UNIX_SOCKETS
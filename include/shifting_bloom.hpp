@@ -0,0 +1,234 @@
+
+#pragma once
+
+#include "bloom_filter.hpp"
+
+#if defined(__cpp_constexpr_dynamic_alloc) && (__cpp_constexpr_dynamic_alloc >= 201907L)
+#define CONST_ALLOC constexpr
+#else
+#define CONST_ALLOC inline
+#endif
+
+#if defined(__cpp_lib_constexpr_algorithms) && (__cpp_lib_constexpr_algorithms >= 202306L)
+#define CONST_SWAP constexpr
+#else
+#define CONST_SWAP inline
+#endif
+
+namespace tnt
+{
+    /// @brief A shifting bloom filter (Yang et al.) answering multi-set association queries: it tells which of several disjoint sets *might* contain an element.
+    /// An element of set `s` sets the bits at offset `s` from each of its `k` probe positions. A query reads the `Sets` bits following each probe position
+    /// in one (possibly unaligned) 64-bit load and intersects them, so a single pass of `k` probes returns the candidate sets as a bitmask,
+    /// instead of querying one bloom filter per set.
+    /// @tparam T The type of the elements to be inserted into the filter.
+    /// @tparam Sets The number of disjoint sets, at most 64. Defaults to 8.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        std::size_t Sets = 8,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class shifting_bloom final
+        : private Hash,
+          private utils::deduce_allocator<Alloc>::type
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        static_assert(Sets > 0 && Sets <= 64, "A shifting bloom filter supports between 1 and 64 sets!");
+
+        using allocator_type = typename utils::deduce_allocator<Alloc>::type;
+
+        inline static constexpr std::uint64_t sets_mask = Sets == 64 ? ~std::uint64_t{} : (std::uint64_t{1} << Sets) - 1;
+
+    public:
+        /// @brief Construct a new instance of the filter, given the total number of elements of all the sets and the desired false positive rate.
+        /// @param n The total number of elements to be inserted into the filter.
+        /// @param eps The desired false positive rate for each set. Defaults to 0.01 (1% false positives).
+        /// @param hash The hash function to be used for hashing the elements.
+        /// @param alloc The allocator to be used for memory management.
+        CONST_ALLOC shifting_bloom(
+            std::size_t n,
+            float eps = 0.01f,
+            Hash const &hash = Hash{},
+            allocator_type const &alloc = allocator_type{})
+            : Hash(hash),
+              allocator_type(alloc)
+        {
+            auto const nlog_eps = -std::log(eps);
+            auto const log_2 = 0.6931471805599453f;
+
+            m = std::max(static_cast<std::size_t>(n * nlog_eps / (log_2 * log_2)), std::size_t{1});
+            k = static_cast<std::size_t>(nlog_eps / log_2);
+            mod = utils::fast_modulo{m};
+
+            auto const len = words();
+            bits = allocator_type::allocate(len);
+            std::fill_n(bits, len, 0);
+        }
+
+        /// @brief The copy constructor.
+        CONST_ALLOC shifting_bloom(shifting_bloom const &rhs) noexcept
+            : Hash(rhs),
+              allocator_type(rhs),
+              m{rhs.m}, k{rhs.k}, mod{rhs.mod}
+        {
+            auto const len = words();
+            bits = allocator_type::allocate(len);
+            std::copy_n(rhs.bits, len, bits);
+        }
+
+        /// @brief The copy assignment operator.
+        CONST_ALLOC shifting_bloom &operator=(shifting_bloom const &rhs) noexcept
+        {
+            shifting_bloom tmp{rhs};
+            swap(*this, tmp);
+
+            return *this;
+        }
+
+        /// @brief The move constructor.
+        CONST_SWAP shifting_bloom(shifting_bloom &&rhs) noexcept
+            : Hash(rhs),
+              allocator_type(rhs),
+              m{}, k{}, bits{}
+        {
+            swap(*this, rhs);
+        }
+
+        /// @brief The move assignment operator.
+        CONST_SWAP shifting_bloom &operator=(shifting_bloom &&rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        /// @brief The destructor.
+        CONST_ALLOC ~shifting_bloom() noexcept
+        {
+            if (bits)
+                allocator_type::deallocate(bits, words());
+        }
+
+        /// @brief Add the value into the given set.
+        /// @param value The value to insert.
+        /// @param set The index of the set the value belongs to, less than `Sets`.
+        constexpr void insert(T const &value, std::size_t set) noexcept
+        {
+            auto const hash = static_cast<Hash const &>(*this)(value);
+            auto const step = hash & utils::size_traits::low_mask;
+
+            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+
+                auto const index = mod(h) + set;
+                bits[index >> 6] |= std::size_t{1} << (index & 63);
+            }
+        }
+
+        /// @brief Find the sets that *might* contain the given value. A set that is not part of the result never contains the value.
+        /// @param value The value to check.
+        /// @return A bitmask where bit `s` is set if set `s` might contain the value.
+        template <typename U>
+        constexpr std::uint64_t candidates(U &&value) const noexcept
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            auto const hash = static_cast<Hash const &>(*this)(value);
+            auto const step = hash & utils::size_traits::low_mask;
+
+            auto h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+
+            auto found = sets_mask;
+
+            for (std::size_t i{}; i < k && found; ++i)
+            {
+                h += i * step;
+
+                auto const index = mod(h);
+                auto const offset = index & 63;
+
+                // the `Sets` bits starting at `index`, which might straddle two words.
+                auto window = bits[index >> 6] >> offset;
+                if (offset != 0)
+                    window |= bits[(index >> 6) + 1] << (64 - offset);
+
+                found &= window;
+            }
+
+            return found;
+        }
+
+        /// @brief Check whether the given value *might* be present in the given set. While this function can return false positives, it will never return false negatives.
+        /// @param value The value to check.
+        /// @param set The index of the set, less than `Sets`.
+        template <typename U>
+        constexpr bool matches(U &&value, std::size_t set) const noexcept
+        {
+            return (candidates(static_cast<U &&>(value)) >> set) & 1;
+        }
+
+        /// @brief Remove all elements from all the sets.
+        constexpr void clear() noexcept
+        {
+            std::fill_n(bits, words(), 0);
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend CONST_SWAP void swap(shifting_bloom &lhs, shifting_bloom &rhs) noexcept
+        {
+            std::swap(static_cast<Hash &>(lhs), static_cast<Hash &>(rhs));
+
+            // bit-fields cannot bind to references, so they are swapped through copies.
+            std::size_t const m = lhs.m;
+            std::size_t const k = lhs.k;
+
+            lhs.m = rhs.m;
+            lhs.k = rhs.k;
+            rhs.m = m;
+            rhs.k = k;
+
+            std::swap(lhs.mod, rhs.mod);
+            std::swap(lhs.bits, rhs.bits);
+            std::swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+        }
+
+    private:
+        // one extra word at the end, so that windows starting near the end of the array can always be read.
+        constexpr std::size_t words() const noexcept
+        {
+            return (m >> 6) + ((m & 63) != 0) + 1;
+        }
+
+        std::size_t m : sizeof(std::size_t) * 8 - 8;
+        std::size_t k : 8;
+        utils::fast_modulo mod;
+        std::uint64_t *bits;
+    };
+
+    namespace pmr
+    {
+        /// @brief Specialization of shifting_bloom using a polymorphic allocator.
+        /// @tparam T The type of the elements to be inserted into the filter.
+        /// @tparam Sets The number of disjoint sets.
+        /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+        template <typename T, std::size_t Sets = 8, typename Hash = std::hash<T>>
+        using shifting_bloom = tnt::shifting_bloom<
+            T, Sets, Hash,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
+    }
+}
+
+#undef CONST_ALLOC
+#undef CONST_SWAP
@@ -0,0 +1,258 @@
+
+#pragma once
+
+#include "bloom_filter.hpp"
+
+#if defined(__cpp_constexpr_dynamic_alloc) && (__cpp_constexpr_dynamic_alloc >= 201907L)
+#define CONST_ALLOC constexpr
+#else
+#define CONST_ALLOC inline
+#endif
+
+#if defined(__cpp_lib_constexpr_algorithms) && (__cpp_lib_constexpr_algorithms >= 202306L)
+#define CONST_SWAP constexpr
+#else
+#define CONST_SWAP inline
+#endif
+
+namespace tnt
+{
+    /// @brief A spectral bloom filter (Cohen and Matias) estimates how many times each element was inserted, rather than just whether it was inserted.
+    /// Each bit of a bloom filter is replaced by a small saturating counter. Insertions use the minimum-increase rule, which only raises the smallest counters of an element,
+    /// and `count` returns the minimum of the element's counters. The estimate never undercounts, and it is usually tighter than a count-min sketch of the same size on skewed streams.
+    /// Counters are packed into 64-bit words, and all the counters of an element live in the same 64-byte block.
+    /// Counters have a fixed width rather than a variable one: they saturate at `max_count`, after which the estimates of the elements that reach it stop growing.
+    /// Pick `Width` for the largest count that must be told apart, eg. 8 for counts up to 255.
+    /// @tparam T The type of the elements to be inserted into the filter.
+    /// @tparam Width The number of bits of each counter. Must be one of 2, 4, 8 or 16. Defaults to 4, ie. counts up to 15.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        std::size_t Width = 4,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class spectral_bloom final
+        : private Hash,
+          private utils::deduce_allocator<Alloc>::type
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        static_assert(
+            Width == 2 || Width == 4 || Width == 8 || Width == 16,
+            "Counters must be 2, 4, 8 or 16 bits wide!");
+
+        using allocator_type = typename utils::deduce_allocator<Alloc>::type;
+
+        inline static constexpr std::size_t block_words = 8;
+        inline static constexpr std::size_t block_counters = block_words * 64 / Width;
+        inline static constexpr std::uint64_t counter_mask = (std::uint64_t{1} << Width) - 1;
+
+    public:
+        /// @brief The biggest value a counter can hold. Counters saturate at this value.
+        inline static constexpr std::size_t max_count = counter_mask;
+
+        /// @brief Construct a new instance of the filter, given the number of distinct elements and the desired false positive rate.
+        /// The filter holds as many counters as `tnt::bloom_filter` holds bits for the same parameters.
+        /// @param n The number of distinct elements to be inserted into the filter.
+        /// @param eps The desired false positive rate. Defaults to 0.01 (1% false positives).
+        /// @param hash The hash function to be used for hashing the elements.
+        /// @param alloc The allocator to be used for memory management.
+        CONST_ALLOC spectral_bloom(
+            std::size_t n,
+            float eps = 0.01f,
+            Hash const &hash = Hash{},
+            allocator_type const &alloc = allocator_type{})
+            : Hash(hash),
+              allocator_type(alloc)
+        {
+            auto const nlog_eps = -std::log(eps);
+            auto const log_2 = 0.6931471805599453f;
+
+            auto const m = static_cast<std::size_t>(n * nlog_eps / (log_2 * log_2));
+            k = static_cast<std::size_t>(nlog_eps / log_2);
+
+            blocks = m / block_counters + (m % block_counters != 0);
+            blocks += blocks == 0;
+
+            allocate();
+            std::fill_n(counters, blocks * block_words, 0);
+        }
+
+        /// @brief The copy constructor.
+        CONST_ALLOC spectral_bloom(spectral_bloom const &rhs) noexcept
+            : Hash(rhs),
+              allocator_type(rhs),
+              blocks{rhs.blocks}, k{rhs.k}
+        {
+            allocate();
+            std::copy_n(rhs.counters, blocks * block_words, counters);
+        }
+
+        /// @brief The copy assignment operator.
+        CONST_ALLOC spectral_bloom &operator=(spectral_bloom const &rhs) noexcept
+        {
+            spectral_bloom tmp{rhs};
+            swap(*this, tmp);
+
+            return *this;
+        }
+
+        /// @brief The move constructor.
+        CONST_SWAP spectral_bloom(spectral_bloom &&rhs) noexcept
+            : Hash(rhs),
+              allocator_type(rhs)
+        {
+            swap(*this, rhs);
+        }
+
+        /// @brief The move assignment operator.
+        CONST_SWAP spectral_bloom &operator=(spectral_bloom &&rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        /// @brief The destructor.
+        CONST_ALLOC ~spectral_bloom() noexcept
+        {
+            if (data)
+                allocator_type::deallocate(data, blocks * block_words + block_words - 1);
+        }
+
+        /// @brief Add the value into the filter, using the minimum-increase rule.
+        /// Only the counters that are below the new estimate of the value are raised, and counters saturate at `max_count`.
+        /// @param value The value to insert.
+        /// @param times How many occurrences of the value to add. Defaults to 1.
+        constexpr void insert(T const &value, std::size_t times = 1) noexcept
+        {
+            auto const hash = remix(value);
+            auto const block = locate(hash);
+
+            auto target = min_count(hash, block) + times;
+            target = target > max_count ? max_count : target;
+
+            for_each_counter(hash, [&](std::size_t word, std::size_t shift)
+                             {
+                auto const current = (block[word] >> shift) & counter_mask;
+
+                if (current < target)
+                    block[word] = (block[word] & ~(counter_mask << shift)) | (std::uint64_t{target} << shift); });
+        }
+
+        /// @brief Estimate how many times the value was inserted. The estimate is never smaller than the real count, unless the counters saturated.
+        /// @param value The value to look up.
+        /// @return The minimum over the counters of the value, at most `max_count`.
+        template <typename U>
+        constexpr std::size_t count(U &&value) const noexcept
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            auto const hash = remix(value);
+            return min_count(hash, locate(hash));
+        }
+
+        /// @brief Check whether the given value *might* be present in the filter. While this function can return false positives, it will never return false negatives.
+        /// @param value The value to check.
+        template <typename U>
+        constexpr bool matches(U &&value) const noexcept
+        {
+            return count(static_cast<U &&>(value)) != 0;
+        }
+
+        /// @brief Reset all counters to zero.
+        constexpr void clear() noexcept
+        {
+            std::fill_n(counters, blocks * block_words, 0);
+        }
+
+        /// @brief Swap the contents of two filters together.
+        friend CONST_SWAP void swap(spectral_bloom &lhs, spectral_bloom &rhs) noexcept
+        {
+            std::swap(lhs.blocks, rhs.blocks);
+            std::swap(lhs.k, rhs.k);
+            std::swap(lhs.data, rhs.data);
+            std::swap(lhs.counters, rhs.counters);
+            std::swap(static_cast<allocator_type &>(lhs), static_cast<allocator_type &>(rhs));
+        }
+
+    private:
+        // over-allocate by a block, so that the counters can start on a 64-byte boundary.
+        CONST_ALLOC void allocate()
+        {
+            data = allocator_type::allocate(blocks * block_words + block_words - 1);
+
+            auto const offset = reinterpret_cast<std::uintptr_t>(data) / sizeof(std::uint64_t) % block_words;
+            counters = data + (offset ? block_words - offset : 0);
+        }
+
+        // the hash is remixed with a multiplication by an odd constant first, so that weak hashes (like the identity hash of integers)
+        // still spread over all blocks. The high half selects the block, then `bloom_filter`'s double hashing picks the counters inside it.
+        template <typename U>
+        constexpr std::size_t remix(U const &value) const noexcept
+        {
+            return static_cast<Hash const &>(*this)(value) * static_cast<std::size_t>(0x9e3779b97f4a7c15ull);
+        }
+
+        constexpr std::uint64_t *locate(std::size_t hash) const noexcept
+        {
+            auto const h = (hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift;
+            return counters + h % blocks * block_words;
+        }
+
+        template <typename Fn>
+        constexpr void for_each_counter(std::size_t hash, Fn &&fn) const noexcept
+        {
+            auto const step = hash & utils::size_traits::low_mask;
+
+            auto h = ((hash & utils::size_traits::high_mask) >> utils::size_traits::high_shift) / blocks;
+
+            for (std::size_t i{}; i < k; ++i)
+            {
+                h += i * step;
+
+                auto const index = (h % block_counters) * Width;
+                fn(index >> 6, index & 63);
+            }
+        }
+
+        constexpr std::size_t min_count(std::size_t hash, std::uint64_t const *block) const noexcept
+        {
+            std::size_t result{max_count};
+
+            for_each_counter(hash, [&](std::size_t word, std::size_t shift)
+                             {
+                auto const current = static_cast<std::size_t>((block[word] >> shift) & counter_mask);
+                result = current < result ? current : result; });
+
+            return result;
+        }
+
+        std::size_t blocks{};
+        std::size_t k{};
+        std::uint64_t *data{};
+        std::uint64_t *counters{};
+    };
+
+    namespace pmr
+    {
+        /// @brief Specialization of spectral_bloom using a polymorphic allocator.
+        /// @tparam T The type of the elements to be inserted into the filter.
+        /// @tparam Width The number of bits of each counter.
+        /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+        template <typename T, std::size_t Width = 4, typename Hash = std::hash<T>>
+        using spectral_bloom = tnt::spectral_bloom<
+            T, Width, Hash,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
+    }
+}
+
+#undef CONST_ALLOC
+#undef CONST_SWAP
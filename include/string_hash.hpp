@@ -0,0 +1,284 @@
+
+#pragma once
+
+#include <cstring>
+#include <string_view>
+
+#include "internal/utils.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // A string hash built from 64-bit words and 32x32-bit multiplications only, so that SIMD lanes can each hash their own string in lockstep.
+    // Every step is the same in the scalar and in the vectorized code, so both give the same hashes.
+    struct string_hash_impl final
+    {
+        inline static constexpr std::uint64_t seed = 0x243f'6a88'85a3'08d3;
+        inline static constexpr std::uint64_t length_key = 0x9e37'79b9'7f4a'7c15;
+        inline static constexpr std::uint64_t word_key = 0xc2b2'ae3d'27d4'eb4f;
+
+        static constexpr std::uint64_t init(std::size_t len) noexcept
+        {
+            return seed ^ (len * length_key);
+        }
+
+        // each word is mixed with its own key, so that swapping two words changes the hash.
+        static constexpr std::uint64_t key(std::size_t word) noexcept
+        {
+            return word_key * (word + 1);
+        }
+
+        static constexpr std::uint64_t step(std::uint64_t acc, std::uint64_t w, std::uint64_t key) noexcept
+        {
+            auto const x = w ^ key;
+            return (acc ^ (acc >> 29)) + w + (x & 0xffff'ffff) * (x >> 32);
+        }
+
+        static inline std::uint64_t load64(char const *p) noexcept
+        {
+            std::uint64_t w;
+            std::memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+            w = __builtin_bswap64(w);
+#endif
+            return w;
+        }
+
+        static inline std::uint32_t load32(char const *p) noexcept
+        {
+            std::uint32_t w;
+            std::memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+            w = __builtin_bswap32(w);
+#endif
+            return w;
+        }
+
+        static constexpr std::size_t words(std::size_t len) noexcept
+        {
+            return (len + 7) / 8;
+        }
+
+        // the given word of the string, in little-endian order and padded with zeros.
+        // Tails are read with overlapping loads that end with the string, so nothing past it is ever read.
+        static inline std::uint64_t load(char const *p, std::size_t len, std::size_t word) noexcept
+        {
+            auto const from = word * 8;
+            auto const bytes = len - from;
+
+            if (bytes >= 8)
+                return load64(p + from);
+
+            if (len >= 8)
+                return load64(p + len - 8) >> (8 * (8 - bytes));
+
+            if (bytes >= 4)
+                return std::uint64_t{load32(p)} | std::uint64_t{load32(p + bytes - 4)} << (8 * (bytes - 4));
+
+            auto const byte = [p](std::size_t i)
+            { return std::uint64_t{static_cast<unsigned char>(p[i])}; };
+
+            return byte(0) | byte(bytes / 2) << (8 * (bytes / 2)) | byte(bytes - 1) << (8 * (bytes - 1));
+        }
+
+        static inline std::uint64_t hash(char const *p, std::size_t len) noexcept
+        {
+            auto acc = init(len);
+
+            for (std::size_t i{}, n = words(len); i < n; ++i)
+                acc = step(acc, load(p, len, i), key(i));
+
+            return mix64(acc);
+        }
+
+        // hash `n` strings, the i-th one starting at `data(i)` with `size(i)` bytes.
+        template <typename Data, typename Size>
+        static inline void batch(std::size_t n, Data &&data, Size &&size, std::uint64_t *out) noexcept
+        {
+            std::size_t i{};
+
+#if defined(__AVX512F__)
+            constexpr std::size_t lanes = 8;
+
+            for (; i + lanes <= n; i += lanes)
+            {
+                alignas(64) std::uint64_t begin[lanes];
+                alignas(64) std::uint64_t len[lanes];
+                alignas(64) std::uint64_t init_acc[lanes];
+                std::uint64_t shortest{~std::uint64_t{}}, longest{};
+
+                for (std::size_t j{}; j < lanes; ++j)
+                {
+                    begin[j] = reinterpret_cast<std::uintptr_t>(data(i + j));
+                    len[j] = size(i + j);
+                    init_acc[j] = init(len[j]);
+                    shortest = len[j] < shortest ? len[j] : shortest;
+                    longest = len[j] > longest ? len[j] : longest;
+                }
+
+                // strings shorter than a word are not worth the gathers.
+                if (shortest < 8)
+                {
+                    for (std::size_t j{}; j < lanes; ++j)
+                        out[i + j] = hash(reinterpret_cast<char const *>(begin[j]), len[j]);
+
+                    continue;
+                }
+
+                auto const vbegin = _mm512_load_si512(begin);
+                auto const vlen = _mm512_load_si512(len);
+                auto const last = _mm512_sub_epi64(_mm512_add_epi64(vbegin, vlen), _mm512_set1_epi64(8));
+
+                auto acc = _mm512_load_si512(init_acc);
+
+                for (std::size_t word{}, count = words(longest); word < count; ++word)
+                {
+                    auto const from = _mm512_set1_epi64(static_cast<long long>(word * 8));
+                    auto const active = _mm512_cmpgt_epu64_mask(vlen, from);
+
+                    // the tail word is the last 8 bytes of the string, shifted down to drop the bytes of the previous word.
+                    auto const address = _mm512_min_epu64(_mm512_add_epi64(vbegin, from), last);
+                    auto const shift = _mm512_slli_epi64(_mm512_max_epi64(_mm512_sub_epi64(_mm512_add_epi64(from, _mm512_set1_epi64(8)), vlen), _mm512_setzero_si512()), 3);
+
+                    auto const vw = _mm512_srlv_epi64(_mm512_mask_i64gather_epi64(_mm512_setzero_si512(), active, address, nullptr, 1), shift);
+                    auto const x = _mm512_xor_si512(vw, _mm512_set1_epi64(static_cast<long long>(key(word))));
+                    auto const product = _mm512_mul_epu32(x, _mm512_srli_epi64(x, 32));
+                    auto const next = _mm512_add_epi64(_mm512_add_epi64(_mm512_xor_si512(acc, _mm512_srli_epi64(acc, 29)), vw), product);
+
+                    acc = _mm512_mask_mov_epi64(acc, active, next);
+                }
+
+                alignas(64) std::uint64_t result[lanes];
+                _mm512_store_si512(result, acc);
+
+                for (std::size_t j{}; j < lanes; ++j)
+                    out[i + j] = mix64(result[j]);
+            }
+#elif defined(__AVX2__)
+            constexpr std::size_t lanes = 4;
+
+            for (; i + lanes <= n; i += lanes)
+            {
+                alignas(32) std::uint64_t begin[lanes];
+                alignas(32) std::uint64_t len[lanes];
+                std::uint64_t shortest{~std::uint64_t{}}, longest{};
+
+                for (std::size_t j{}; j < lanes; ++j)
+                {
+                    begin[j] = reinterpret_cast<std::uintptr_t>(data(i + j));
+                    len[j] = size(i + j);
+                    shortest = len[j] < shortest ? len[j] : shortest;
+                    longest = len[j] > longest ? len[j] : longest;
+                }
+
+                // strings shorter than a word are not worth the gathers.
+                if (shortest < 8)
+                {
+                    for (std::size_t j{}; j < lanes; ++j)
+                        out[i + j] = hash(reinterpret_cast<char const *>(begin[j]), len[j]);
+
+                    continue;
+                }
+
+                auto const vbegin = _mm256_load_si256(reinterpret_cast<__m256i const *>(begin));
+                auto const vlen = _mm256_load_si256(reinterpret_cast<__m256i const *>(len));
+                auto const last = _mm256_sub_epi64(_mm256_add_epi64(vbegin, vlen), _mm256_set1_epi64x(8));
+
+                auto acc = _mm256_setr_epi64x(
+                    static_cast<long long>(init(len[0])), static_cast<long long>(init(len[1])),
+                    static_cast<long long>(init(len[2])), static_cast<long long>(init(len[3])));
+
+                for (std::size_t word{}, count = words(longest); word < count; ++word)
+                {
+                    auto const from = _mm256_set1_epi64x(static_cast<long long>(word * 8));
+
+                    // lengths and addresses are below 2^63, so signed comparisons are fine.
+                    auto const active = _mm256_cmpgt_epi64(vlen, from);
+
+                    // the tail word is the last 8 bytes of the string, shifted down to drop the bytes of the previous word.
+                    auto const next_address = _mm256_add_epi64(vbegin, from);
+                    auto const address = _mm256_blendv_epi8(next_address, last, _mm256_cmpgt_epi64(next_address, last));
+
+                    auto const over = _mm256_sub_epi64(_mm256_add_epi64(from, _mm256_set1_epi64x(8)), vlen);
+                    auto const shift = _mm256_slli_epi64(_mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_setzero_si256(), over), over), 3);
+
+                    auto const gathered = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(), static_cast<long long const *>(nullptr), address, active, 1);
+                    auto const vw = _mm256_srlv_epi64(gathered, shift);
+                    auto const x = _mm256_xor_si256(vw, _mm256_set1_epi64x(static_cast<long long>(key(word))));
+                    auto const product = _mm256_mul_epu32(x, _mm256_srli_epi64(x, 32));
+                    auto const next = _mm256_add_epi64(_mm256_add_epi64(_mm256_xor_si256(acc, _mm256_srli_epi64(acc, 29)), vw), product);
+
+                    acc = _mm256_blendv_epi8(acc, next, active);
+                }
+
+                alignas(32) std::uint64_t result[lanes];
+                _mm256_store_si256(reinterpret_cast<__m256i *>(result), acc);
+
+                for (std::size_t j{}; j < lanes; ++j)
+                    out[i + j] = mix64(result[j]);
+            }
+#endif
+
+            for (; i < n; ++i)
+                out[i] = hash(data(i), size(i));
+        }
+    };
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief A fast hash function for strings, that can also hash many strings at once, several of them in parallel across SIMD lanes (AVX2 or AVX-512 when enabled at compile time).
+    /// Single and batched hashing give the same hashes, so filters can be built with one and queried with the other.
+    /// The hashes are the same on every platform, but are not meant to be stable across versions of the library.
+    struct string_hash
+    {
+        using is_transparent = void;
+
+        /// @brief Hash a single string.
+        inline std::size_t operator()(std::string_view s) const noexcept
+        {
+            return static_cast<std::size_t>(utils::string_hash_impl::hash(s.data(), s.size()));
+        }
+
+        /// @brief Hash many strings at once.
+        /// @param keys The strings to hash.
+        /// @param n The number of strings.
+        /// @param out Where to write the hashes, must have room for `n` values.
+        inline void batch(std::string_view const *keys, std::size_t n, std::uint64_t *out) const noexcept
+        {
+            utils::string_hash_impl::batch(
+                n,
+                [keys](std::size_t i)
+                { return keys[i].data(); },
+                [keys](std::size_t i)
+                { return keys[i].size(); },
+                out);
+        }
+
+        /// @brief Hash many strings stored back to back in a buffer, with `n + 1` offsets into it (such as an Arrow string column).
+        /// @param offsets The offsets of the strings. String `i` spans from `offsets[i]` to `offsets[i + 1]`.
+        /// @param data The buffer holding the strings.
+        /// @param n The number of strings.
+        /// @param out Where to write the hashes, must have room for `n` values.
+        template <typename Offset>
+        inline void batch(Offset const *offsets, char const *data, std::size_t n, std::uint64_t *out) const noexcept
+        {
+            static_assert(std::is_integral_v<Offset>, "Offsets must be integers!");
+
+            utils::string_hash_impl::batch(
+                n,
+                [offsets, data](std::size_t i)
+                { return data + offsets[i]; },
+                [offsets](std::size_t i)
+                { return static_cast<std::size_t>(offsets[i + 1] - offsets[i]); },
+                out);
+        }
+    };
+}
@@ -0,0 +1,469 @@
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+
+#include "bloom_filter.hpp"
+
+#if defined(__AVX512BW__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#if defined(__cpp_lib_constexpr_algorithms) && (__cpp_lib_constexpr_algorithms >= 202306L)
+#define CONST_SWAP constexpr
+#else
+#define CONST_SWAP inline
+#endif
+
+/// @cond NO_DOXYGEN
+
+namespace tnt::utils
+{
+    // A cache line holding a mini quotient filter: 48 fingerprint slots, followed by 128 bits of metadata.
+    // The metadata encodes the 80 buckets in unary: a 1 terminates a bucket, and each 0 before it is an item of that bucket.
+    // Items are stored in bucket order, so the items of bucket b are the 0s between the (b - 1)-th and the b-th 1.
+    struct alignas(64) vqf_block final
+    {
+        inline static constexpr std::size_t slots = 48;
+        inline static constexpr std::size_t buckets = 80;
+
+        std::uint8_t fingerprints[slots];
+        std::uint64_t metadata[2];
+
+        inline void reset() noexcept
+        {
+            // 80 empty buckets.
+            metadata[0] = ~std::uint64_t{};
+            metadata[1] = (std::uint64_t{1} << (buckets - 64)) - 1;
+        }
+
+        // position of the 1 terminating the given bucket.
+        inline std::size_t select(std::size_t bucket) const noexcept
+        {
+            auto const low = popcount(metadata[0]);
+
+            return bucket < low
+                       ? select64(metadata[0], bucket)
+                       : 64 + select64(metadata[1], bucket - low);
+        }
+
+        inline std::size_t size() const noexcept
+        {
+            return select(buckets - 1) - (buckets - 1);
+        }
+
+        // bit i is set if slot i holds the given fingerprint. Slots past the last item hold garbage.
+        inline std::uint64_t match(std::uint8_t fp) const noexcept
+        {
+#if defined(__AVX512BW__)
+            return _mm512_cmpeq_epi8_mask(_mm512_load_si512(this), _mm512_set1_epi8(static_cast<char>(fp)));
+#elif defined(__AVX2__)
+            auto const lo = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                _mm256_load_si256(reinterpret_cast<__m256i const *>(fingerprints)),
+                _mm256_set1_epi8(static_cast<char>(fp))));
+            auto const hi = _mm_movemask_epi8(_mm_cmpeq_epi8(
+                _mm_load_si128(reinterpret_cast<__m128i const *>(fingerprints + 32)),
+                _mm_set1_epi8(static_cast<char>(fp))));
+
+            return std::uint64_t{static_cast<std::uint32_t>(lo)} | (std::uint64_t{static_cast<std::uint32_t>(hi)} << 32);
+#elif defined(__SSE2__) || defined(_M_X64)
+            auto const needle = _mm_set1_epi8(static_cast<char>(fp));
+            auto const ptr = reinterpret_cast<__m128i const *>(fingerprints);
+
+            std::uint64_t result{};
+            for (std::size_t i{}; i < 3; ++i)
+                result |= std::uint64_t{static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(ptr + i), needle)))} << (16 * i);
+
+            return result;
+#else
+            std::uint64_t result{};
+            for (std::size_t i{}; i < slots; ++i)
+                result |= std::uint64_t{fingerprints[i] == fp} << i;
+
+            return result;
+#endif
+        }
+
+        // the range of slots holding the items of the given bucket.
+        inline std::uint64_t bucket_mask(std::size_t bucket) const noexcept
+        {
+            auto const first = bucket == 0 ? 0 : select(bucket - 1) + 1 - bucket;
+            auto const last = select(bucket) - bucket;
+
+            return ((std::uint64_t{1} << last) - 1) & ~((std::uint64_t{1} << first) - 1);
+        }
+
+        inline bool contains(std::size_t bucket, std::uint8_t fp) const noexcept
+        {
+            return (match(fp) & bucket_mask(bucket)) != 0;
+        }
+
+        // the block must not be full.
+        inline void insert(std::size_t bucket, std::uint8_t fp) noexcept
+        {
+            auto const count = size();
+            auto const pos = select(bucket);
+            auto const slot = pos - bucket;
+
+#if defined(__AVX512VBMI__)
+            alignas(64) static constexpr std::uint8_t previous[64]{
+                0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30,
+                31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62};
+
+            // move the slots after the new item one position up, then write the new item, in registers.
+            auto v = _mm512_load_si512(this);
+            auto const moved = ((std::uint64_t{1} << (count + 1)) - 1) & ~((std::uint64_t{1} << (slot + 1)) - 1);
+
+            v = _mm512_mask_permutexvar_epi8(v, moved, _mm512_load_si512(previous), v);
+            v = _mm512_mask_set1_epi8(v, std::uint64_t{1} << slot, static_cast<char>(fp));
+            _mm512_mask_storeu_epi8(this, (std::uint64_t{1} << slots) - 1, v);
+#else
+            std::memmove(fingerprints + slot + 1, fingerprints + slot, count - slot);
+            fingerprints[slot] = fp;
+#endif
+
+            // insert a 0 at `pos` in the 128-bit metadata.
+            if (pos < 64)
+            {
+                auto const low = (std::uint64_t{1} << pos) - 1;
+
+                metadata[1] = (metadata[1] << 1) | (metadata[0] >> 63);
+                metadata[0] = (metadata[0] & low) | ((metadata[0] & ~low) << 1);
+            }
+            else
+            {
+                auto const low = (std::uint64_t{1} << (pos - 64)) - 1;
+                metadata[1] = (metadata[1] & low) | ((metadata[1] & ~low) << 1);
+            }
+        }
+
+        inline void erase(std::size_t bucket, std::size_t slot) noexcept
+        {
+            auto const count = size();
+            auto const pos = slot + bucket;
+
+#if defined(__AVX512VBMI__)
+            alignas(64) static constexpr std::uint8_t next[64]{
+                1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32,
+                33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 63};
+
+            auto v = _mm512_load_si512(this);
+            auto const moved = ((std::uint64_t{1} << (count - 1)) - 1) & ~((std::uint64_t{1} << slot) - 1);
+
+            v = _mm512_mask_permutexvar_epi8(v, moved, _mm512_load_si512(next), v);
+            _mm512_mask_storeu_epi8(this, (std::uint64_t{1} << slots) - 1, v);
+#else
+            std::memmove(fingerprints + slot, fingerprints + slot + 1, count - slot - 1);
+#endif
+
+            // remove the 0 at `pos` from the 128-bit metadata.
+            if (pos < 64)
+            {
+                auto const low = (std::uint64_t{1} << pos) - 1;
+
+                metadata[0] = (metadata[0] & low) | ((metadata[0] >> 1) & ~low) | (metadata[1] << 63);
+                metadata[1] >>= 1;
+            }
+            else
+            {
+                auto const low = (std::uint64_t{1} << (pos - 64)) - 1;
+                metadata[1] = (metadata[1] & low) | ((metadata[1] >> 1) & ~low);
+            }
+        }
+    };
+
+    static_assert(sizeof(vqf_block) == 64, "A VQF block must fill exactly one cache line!");
+
+    // a test-and-test-and-set spin lock, guarding one block.
+    struct vqf_lock final
+    {
+        inline void lock() noexcept
+        {
+            while (flag.exchange(true, std::memory_order_acquire))
+            {
+                while (flag.load(std::memory_order_relaxed))
+                {
+#if defined(__SSE2__) || defined(_M_X64)
+                    _mm_pause();
+#endif
+                }
+            }
+        }
+
+        inline void unlock() noexcept
+        {
+            flag.store(false, std::memory_order_release);
+        }
+
+        std::atomic<bool> flag{false};
+    };
+}
+
+/// @endcond
+
+namespace tnt
+{
+    /// @brief A vector quotient filter (Pandey et al.) is a dynamic filter that supports insertion, removal and concurrent access, designed for very high insertion rates.
+    /// The filter is made of cache-line sized blocks, each one a small quotient filter with 48 fingerprint slots spread over 80 buckets.
+    /// An element goes to the less loaded of two candidate blocks (power-of-two-choice), which keeps the filter usable up to about 90% load.
+    /// Each block has its own spin lock, so `insert`, `erase` and `matches` can be called concurrently from multiple threads.
+    /// Selecting buckets uses BMI2, and comparing and shifting fingerprints uses AVX2 or AVX-512 when enabled at compile time, with scalar fallbacks otherwise.
+    /// The false positive rate is about 0.4% at full load.
+    /// @tparam T The type of the elements to be inserted into the filter.
+    /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+    /// @tparam Alloc The allocator to be used for memory management. Defaults to std::allocator.
+    template <
+        typename T,
+        typename Hash = std::hash<T>,
+        typename Alloc = std::allocator<std::uint64_t>>
+    class vector_quotient_filter final
+        : private Hash,
+          private std::allocator_traits<Alloc>::template rebind_alloc<utils::vqf_block>,
+          private std::allocator_traits<Alloc>::template rebind_alloc<utils::vqf_lock>
+    {
+        static_assert(
+            utils::is_hashable_with<T, Hash>::value,
+            "Hash must be a callable object that returns a size_t!");
+
+        using block = utils::vqf_block;
+        using lock = utils::vqf_lock;
+
+        using block_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<block>;
+        using lock_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<lock>;
+
+    public:
+        /// @brief Construct a new instance of the filter, given the number of elements it should hold.
+        /// @param n The number of elements to be inserted into the filter.
+        /// @param hash The hash function to be used for hashing the elements.
+        /// @param alloc The allocator to be used for memory management.
+        explicit vector_quotient_filter(
+            std::size_t n,
+            Hash const &hash = Hash{},
+            Alloc const &alloc = Alloc{})
+            : Hash(hash),
+              block_allocator(alloc),
+              lock_allocator(alloc),
+              count{n * 10 / (block::slots * 9) + 2}
+        {
+            allocate();
+            clear();
+        }
+
+        /// @brief The copy constructor. The filter being copied must not be modified concurrently.
+        vector_quotient_filter(vector_quotient_filter const &rhs)
+            : Hash(rhs),
+              block_allocator(rhs),
+              lock_allocator(rhs),
+              count{rhs.count}
+        {
+            allocate();
+            std::copy_n(rhs.blocks, count, blocks);
+        }
+
+        /// @brief The copy assignment operator. Neither filter may be used concurrently.
+        vector_quotient_filter &operator=(vector_quotient_filter const &rhs)
+        {
+            vector_quotient_filter tmp{rhs};
+            swap(*this, tmp);
+
+            return *this;
+        }
+
+        /// @brief The move constructor.
+        vector_quotient_filter(vector_quotient_filter &&rhs) noexcept
+            : Hash(rhs),
+              block_allocator(rhs),
+              lock_allocator(rhs)
+        {
+            swap(*this, rhs);
+        }
+
+        /// @brief The move assignment operator.
+        vector_quotient_filter &operator=(vector_quotient_filter &&rhs) noexcept
+        {
+            swap(*this, rhs);
+            return *this;
+        }
+
+        /// @brief The destructor.
+        ~vector_quotient_filter() noexcept
+        {
+            if (blocks)
+            {
+                block_allocator::deallocate(blocks, count);
+
+                for (std::size_t i{}; i < count; ++i)
+                    locks[i].~lock();
+
+                lock_allocator::deallocate(locks, count);
+            }
+        }
+
+        /// @brief Add the value into the filter. Safe to call concurrently.
+        /// @param value The value to insert.
+        /// @return `false` if both candidate blocks are full, in which case the filter is left unchanged.
+        bool insert(T const &value) noexcept
+        {
+            auto const key = locate(value);
+            guard const g{*this, key};
+
+            auto const first = blocks[key.first].size();
+            auto const second = blocks[key.second].size();
+
+            auto const target = first <= second ? key.first : key.second;
+
+            if ((first <= second ? first : second) == block::slots)
+                return false;
+
+            blocks[target].insert(key.bucket, key.fingerprint);
+            return true;
+        }
+
+        /// @brief Remove one occurrence of the value from the filter. Safe to call concurrently.
+        /// Only erase values that were inserted, as erasing a false positive removes another value.
+        /// @param value The value to remove.
+        /// @return `true` if the fingerprint of the value was found.
+        template <typename U>
+        bool erase(U &&value) noexcept
+        {
+            auto const key = locate(value);
+            guard const g{*this, key};
+
+            for (auto const b : {key.first, key.second})
+            {
+                if (auto const found = blocks[b].match(key.fingerprint) & blocks[b].bucket_mask(key.bucket))
+                {
+                    blocks[b].erase(key.bucket, utils::countr_zero(found));
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /// @brief Check whether the given value *might* be present in the filter. While this function can return false positives, it will never return false negatives.
+        /// Safe to call concurrently.
+        /// @param value The value to check.
+        template <typename U>
+        bool matches(U &&value) const noexcept
+        {
+            using raw_u = std::decay_t<U>;
+
+            static_assert(
+                (std::is_same_v<raw_u, T> || utils::is_transparent<Hash>::value) &&
+                    utils::is_hashable_with<U, Hash>::value,
+                "This type is not hashable with the given hash function!");
+
+            auto const key = locate(value);
+
+            for (auto const b : {key.first, key.second})
+            {
+                locks[b].lock();
+                auto const found = blocks[b].contains(key.bucket, key.fingerprint);
+                locks[b].unlock();
+
+                if (found)
+                    return true;
+            }
+
+            return false;
+        }
+
+        /// @brief Remove all elements from the filter. Must not be called concurrently with other operations.
+        void clear() noexcept
+        {
+            for (std::size_t i{}; i < count; ++i)
+                blocks[i].reset();
+        }
+
+        /// @brief Swap the contents of two filters together. Neither filter may be used concurrently.
+        friend CONST_SWAP void swap(vector_quotient_filter &lhs, vector_quotient_filter &rhs) noexcept
+        {
+            std::swap(lhs.count, rhs.count);
+            std::swap(lhs.blocks, rhs.blocks);
+            std::swap(lhs.locks, rhs.locks);
+            std::swap(static_cast<block_allocator &>(lhs), static_cast<block_allocator &>(rhs));
+            std::swap(static_cast<lock_allocator &>(lhs), static_cast<lock_allocator &>(rhs));
+        }
+
+    private:
+        struct location final
+        {
+            std::size_t first;
+            std::size_t second;
+            std::size_t bucket;
+            std::uint8_t fingerprint;
+        };
+
+        // locks both candidate blocks, always in the same order to avoid deadlocks.
+        struct guard final
+        {
+            guard(vector_quotient_filter const &filter, location const &key) noexcept
+                : lo{filter.locks + (key.first < key.second ? key.first : key.second)},
+                  hi{filter.locks + (key.first < key.second ? key.second : key.first)}
+            {
+                lo->lock();
+
+                if (hi != lo)
+                    hi->lock();
+            }
+
+            ~guard() noexcept
+            {
+                if (hi != lo)
+                    hi->unlock();
+
+                lo->unlock();
+            }
+
+            lock *lo;
+            lock *hi;
+        };
+
+        template <typename U>
+        location locate(U const &value) const noexcept
+        {
+            auto const h = utils::mix64(static_cast<Hash const &>(*this)(value));
+
+            auto const first = static_cast<std::size_t>(((h >> 32) * count) >> 32);
+            auto const bucket = static_cast<std::size_t>((((h >> 8) & 0xffffff) * block::buckets) >> 24);
+            auto const fp = static_cast<std::uint8_t>(h);
+
+            // the second block only depends on the first one and on the stored bits, and the mapping is an involution.
+            // Elements sharing a fingerprint in a block thus share both blocks, so that `erase` can remove any of them.
+            auto const offset = static_cast<std::size_t>(utils::mix64((bucket << 8) | fp) % count);
+            auto const second = offset >= first ? offset - first : offset + count - first;
+
+            return {first, second, bucket, fp};
+        }
+
+        void allocate()
+        {
+            blocks = block_allocator::allocate(count);
+            locks = lock_allocator::allocate(count);
+
+            for (std::size_t i{}; i < count; ++i)
+                new (locks + i) lock{};
+        }
+
+        std::size_t count{};
+        block *blocks{};
+        lock *locks{};
+    };
+
+    namespace pmr
+    {
+        /// @brief Specialization of vector_quotient_filter using a polymorphic allocator.
+        /// @tparam T The type of the elements to be inserted into the filter.
+        /// @tparam Hash The hash function to be used for hashing the elements. Defaults to std::hash.
+        template <typename T, typename Hash = std::hash<T>>
+        using vector_quotient_filter = tnt::vector_quotient_filter<
+            T, Hash,
+            std::pmr::polymorphic_allocator<std::uint64_t>>;
+    }
+}
+
+#undef CONST_SWAP
@@ -0,0 +1,9 @@
+#include <spectral_bloom.hpp>
+#include <utility>
+int main(){
+  tnt::spectral_bloom<int> a{100}, b{200};
+  a.insert(1);
+  swap(a,b);
+  auto c = std::move(a);
+  return (int)c.count(1) + (int)b.count(1);
+}
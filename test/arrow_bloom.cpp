@@ -0,0 +1,245 @@
+
+#include "test.hpp"
+#include <arrow_bloom.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+namespace
+{
+    // an Arrow column owned by the test, exported the way a producer would.
+    struct column final
+    {
+        std::vector<std::uint8_t> validity;
+        std::vector<std::int64_t> values;
+        std::vector<std::int32_t> offsets;
+        std::string data;
+
+        void const *buffers[3]{};
+
+        ArrowArray array{};
+        ArrowSchema schema{};
+
+        column(char const *format, std::int64_t length, std::int64_t null_count)
+        {
+            array.length = length;
+            array.null_count = null_count;
+            array.buffers = buffers;
+            schema.format = format;
+        }
+
+        void finish()
+        {
+            buffers[0] = validity.empty() ? nullptr : validity.data();
+            buffers[1] = offsets.empty() ? static_cast<void const *>(values.data()) : offsets.data();
+            buffers[2] = data.data();
+            array.n_buffers = offsets.empty() ? 2 : 3;
+        }
+    };
+
+    bool bit(std::vector<std::uint8_t> const &bitmap, std::size_t i)
+    {
+        return (bitmap[i / 8] >> (i % 8)) & 1;
+    }
+}
+
+int main()
+{
+    "int64_test"_test = []
+    {
+        column keys{"l", 1'000, 0};
+
+        for (std::int64_t i{}; i < 1'000; ++i)
+            keys.values.push_back(i * 2);
+
+        keys.finish();
+
+        tnt::bloom_filter<std::int64_t> bloom{1'000, 0.01f};
+        tnt::arrow_insert(bloom, keys.array, keys.schema);
+
+        bool same{true};
+
+        for (std::int64_t i{}; i < 1'000; ++i)
+            same = same && bloom.matches(i * 2);
+
+        ensure(same) << "- Values inserted from a column should match";
+
+        // probe with every row of the second half of the column, skipping the first 500 rows through the offset.
+        column probes{"l", 500, 0};
+
+        for (std::int64_t i{}; i < 1'000; ++i)
+            probes.values.push_back(i);
+
+        probes.array.offset = 500;
+        probes.finish();
+
+        std::vector<std::uint8_t> bitmap((500 + 7) / 8);
+        auto const found = tnt::arrow_matches(bloom, probes.array, probes.schema, bitmap.data());
+
+        std::size_t expected{};
+
+        for (std::size_t i{}; i < 500; ++i)
+        {
+            same = same && bit(bitmap, i) == bloom.matches(static_cast<std::int64_t>(500 + i));
+            expected += bit(bitmap, i);
+        }
+
+        ensure(same) << "- The bitmap should hold the results of `matches`";
+        ensure(found == expected && found >= 250) << "- All the even values should be found";
+    };
+
+    "utf8_test"_test = []
+    {
+        column keys{"u", 100, 50};
+
+        keys.offsets.push_back(0);
+        keys.validity.resize(100 / 8 + 1);
+
+        for (int i{}; i < 100; ++i)
+        {
+            keys.data += "key-" + std::to_string(i);
+            keys.offsets.push_back(static_cast<std::int32_t>(keys.data.size()));
+
+            // odd rows are null.
+            if (i % 2 == 0)
+                keys.validity[i / 8] |= static_cast<std::uint8_t>(1 << (i % 8));
+        }
+
+        keys.finish();
+
+        tnt::bloom_filter<std::string_view> bloom{100, 0.001f};
+        tnt::arrow_insert(bloom, keys.array, keys.schema);
+
+        ensure(bloom.matches(std::string_view{"key-42"})) << "- Valid values should be inserted";
+        ensure(!bloom.matches(std::string_view{"key-43"})) << "- Null values should be skipped";
+
+        std::vector<std::uint8_t> bitmap(100 / 8 + 1);
+        tnt::arrow_matches(bloom, keys.array, keys.schema, bitmap.data());
+
+        bool same{true};
+
+        for (std::size_t i{}; i < 100; ++i)
+            same = same && bit(bitmap, i) == (i % 2 == 0);
+
+        ensure(same) << "- Null rows should never be present";
+    };
+
+    "batched_utf8_test"_test = []
+    {
+        column keys{"u", 1'000, 0};
+
+        keys.offsets.push_back(0);
+
+        for (int i{}; i < 1'000; ++i)
+        {
+            keys.data += "key-" + std::to_string(i);
+            keys.offsets.push_back(static_cast<std::int32_t>(keys.data.size()));
+        }
+
+        keys.array.offset = 10;
+        keys.array.length = 990;
+        keys.finish();
+
+        tnt::bloom_filter<std::string_view, tnt::string_hash> bloom{1'000, 0.01f};
+        tnt::arrow_insert(bloom, keys.array, keys.schema);
+
+        bool all{true};
+
+        for (int i{10}; i < 1'000; ++i)
+            all = all && bloom.matches(std::string_view{"key-" + std::to_string(i)});
+
+        ensure(all) << "- Strings hashed in batches should match the ones hashed one by one";
+    };
+
+    "dictionary_test"_test = []
+    {
+        // 4 distinct strings, the second one being null, and rows pointing to them in turn.
+        column dictionary{"u", 4, 1};
+
+        dictionary.offsets.push_back(0);
+        dictionary.validity.push_back(0b1101);
+
+        for (auto const value : {"red", "green", "blue", "cyan"})
+        {
+            dictionary.data += value;
+            dictionary.offsets.push_back(static_cast<std::int32_t>(dictionary.data.size()));
+        }
+
+        dictionary.finish();
+
+        column keys{"l", 100, 0};
+
+        for (std::int64_t i{}; i < 100; ++i)
+            keys.values.push_back(i % 3 == 0 ? 3 : i % 2);
+
+        keys.finish();
+        keys.array.dictionary = &dictionary.array;
+        keys.schema.dictionary = &dictionary.schema;
+
+        tnt::bloom_filter<std::string_view> bloom{100, 0.001f};
+        tnt::arrow_insert(bloom, keys.array, keys.schema);
+
+        ensure(bloom.matches(std::string_view{"red"}) && bloom.matches(std::string_view{"cyan"})) << "- Rows should be inserted as the values they point to";
+        ensure(!bloom.matches(std::string_view{"blue"}) && !bloom.matches(std::string_view{"3"})) << "- Values that no row points to, and indices, should not be inserted";
+        ensure(!bloom.matches(std::string_view{"green"})) << "- Rows pointing to a null value should be skipped";
+
+        std::vector<std::uint8_t> bitmap(100 / 8 + 1);
+        auto const found = tnt::arrow_matches(bloom, keys.array, keys.schema, bitmap.data());
+
+        bool same{true};
+        std::size_t expected{};
+
+        for (std::size_t i{}; i < 100; ++i)
+        {
+            auto const present = keys.values[i] != 1;
+
+            same = same && bit(bitmap, i) == present;
+            expected += present;
+        }
+
+        ensure(same && found == expected) << "- Rows pointing to a null value should never be present";
+
+        keys.values[42] = 4;
+
+        bool thrown{false};
+
+        try
+        {
+            tnt::arrow_insert(bloom, keys.array, keys.schema);
+        }
+        catch (std::invalid_argument const &)
+        {
+            thrown = true;
+        }
+
+        ensure(thrown) << "- Indices out of the dictionary should be rejected";
+    };
+
+    "unsupported_test"_test = []
+    {
+        column keys{"u", 0, 0};
+        keys.offsets.push_back(0);
+        keys.finish();
+
+        // std::hash<std::string> cannot hash a std::string_view.
+        tnt::bloom_filter<std::string> bloom{100, 0.01f};
+
+        bool thrown{false};
+
+        try
+        {
+            tnt::arrow_insert(bloom, keys.array, keys.schema);
+        }
+        catch (std::invalid_argument const &)
+        {
+            thrown = true;
+        }
+
+        ensure(thrown) << "- Columns that cannot be hashed by the filter should be rejected";
+    };
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+
+#include "test.hpp"
+#include <atomic_bloom.hpp>
+#include <bloom_cache.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+// an atomic filter that counts its insertions, so that it can be shared with per-thread caches.
+using versioned_atomic_bloom = tnt::basic_bloom<
+    int, mixed_hash,
+    tnt::classic_layout, tnt::modulo_reducer, tnt::early_exit_probe,
+    tnt::atomic_storage<std::allocator<std::uint64_t>>, tnt::versioned>;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        // const char * is fine here as the value is not stored
+        tnt::atomic_bloom<char const *> bloom{100, 0.01f};
+
+        bloom.insert("Hello");
+
+        ensure(bloom.matches("Hello")) << "- Bloom filter should contain 'Hello'";
+        ensure(!bloom.matches("World")) << "- Bloom filter should not contain 'World'";
+
+        bloom.clear();
+
+        ensure(!bloom.matches("Hello")) << "- Bloom filter should not contain 'Hello'";
+    };
+
+    "threads_test"_test = []
+    {
+        constexpr int threads = 4;
+        constexpr int per_thread = 50'000;
+
+        versioned_atomic_bloom bloom{threads * per_thread};
+        tnt::bloom_filter<int, mixed_hash> expected{threads * per_thread};
+
+        std::atomic<bool> stale{};
+        std::vector<std::thread> pool;
+
+        for (int t{}; t < threads; ++t)
+        {
+            pool.emplace_back(
+                [&bloom, &stale, t]
+                {
+                    // values inserted by this thread must match right away, whatever the other threads are doing.
+                    for (int i{t * per_thread}; i < (t + 1) * per_thread; ++i)
+                    {
+                        bloom.insert(i);
+
+                        if (!bloom.matches(i))
+                            stale = true;
+                    }
+                });
+        }
+
+        for (auto &thread : pool)
+            thread.join();
+
+        for (int i{}; i < threads * per_thread; ++i)
+            expected.insert(i);
+
+        bool same{true};
+
+        for (int i{}; i < 2 * threads * per_thread; ++i)
+            same = same && bloom.matches(i) == expected.matches(i);
+
+        ensure(!stale) << "- Values should match as soon as they are inserted";
+        ensure(same) << "- Concurrent insertion should set the same bits as a single thread";
+        ensure(bloom.version() == threads * per_thread) << "- Every insertion should be counted";
+    };
+
+    "cache_test"_test = []
+    {
+        constexpr int n = 200'000;
+
+        versioned_atomic_bloom bloom{n};
+        std::atomic<bool> done{};
+
+        // a reader caches results while the values are being inserted, then checks them once the writer is done.
+        std::thread reader{
+            [&bloom, &done]
+            {
+                tnt::bloom_cache<versioned_atomic_bloom, 1'024> cache{bloom};
+
+                while (!done.load(std::memory_order_acquire))
+                {
+                    for (int i{}; i < n; i += 97)
+                        cache.matches(i);
+                }
+
+                bool all{true};
+
+                for (int i{}; i < n; ++i)
+                    all = all && cache.matches(i);
+
+                ensure(all) << "- A cache should never keep a negative result for an inserted value";
+            }};
+
+        for (int i{}; i < n; ++i)
+            bloom.insert(i);
+
+        done.store(true, std::memory_order_release);
+        reader.join();
+    };
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+
+#include "test.hpp"
+#include <bloom_cache.hpp>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        tnt::versioned_bloom<int> bloom{1'000, 0.01f};
+        tnt::bloom_cache cache{bloom};
+
+        bool same{true};
+
+        for (int i{}; i < 1'000; ++i)
+            bloom.insert(i * 2);
+
+        // every key is queried several times, so most queries are cache hits.
+        for (int round{}; round < 4; ++round)
+            for (int i{}; i < 2'000; ++i)
+                same = same && cache.matches(i) == bloom.matches(i);
+
+        ensure(same) << "- The cache should give the same results as the filter";
+    };
+
+    "insert_test"_test = []
+    {
+        tnt::versioned_bloom<int> bloom{100, 0.01f};
+        tnt::bloom_cache<tnt::versioned_bloom<int>, 16> cache{bloom};
+
+        ensure(!cache.matches(42)) << "- An empty filter should not match";
+
+        bloom.insert(42);
+
+        ensure(cache.matches(42)) << "- A cached negative result should be dropped after an insertion";
+        ensure(cache.matches(42)) << "- A cached positive result should be kept";
+    };
+
+    "clear_test"_test = []
+    {
+        tnt::versioned_bloom<int> bloom{100, 0.01f};
+        tnt::bloom_cache cache{bloom};
+
+        bloom.insert(42);
+
+        ensure(cache.matches(42)) << "- The filter should contain 42";
+
+        bloom.clear();
+
+        ensure(!cache.matches(42)) << "- A cached positive result should be dropped after clearing the filter";
+    };
+
+    return 0;
+}
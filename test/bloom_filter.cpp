@@ -49,5 +49,206 @@ int main()
         ensure(bloom.matches("World")) << "- Bloom filter should contain 'World'";
     };
 
+    "fast_modulo_test"_test = []
+    {
+        // the bit layout of a filter must not depend on how the probe indices are reduced.
+        std::uint64_t const divisors[]{
+            1, 2, 3, 7, 64, 100, 958, 959, 9'585, 95'850'584,
+            (std::uint64_t{1} << 32) + 1, (std::uint64_t{1} << 63) - 1, std::uint64_t{1} << 63, ~std::uint64_t{}};
+
+        bool exact{true};
+
+        for (auto const d : divisors)
+        {
+            tnt::utils::fast_modulo const mod{d};
+
+            std::uint64_t n{};
+
+            for (int i{}; i < 10'000; ++i)
+            {
+                n = tnt::utils::mix64(n + i);
+                exact = exact && mod(n) == n % d && mod(n >> (i % 64)) == (n >> (i % 64)) % d;
+            }
+
+            exact = exact && mod(0) == 0 && mod(d - 1) == (d - 1) % d && mod(d) == 0 && mod(~std::uint64_t{}) == ~std::uint64_t{} % d;
+        }
+
+        ensure(exact) << "- The fast modulo should give the same results as `%`";
+    };
+
+    "fill_histogram_test"_test = []
+    {
+        struct identity_hash
+        {
+            inline std::size_t operator()(int value) const noexcept
+            {
+                return static_cast<std::size_t>(value);
+            }
+        };
+
+        tnt::bloom_filter<int, mixed_hash> good{100'000, 0.01f};
+        // the hash of small integers has an empty high half, so probes start at the beginning of the filter.
+        tnt::bloom_filter<int, identity_hash> skewed{100'000, 0.01f};
+
+        for (int i{}; i < 100'000; ++i)
+        {
+            good.insert(i);
+            skewed.insert(i);
+        }
+
+        auto const histogram = good.fill_histogram(100);
+
+        std::size_t covered{};
+
+        for (std::size_t r{}; r < histogram.counts.size(); ++r)
+            covered += histogram.size(r);
+
+        ensure(histogram.counts.size() <= 100 && covered == histogram.bits) << "- The regions should cover the whole filter";
+        ensure(std::abs(histogram.fill_ratio() - 0.5) < 0.05) << "- A full filter should have about half of its bits set";
+        ensure(histogram.skew() < 5.0) << "- A good hash should fill the regions evenly";
+
+        ensure(skewed.fill_histogram(100).skew() > 20.0) << "- A skewed hash should be detected";
+        ensure(skewed.fill_histogram(100).max_fill_ratio() > 0.9) << "- A skewed hash should saturate some regions";
+    };
+
+    "batch_insert_test"_test = []
+    {
+        // a tiny filter, so that many probes of the same batch hit the same words.
+        for (std::size_t n : {8, 100'000})
+        {
+            tnt::versioned_bloom<int, mixed_hash> one_by_one{n, 0.01f};
+            tnt::versioned_bloom<int, mixed_hash> batched{n, 0.01f};
+
+            std::vector<int> values;
+
+            for (int i{}; i < 10'007; ++i)
+                values.push_back(i % 3 == 0 ? 42 : i);
+
+            for (auto const value : values)
+                one_by_one.insert(value);
+
+            batched.insert(values.begin(), values.end());
+
+            bool same{true};
+
+            for (int i{}; i < 100'000; ++i)
+                same = same && one_by_one.matches(i) == batched.matches(i);
+
+            ensure(same) << "- Batched insertion should set the same bits as inserting one by one";
+            ensure(batched.version() == one_by_one.version()) << "- Batched insertion should count every value";
+        }
+    };
+
+    "empty_test"_test = []
+    {
+        // a filter sized for no elements still gets one block, so inserting into it stays in bounds.
+        tnt::bloom_filter<char const *> classic{0};
+        tnt::basic_bloom<char const *, std::hash<char const *>, tnt::blocked_layout, tnt::fast_range_reducer> blocked{0};
+
+        classic.insert("Hello");
+        blocked.insert("Hello");
+
+        ensure(classic.matches("Hello") && blocked.matches("Hello")) << "- Empty filters should still accept insertions";
+    };
+
+    "move_test"_test = []
+    {
+        tnt::bloom_filter<char const *> first{100, 0.01f};
+        tnt::bloom_filter<char const *> second{1'000, 0.001f};
+
+        first.insert("Hello");
+        second.insert("World");
+
+        swap(first, second);
+
+        ensure(first.matches("World") && !first.matches("Hello")) << "- Swapping should exchange the contents";
+
+        auto moved = std::move(second);
+
+        ensure(moved.matches("Hello") && !moved.matches("World")) << "- Moving should keep the contents";
+    };
+
+    "stateful_hash_test"_test = []
+    {
+        tnt::bloom_filter<int, seeded_hash> first{1'000, 0.01f, seeded_hash{1}};
+        tnt::bloom_filter<int, seeded_hash> second{1'000, 0.01f, seeded_hash{2}};
+
+        for (int i{}; i < 1'000; ++i)
+            first.insert(i);
+
+        second = std::move(first);
+
+        bool all{true};
+
+        for (int i{}; i < 1'000; ++i)
+            all = all && second.matches(i);
+
+        ensure(all && second.hash_function().seed == 1) << "- Moving should keep the hash that goes with the bits";
+    };
+
+    "policies_test"_test = []
+    {
+        static_assert(std::is_same_v<tnt::bloom_filter<int, mixed_hash>, tnt::basic_bloom<int, mixed_hash>>);
+
+        // no false negatives, a false positive rate close to the requested one, and the same bits from single and batched insertion.
+        auto const check = [](auto one_by_one, auto batched, double max_rate)
+        {
+            std::vector<int> values(20'000);
+
+            for (int i{}; i < 20'000; ++i)
+                values[i] = i * 3;
+
+            for (auto const value : values)
+                one_by_one.insert(value);
+
+            batched.insert(values.begin(), values.end());
+
+            bool all{true};
+            bool same{true};
+            std::size_t false_positives{};
+
+            for (auto const value : values)
+                all = all && one_by_one.matches(value) && batched.matches(value);
+
+            for (int i{}; i < 100'000; ++i)
+            {
+                false_positives += one_by_one.matches(i * 3 + 1);
+                same = same && one_by_one.matches(i * 3 + 1) == batched.matches(i * 3 + 1);
+            }
+
+            return all && same && false_positives < 100'000 * max_rate;
+        };
+
+        using std_storage = tnt::allocator_storage<std::allocator<std::uint64_t>>;
+
+        using blocked = tnt::basic_bloom<int, mixed_hash, tnt::blocked_layout, tnt::fast_range_reducer, tnt::branch_free_probe>;
+        using sectorized = tnt::basic_bloom<int, mixed_hash, tnt::sectorized_layout, tnt::mask_reducer, tnt::early_exit_probe>;
+        using masked = tnt::basic_bloom<int, mixed_hash, tnt::classic_layout, tnt::mask_reducer, tnt::branch_free_probe, std_storage>;
+        using fast_range = tnt::basic_bloom<int, mixed_hash, tnt::classic_layout, tnt::fast_range_reducer>;
+        using fixed = tnt::basic_bloom<int, mixed_hash, tnt::blocked_layout, tnt::mask_reducer, tnt::early_exit_probe, tnt::static_storage<std::size_t{1} << 18>>;
+
+        ensure(check(fast_range{20'000}, fast_range{20'000}, 0.015)) << "- The fast range reducer should work with the classic layout";
+        ensure(check(masked{20'000}, masked{20'000}, 0.015)) << "- The mask reducer should work with the classic layout";
+        ensure(check(blocked{20'000}, blocked{20'000}, 0.025)) << "- Blocked filters should have a false positive rate close to the requested one";
+        ensure(check(sectorized{20'000}, sectorized{20'000}, 0.025)) << "- Sectorized filters should have a false positive rate close to the requested one";
+        ensure(check(fixed{20'000}, fixed{20'000}, 0.015)) << "- Filters with static storage should work without allocating";
+
+        tnt::basic_bloom<int, mixed_hash, tnt::classic_layout, tnt::modulo_reducer, tnt::branch_free_probe> branch_free{1'000};
+        tnt::bloom_filter<int, mixed_hash> early_exit{1'000};
+
+        for (int i{}; i < 1'000; ++i)
+        {
+            branch_free.insert(i * 7);
+            early_exit.insert(i * 7);
+        }
+
+        bool same{true};
+
+        for (int i{}; i < 10'000; ++i)
+            same = same && branch_free.matches(i) == early_exit.matches(i);
+
+        ensure(same) << "- The probe policy should not change the results";
+    };
+
     return 0;
 }
\ No newline at end of file
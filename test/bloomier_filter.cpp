@@ -0,0 +1,75 @@
+#include "test.hpp"
+#include <bloomier_filter.hpp>
+
+#include <string>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "lookup_test"_test = []
+    {
+        std::vector<std::pair<std::string, int>> shards;
+
+        for (int i{}; i < 10'000; ++i)
+            shards.emplace_back("key-" + std::to_string(i), i % 13);
+
+        tnt::bloomier_filter<std::string, 4> shard_of{shards.begin(), shards.end()};
+
+        bool all_found{true};
+
+        for (auto const &[key, shard] : shards)
+            all_found = all_found && shard_of.lookup(key) == shard;
+
+        ensure(all_found) << "- Every key should be mapped to its value";
+    };
+
+    "membership_test"_test = []
+    {
+        std::vector<std::pair<int, int>> tiers;
+
+        for (int i{}; i < 10'000; ++i)
+            tiers.emplace_back(i, i % 8);
+
+        tnt::bloomier_filter<int, 3, 8> tier_of{tiers.begin(), tiers.end()};
+
+        bool all_found{true};
+
+        for (auto const &[key, tier] : tiers)
+            all_found = all_found && tier_of.find(key) == tier;
+
+        int false_positives{};
+
+        for (int i{10'000}; i < 110'000; ++i)
+            false_positives += tier_of.matches(i);
+
+        ensure(all_found) << "- Every key should be found with its value";
+        ensure(false_positives < 800) << "- The false positive rate should be about 2^-8";
+    };
+
+    "conflict_test"_test = []
+    {
+        std::pair<int, int> const pairs[]{{1, 1}, {2, 2}, {1, 1}, {1, 3}};
+
+        std::string message;
+
+        try
+        {
+            tnt::bloomier_filter<int> filter{pairs, pairs + 4};
+        }
+        catch (std::invalid_argument const &e)
+        {
+            message = e.what();
+        }
+
+        ensure(message.find("different values") != std::string::npos) << "- Mapping a key to different values should be rejected as such";
+
+        // repeating a key with the same value is fine.
+        tnt::bloomier_filter<int> filter{pairs, pairs + 3};
+
+        ensure(filter.lookup(1) == 1 && filter.lookup(2) == 2) << "- Repeated keys should keep their value";
+    };
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+
+#include "test.hpp"
+#include <composite_bloom.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        tnt::composite_bloom<std::uint32_t, std::uint64_t, std::string_view> bloom{100, 0.01f};
+
+        bloom.insert(1, 2, "2024-01-01");
+
+        ensure(bloom.matches(1, 2, "2024-01-01")) << "- Filter should contain the inserted row";
+        ensure(!bloom.matches(2, 1, "2024-01-01")) << "- Swapping columns should give another row";
+        ensure(!bloom.matches(1, 2, "2024-01-02")) << "- Filter should not contain other rows";
+        ensure(bloom.filter().matches(std::tuple<std::uint32_t, std::uint64_t, std::string_view>{1, 2, "2024-01-01"})) << "- Rows should also match as tuples";
+
+        bloom.clear();
+
+        ensure(!bloom.matches(1, 2, "2024-01-01")) << "- Filter should be empty after clearing";
+    };
+
+    "batch_hash_test"_test = []
+    {
+        // an odd number of rows, so that the SIMD lanes have a tail, with strings both shorter and longer than a word.
+        constexpr std::size_t n = 1'001;
+
+        std::vector<std::int32_t> tenants(n);
+        std::vector<double> scores(n);
+        std::vector<std::string> names(n);
+
+        for (std::size_t i{}; i < n; ++i)
+        {
+            tenants[i] = static_cast<std::int32_t>(i % 7) - 3;
+            scores[i] = i % 5 == 0 ? -0.0 : i * 0.5;
+            names[i] = std::string(i % 23, 'a' + i % 26);
+        }
+
+        tnt::composite_hash<std::int32_t, double, std::string> hash;
+        std::vector<std::uint64_t> hashes(n);
+
+        hash.batch(n, hashes.data(), tenants.data(), scores.data(), names.data());
+
+        bool same{true};
+
+        for (std::size_t i{}; i < n; ++i)
+            same = same && hashes[i] == hash(tenants[i], scores[i], names[i]);
+
+        ensure(same) << "- Batched hashing should give the same hashes as hashing rows one by one";
+        ensure(hash(1, -0.0, std::string{"x"}) == hash(1, 0.0, std::string{"x"})) << "- 0.0 and -0.0 should hash the same";
+    };
+
+    "collision_test"_test = []
+    {
+        // a dense grid of small numbers, as in (tenant_id, user_id, day) keys.
+        constexpr std::uint32_t tenants = 100, users = 1'000, days = 30;
+        constexpr std::size_t n = std::size_t{tenants} * users * days;
+
+        std::vector<std::uint32_t> a, b, c;
+        a.reserve(n);
+        b.reserve(n);
+        c.reserve(n);
+
+        for (std::uint32_t x{}; x < tenants; ++x)
+        {
+            for (std::uint32_t y{}; y < users; ++y)
+            {
+                for (std::uint32_t z{}; z < days; ++z)
+                {
+                    a.push_back(x);
+                    b.push_back(y);
+                    c.push_back(z);
+                }
+            }
+        }
+
+        tnt::composite_hash<std::uint32_t, std::uint32_t, std::uint32_t> hash;
+        std::vector<std::uint64_t> hashes(n);
+
+        hash.batch(n, hashes.data(), a.data(), b.data(), c.data());
+        std::sort(hashes.begin(), hashes.end());
+
+        auto const collisions = hashes.end() - std::unique(hashes.begin(), hashes.end());
+
+        ensure(collisions == 0) << "- Rows of small numbers should not have the same hash";
+        ensure(hash(16, 402, 3) != hash(25, 402, 28) && hash(83, 628, 1) != hash(92, 628, 2)) << "- Rows that differ in two columns should not have the same hash";
+    };
+
+    "columns_test"_test = []
+    {
+        constexpr std::size_t n = 100'000;
+
+        std::vector<std::uint32_t> tenants(n);
+        std::vector<std::uint64_t> users(n);
+        std::vector<std::uint16_t> days(n);
+
+        for (std::size_t i{}; i < n; ++i)
+        {
+            tenants[i] = static_cast<std::uint32_t>(i % 100);
+            users[i] = i / 100;
+            days[i] = static_cast<std::uint16_t>(i % 365);
+        }
+
+        tnt::composite_bloom<std::uint32_t, std::uint64_t, std::uint16_t> batched{n, 0.01f};
+        tnt::composite_bloom<std::uint32_t, std::uint64_t, std::uint16_t> one_by_one{n, 0.01f};
+
+        batched.insert_columns(n, tenants.data(), users.data(), days.data());
+
+        for (std::size_t i{}; i < n; ++i)
+            one_by_one.insert(tenants[i], users[i], days[i]);
+
+        // the same rows on the next day, which were never inserted.
+        std::vector<std::uint16_t> next_days(n);
+
+        for (std::size_t i{}; i < n; ++i)
+            next_days[i] = static_cast<std::uint16_t>(days[i] + 1);
+
+        std::unique_ptr<bool[]> found{new bool[n]};
+        auto const present = batched.matches_columns(n, found.get(), tenants.data(), users.data(), days.data());
+        auto const false_positives = batched.matches_columns(n, found.get(), tenants.data(), users.data(), next_days.data());
+
+        bool same{true};
+
+        for (std::size_t i{}; i < n; ++i)
+            same = same && found[i] == one_by_one.matches(tenants[i], users[i], next_days[i]);
+
+        ensure(present == n) << "- All inserted rows should match";
+        ensure(same) << "- Batched insertion and queries should agree with single rows";
+        ensure(false_positives < n / 100 * 2) << "- The false positive rate should be close to the requested one";
+    };
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include "test.hpp"
+#include <counting_quotient_filter.hpp>
+
+#include <vector>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        // const char * is fine here as the value is not stored
+        tnt::counting_quotient_filter<char const *> filter{100};
+
+        filter.insert("Hello");
+
+        ensure(filter.matches("Hello")) << "- Filter should contain 'Hello'";
+        ensure(!filter.matches("World")) << "- Filter should not contain 'World'";
+
+        filter.clear();
+
+        ensure(!filter.matches("Hello")) << "- Filter should not contain 'Hello'";
+
+        filter.insert("World");
+
+        ensure(filter.matches("World")) << "- Filter should contain 'World'";
+    };
+
+    "count_test"_test = []
+    {
+        // most values are inserted at most twice, the others need a few slots for their counters.
+        tnt::counting_quotient_filter<int> filter{3'000};
+
+        // skewed frequencies: value i is inserted 1000 / (i + 1) times.
+        bool inserted{true};
+
+        for (int i{}; i < 1'000; ++i)
+            inserted = inserted && filter.insert(i, 1'000 / (i + 1));
+
+        ensure(inserted) << "- A filter should never overflow before reaching its capacity";
+
+        int exact{};
+        bool never_lower{true};
+
+        for (int i{}; i < 1'000; ++i)
+        {
+            auto const count = filter.count(i);
+
+            exact += count == 1'000u / (i + 1);
+            never_lower = never_lower && count >= 1'000u / (i + 1);
+        }
+
+        ensure(never_lower) << "- The count of a value should never be lower than the number of insertions";
+        ensure(exact > 990) << "- The count of most values should be exact";
+
+        filter.insert(0, 1'000'000'000'000);
+
+        ensure(filter.count(0) >= 1'000'000'001'000) << "- Counters should grow as large as needed";
+    };
+
+    "erase_test"_test = []
+    {
+        tnt::counting_quotient_filter<int> filter{25'000};
+
+        bool inserted{true};
+
+        for (int i{}; i < 10'000; ++i)
+            inserted = inserted && filter.insert(i, i % 2 == 0 ? 5 : 1);
+
+        ensure(inserted) << "- A filter should never overflow before reaching its capacity";
+
+        for (int i{}; i < 10'000; ++i)
+            filter.erase(i);
+
+        bool evens_found{true};
+        int odds_found{};
+
+        for (int i{}; i < 10'000; ++i)
+        {
+            if (i % 2 == 0)
+                evens_found = evens_found && filter.count(i) >= 4;
+            else
+                odds_found += filter.matches(i);
+        }
+
+        ensure(evens_found) << "- Values inserted 5 times and erased once should be counted at least 4 times";
+        ensure(odds_found < 100) << "- Erased values should not be found anymore, besides false positives";
+    };
+
+    "false_positive_test"_test = []
+    {
+        tnt::counting_quotient_filter<int> filter{10'000};
+
+        for (int i{}; i < 10'000; ++i)
+            filter.insert(i);
+
+        int false_positives{};
+
+        for (int i{10'000}; i < 110'000; ++i)
+            false_positives += filter.matches(i);
+
+        ensure(false_positives < 500) << "- The false positive rate should be below 0.5%";
+    };
+
+    "merge_test"_test = []
+    {
+        tnt::counting_quotient_filter<int> lhs{10'000};
+        tnt::counting_quotient_filter<int> rhs{10'000};
+
+        for (int i{}; i < 4'000; ++i)
+            lhs.insert(i, 2);
+
+        for (int i{2'000}; i < 6'000; ++i)
+            rhs.insert(i, 3);
+
+        ensure(lhs.merge(rhs)) << "- Filters of the same size should be mergeable";
+
+        bool counted{true};
+
+        for (int i{}; i < 6'000; ++i)
+            counted = counted && lhs.count(i) >= (i < 2'000 ? 2u : (i < 4'000 ? 5u : 3u));
+
+        ensure(counted) << "- Merged counts should be the sum of both filters";
+
+        tnt::counting_quotient_filter<int> other{100'000};
+
+        ensure(!lhs.merge(other)) << "- Filters of different sizes should not be mergeable";
+    };
+
+    "resize_test"_test = []
+    {
+        tnt::counting_quotient_filter<int> filter{4'000};
+
+        for (int i{}; i < 1'000; ++i)
+            filter.insert(i, i % 10 + 1);
+
+        ensure(filter.resize(100'000)) << "- Growing the filter should succeed";
+
+        bool counted{true};
+
+        for (int i{}; i < 1'000; ++i)
+            counted = counted && filter.count(i) >= unsigned(i % 10 + 1);
+
+        ensure(counted) << "- Counts should be kept when growing the filter";
+
+        for (int i{1'000}; i < 50'000; ++i)
+            filter.insert(i);
+
+        bool found{true};
+
+        for (int i{}; i < 50'000; ++i)
+            found = found && filter.matches(i);
+
+        ensure(found) << "- A grown filter should hold more values";
+
+        ensure(!filter.resize(100)) << "- Shrinking below the number of values should fail";
+        ensure(filter.matches(0)) << "- A failed resize should leave the filter unchanged";
+    };
+
+    "serialize_test"_test = []
+    {
+        tnt::counting_quotient_filter<int, std::uint16_t> filter{1'000};
+
+        for (int i{}; i < 1'000; ++i)
+            filter.insert(i, i + 1);
+
+        std::vector<unsigned char> buffer(filter.serialized_size());
+        filter.serialize(buffer.data());
+
+        tnt::counting_quotient_filter<int, std::uint16_t> loaded{buffer.data(), buffer.size()};
+
+        bool same{true};
+
+        for (int i{}; i < 2'000; ++i)
+            same = same && loaded.count(i) == filter.count(i);
+
+        ensure(same) << "- A loaded filter should give the same counts";
+
+        bool thrown{};
+
+        try
+        {
+            tnt::counting_quotient_filter<int> wrong{buffer.data(), buffer.size()};
+        }
+        catch (std::invalid_argument const &)
+        {
+            thrown = true;
+        }
+
+        ensure(thrown) << "- Loading a filter with a different layout should throw";
+    };
+
+    return 0;
+}
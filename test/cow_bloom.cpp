@@ -0,0 +1,151 @@
+
+#include "test.hpp"
+#include <cow_bloom.hpp>
+
+#include <cstring>
+#include <thread>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        tnt::cow_bloom<int> bloom{1'000, 0.01f};
+        tnt::bloom_filter<int> reference{1'000, 0.01f};
+
+        for (int i{}; i < 1'000; ++i)
+        {
+            bloom.insert(i * 2);
+            reference.insert(i * 2);
+        }
+
+        bool same{true};
+
+        for (int i{}; i < 10'000; ++i)
+            same = same && bloom.matches(i) == reference.matches(i);
+
+        ensure(same) << "- The filter should match exactly like a bloom_filter of the same size";
+    };
+
+    "snapshot_test"_test = []
+    {
+        // about 1.2 MB of bits, so that it spans many pages.
+        tnt::cow_bloom<int> bloom{1'000'000, 0.01f};
+
+        for (int i{}; i < 1'000; ++i)
+            bloom.insert(i);
+
+        auto const snapshot = bloom.snapshot();
+
+#if defined(__linux__)
+        ensure(bloom.dirty_pages() == 0 && snapshot.dirty_pages() == 0) << "- Taking a snapshot should not copy any page";
+#endif
+
+        for (int i{1'000}; i < 2'000; ++i)
+            bloom.insert(i);
+
+        bool old_found{true}, new_found{true};
+        std::size_t leaked{};
+
+        for (int i{}; i < 1'000; ++i)
+            old_found = old_found && snapshot.matches(i) && bloom.matches(i);
+
+        for (int i{1'000}; i < 2'000; ++i)
+        {
+            new_found = new_found && bloom.matches(i);
+            leaked += snapshot.matches(i);
+        }
+
+        ensure(old_found) << "- Both the filter and the snapshot should match the values inserted before the snapshot";
+        ensure(new_found) << "- The filter should match the values inserted after the snapshot";
+        ensure(leaked < 10) << "- The snapshot should not see the values inserted after it";
+
+#if defined(__linux__)
+        ensure(bloom.dirty_pages() > 0 && bloom.dirty_pages() < bloom.size() / 4096) << "- Only the pages written after the snapshot should be copied";
+#endif
+    };
+
+    "chained_snapshot_test"_test = []
+    {
+        tnt::cow_bloom<int> bloom{100'000, 0.01f};
+
+        bloom.insert(1);
+        auto first = bloom.snapshot();
+
+        bloom.insert(2);
+
+        // the first snapshot is still alive, so this one copies the pages written since.
+        auto second = bloom.snapshot();
+
+        bloom.insert(3);
+        first.insert(4);
+
+        ensure(first.matches(1) && !first.matches(2) && !first.matches(3) && first.matches(4)) << "- A snapshot should only see its own insertions";
+        ensure(second.matches(1) && second.matches(2) && !second.matches(3) && !second.matches(4)) << "- A snapshot should see what was inserted before it";
+        ensure(bloom.matches(1) && bloom.matches(2) && bloom.matches(3) && !bloom.matches(4)) << "- The filter should not see the insertions of its snapshots";
+
+        first = bloom.snapshot();
+        second = first;
+
+        ensure(std::memcmp(first.data(), bloom.data(), bloom.size()) == 0) << "- A snapshot should have the same bits as the filter";
+        ensure(std::memcmp(second.data(), bloom.data(), bloom.size()) == 0) << "- A copy should have the same bits as the filter";
+    };
+
+    "background_test"_test = []
+    {
+        tnt::cow_bloom<int> bloom{100'000, 0.01f};
+
+        for (int round{}; round < 4; ++round)
+        {
+            for (int i{}; i < 10'000; ++i)
+                bloom.insert(round * 10'000 + i);
+
+            // read the snapshot on another thread while the filter keeps changing.
+            auto snapshot = bloom.snapshot();
+            bool found{true};
+
+            std::thread reader{[&]
+                               {
+                                   for (int i{}; i < (round + 1) * 10'000; ++i)
+                                       found = found && snapshot.matches(i);
+                               }};
+
+            for (int i{}; i < 10'000; ++i)
+                bloom.insert(1'000'000 + round * 10'000 + i);
+
+            reader.join();
+
+            ensure(found) << "- The snapshot should match everything inserted before it";
+        }
+    };
+
+    "clear_test"_test = []
+    {
+        tnt::cow_bloom<int> bloom{1'000, 0.01f};
+
+        bloom.insert(42);
+
+        auto const snapshot = bloom.snapshot();
+
+        bloom.clear();
+
+        ensure(!bloom.matches(42) && bloom.generation() == 1) << "- Clearing should remove all elements";
+        ensure(snapshot.matches(42)) << "- Clearing should not affect snapshots";
+    };
+
+    "move_test"_test = []
+    {
+        tnt::cow_bloom<int> bloom{1'000, 0.01f};
+
+        bloom.insert(42);
+
+        auto moved = std::move(bloom);
+
+        ensure(moved.matches(42)) << "- Moving should keep the contents";
+        ensure(bloom.dirty_pages() == 0) << "- A moved-from filter should have no pages to copy";
+    };
+
+    return 0;
+}
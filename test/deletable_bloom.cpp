@@ -0,0 +1,78 @@
+#include "test.hpp"
+#include <deletable_bloom.hpp>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        // const char * is fine here as the value is not stored
+        tnt::deletable_bloom<char const *> bloom{100, 0.01f};
+
+        bloom.insert("Hello");
+
+        ensure(bloom.matches("Hello")) << "- Bloom filter should contain 'Hello'";
+        ensure(!bloom.matches("World")) << "- Bloom filter should not contain 'World'";
+
+        bloom.clear();
+
+        ensure(!bloom.matches("Hello")) << "- Bloom filter should not contain 'Hello'";
+
+        bloom.insert("World");
+
+        ensure(bloom.matches("World")) << "- Bloom filter should contain 'World'";
+    };
+
+    "erase_test"_test = []
+    {
+        tnt::deletable_bloom<int> bloom{1'000, 0.01f};
+
+        bloom.insert(42);
+
+        ensure(!bloom.erase(7)) << "- Erasing a missing value should fail";
+        ensure(bloom.erase(42)) << "- A single value lies in collision-free regions and should be erased";
+        ensure(!bloom.matches(42)) << "- Bloom filter should not contain an erased value";
+    };
+
+    "erase_keeps_others_test"_test = []
+    {
+        tnt::deletable_bloom<int> bloom{1'000, 0.01f};
+
+        for (int i{}; i < 1'000; ++i)
+            bloom.insert(i);
+
+        int erased{};
+
+        for (int i{}; i < 1'000; i += 2)
+            erased += bloom.erase(i);
+
+        bool all_found{true};
+
+        for (int i{1}; i < 1'000; i += 2)
+            all_found = all_found && bloom.matches(i);
+
+        ensure(all_found) << "- Erasing values should never introduce false negatives";
+        ensure(erased > 0) << "- Some values should be erasable even in a full filter";
+    };
+
+    "move_test"_test = []
+    {
+        tnt::deletable_bloom<char const *> first{100, 0.01f};
+        tnt::deletable_bloom<char const *> second{1'000, 0.001f};
+
+        first.insert("Hello");
+        second.insert("World");
+
+        swap(first, second);
+
+        ensure(first.matches("World") && !first.matches("Hello")) << "- Swapping should exchange the contents";
+
+        auto moved = std::move(second);
+
+        ensure(moved.matches("Hello") && !moved.matches("World")) << "- Moving should keep the contents";
+    };
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "test.hpp"
+#include <dleft_counting_bloom.hpp>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        // const char * is fine here as the value is not stored
+        tnt::dleft_counting_bloom<char const *> bloom{100};
+
+        bloom.insert("Hello");
+
+        ensure(bloom.matches("Hello")) << "- Bloom filter should contain 'Hello'";
+        ensure(!bloom.matches("World")) << "- Bloom filter should not contain 'World'";
+
+        bloom.clear();
+
+        ensure(!bloom.matches("Hello")) << "- Bloom filter should not contain 'Hello'";
+
+        bloom.insert("World");
+
+        ensure(bloom.matches("World")) << "- Bloom filter should contain 'World'";
+    };
+
+    "erase_test"_test = []
+    {
+        tnt::dleft_counting_bloom<int> bloom{10'000};
+
+        bool inserted{true};
+
+        for (int i{}; i < 10'000; ++i)
+            inserted = inserted && bloom.insert(i);
+
+        ensure(inserted) << "- A filter should never overflow before reaching its capacity";
+
+        // insert the even values a second time, so their counters go to 2
+        for (int i{}; i < 10'000; i += 2)
+            bloom.insert(i);
+
+        for (int i{}; i < 10'000; ++i)
+            bloom.erase(i);
+
+        bool evens_found{true};
+        int odds_found{};
+
+        for (int i{}; i < 10'000; ++i)
+        {
+            if (i % 2 == 0)
+                evens_found = evens_found && bloom.matches(i);
+            else
+                odds_found += bloom.matches(i);
+        }
+
+        ensure(evens_found) << "- Values inserted twice and erased once should still be found";
+        ensure(odds_found < 20) << "- Erased values should not be found anymore, besides false positives";
+    };
+
+    "false_positive_test"_test = []
+    {
+        tnt::dleft_counting_bloom<int> bloom{10'000};
+
+        for (int i{}; i < 10'000; ++i)
+            bloom.insert(i);
+
+        int false_positives{};
+
+        for (int i{10'000}; i < 110'000; ++i)
+            false_positives += bloom.matches(i);
+
+        ensure(false_positives < 300) << "- The false positive rate should be about 0.1%";
+    };
+
+    "capacity_test"_test = []
+    {
+        bool thrown{};
+
+        // more buckets per subtable than the permutations can address without overflowing.
+        try
+        {
+            tnt::dleft_counting_bloom<int> bloom{std::size_t{1} << 36};
+        }
+        catch (std::invalid_argument const &)
+        {
+            thrown = true;
+        }
+
+        ensure(thrown || sizeof(std::size_t) < 8) << "- Filters too large for the permutations should be rejected";
+    };
+
+    return 0;
+}
@@ -0,0 +1,216 @@
+
+#include "test.hpp"
+#include <bloom_filter.hpp>
+#include <fpr_monitor.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "estimate_test"_test = []
+    {
+        // sized for far fewer values, so the false positive rate is well above the requested one.
+        tnt::bloom_filter<int, mixed_hash> bloom{10'000, 0.01f};
+
+        for (int i{}; i < 30'000; ++i)
+            bloom.insert(i * 2);
+
+        tnt::fpr_monitor monitor;
+        std::size_t negatives{};
+        std::size_t false_positives{};
+        std::size_t positives{};
+
+        // half of the queries are present, and one in 8 positive answers is checked against the real set.
+        for (int i{}; i < 60'000; ++i)
+        {
+            auto const found = monitor.matches(bloom, i);
+            auto const present = i % 2 == 0;
+
+            if (!present)
+            {
+                ++negatives;
+                false_positives += found;
+            }
+
+            if (found && positives++ % 8 == 0)
+                monitor.report(present);
+        }
+
+        auto const actual = static_cast<double>(false_positives) / negatives;
+
+        ensure(actual > 0.1) << "- The filter should be saturated";
+        ensure(std::abs(monitor.estimate() - actual) < 0.2 * actual) << "- The estimate should be close to the observed false positive rate";
+
+        monitor.reset();
+
+        ensure(monitor.estimate() == 0.0 && monitor.samples() == 0) << "- Resetting should forget all reports";
+    };
+
+    "callback_test"_test = []
+    {
+        tnt::bloom_filter<int, mixed_hash> bloom{10'000, 0.01f};
+
+        std::size_t fired{};
+        double reported{};
+
+        tnt::fpr_monitor monitor{
+            0.05,
+            [&](double fpr)
+            {
+                ++fired;
+                reported = fpr;
+            },
+            4'096};
+
+        // queries alternate between present and absent values, and every positive answer is checked.
+        int inserted{};
+        auto const query = [&](int rounds)
+        {
+            for (int i{}; i < rounds; ++i)
+            {
+                auto const present = i % 2 == 0;
+                auto const value = present ? (i / 2 % inserted) * 2 : i * 2 + 1;
+
+                if (monitor.matches(bloom, value))
+                    monitor.report(present);
+            }
+        };
+
+        for (; inserted < 10'000; ++inserted)
+            bloom.insert(inserted * 2);
+
+        query(50'000);
+
+        ensure(fired == 0) << "- The callback should not fire while the filter is within its budget";
+
+        for (; inserted < 40'000; ++inserted)
+            bloom.insert(inserted * 2);
+
+        query(50'000);
+
+        ensure(fired == 1 && reported >= 0.05) << "- The callback should fire once when the threshold is crossed";
+
+        monitor.reset();
+        query(50'000);
+
+        ensure(fired == 2) << "- Resetting should re-arm the callback";
+    };
+
+    "decay_test"_test = []
+    {
+        tnt::fpr_monitor monitor{1.0, {}, 1'024};
+
+        // a healthy filter first, then one that gives a false positive for 20% of the absent values.
+        for (int i{}; i < 100'000; ++i)
+        {
+            monitor.record(i % 2 == 0);
+
+            if (i % 2 == 0)
+                monitor.report(true);
+        }
+
+        ensure(monitor.estimate() == 0.0) << "- A filter without false positives should be estimated as such";
+
+        for (int i{}; i < 100'000; ++i)
+        {
+            // per 10 answers: 5 present values and 1 of the 5 absent values match, 4 absent values do not.
+            auto const r = i % 10;
+
+            monitor.record(r < 6);
+
+            if (r < 6)
+                monitor.report(r < 5);
+        }
+
+        ensure(std::abs(monitor.estimate() - 0.2) < 0.02) << "- The estimate should follow the recent answers";
+    };
+
+    "report_thread_test"_test = []
+    {
+        tnt::fpr_monitor monitor{1.0, {}, 1'024};
+
+        // the answers are recorded by this thread, and the ground truth reported by two other ones, one in `every` reports being a false positive.
+        auto const report = [&monitor](int n, int every)
+        {
+            for (int i{}; i < n; ++i)
+                monitor.report(every == 0 || i % every != 0);
+        };
+
+        for (int i{}; i < 100'000; ++i)
+            monitor.record(i % 2 == 0);
+
+        // the first reporter stays alive and idle until the end, so that the second one never reuses its thread.
+        std::atomic<bool> reported{}, done{};
+
+        std::thread first{[&]
+                          {
+                              report(50'000, 0);
+                              reported.store(true);
+
+                              while (!done.load())
+                                  std::this_thread::yield();
+                          }};
+
+        while (!reported.load())
+            std::this_thread::yield();
+
+        // per 10 answers: 6 positive ones, one in 6 of them being a false positive.
+        for (int i{}; i < 100'000; ++i)
+            monitor.record(i % 10 < 6);
+
+        std::thread{[&]
+                    { report(60'000, 6); }}
+            .join();
+
+        auto const estimate = monitor.estimate();
+
+        done.store(true);
+        first.join();
+
+        ensure(std::abs(estimate - 0.2) < 0.02) << "- The estimate should follow the recent reports, even when the thread that reported the older ones went idle";
+    };
+
+    "threads_test"_test = []
+    {
+        std::atomic<std::size_t> fired{};
+
+        tnt::fpr_monitor monitor{
+            0.04,
+            [&](double)
+            { fired.fetch_add(1, std::memory_order_relaxed); }};
+
+        // every thread sees 10% of positive answers, half of which are false positives: 5 / (5 + 90) of the absent values match.
+        std::vector<std::thread> threads;
+
+        for (int t{}; t < 8; ++t)
+        {
+            threads.emplace_back(
+                [&monitor]
+                {
+                    for (int i{}; i < 100'000; ++i)
+                    {
+                        auto const r = i % 100;
+
+                        monitor.record(r < 10);
+
+                        if (r < 10)
+                            monitor.report(r < 5);
+                    }
+                });
+        }
+
+        for (auto &thread : threads)
+            thread.join();
+
+        ensure(std::abs(monitor.estimate() - 5.0 / 95.0) < 0.005) << "- Reports from several threads should all be counted";
+        ensure(fired.load() == 1) << "- The callback should fire once even when several threads cross the threshold";
+    };
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "test.hpp"
+#include <hash_diagnostics.hpp>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+namespace
+{
+    // only fills the low half of the hash, like a 32-bit hash would.
+    struct narrow_hash final
+    {
+        inline std::size_t operator()(std::string const &value) const noexcept
+        {
+            return std::hash<std::string>{}(value) & 0xffff'ffff;
+        }
+    };
+}
+
+int main()
+{
+    "good_hash_test"_test = []
+    {
+        std::vector<std::uint64_t> keys(1'000'000);
+
+        for (std::size_t i{}; i < keys.size(); ++i)
+            keys[i] = i;
+
+        auto const report = tnt::diagnose_hash(keys.begin(), keys.end(), mixed_hash{});
+
+        auto const dof = static_cast<double>(report.degrees_of_freedom);
+
+        ensure(report.keys == keys.size()) << "- All the keys should be sampled";
+        ensure(std::abs(report.chi_square - dof) < 6 * std::sqrt(2 * dof)) << "- Probe positions of a good hash should be uniform";
+        ensure(report.low_bias < 0.01 && report.high_bias < 0.01) << "- Bits of a good hash should not be biased";
+        ensure(report.low_avalanche > 0.95 && report.high_avalanche > 0.95) << "- A good hash should have a strong avalanche effect";
+        ensure(report.measured_fpr < report.theoretical_fpr * 1.2) << "- A good hash should reach the theoretical false positive rate";
+    };
+
+    "identity_hash_test"_test = []
+    {
+        std::vector<std::uint64_t> keys(100'000);
+
+        for (std::size_t i{}; i < keys.size(); ++i)
+            keys[i] = i;
+
+        // std::hash of integers is the identity on most standard libraries.
+        auto const report = tnt::diagnose_hash(keys.begin(), keys.end(), [](std::uint64_t value)
+                                               { return static_cast<std::size_t>(value); });
+
+        ensure(report.high_bias == 1.0) << "- The high half of small integers should never change";
+        ensure(report.low_avalanche < 0.1 && report.high_avalanche < 0.1) << "- The identity should have no avalanche effect";
+    };
+
+    "narrow_hash_test"_test = []
+    {
+        std::vector<std::string> keys;
+
+        for (int i{}; i < 100'000; ++i)
+            keys.push_back("key-" + std::to_string(i));
+
+        auto const report = tnt::diagnose_hash(keys.begin(), keys.end(), narrow_hash{}, 0.01f, 1);
+
+        ensure(report.high_bias == 1.0) << "- The empty high half should be detected";
+        ensure(report.high_avalanche == 0.0) << "- The empty high half should have no avalanche effect";
+        ensure(report.low_avalanche > 0.9) << "- The low half should still have a strong avalanche effect";
+    };
+
+    "opaque_keys_test"_test = []
+    {
+        struct article final
+        {
+            std::string title;
+            std::string author;
+        };
+
+        std::vector<article> keys;
+
+        for (int i{}; i < 10'000; ++i)
+            keys.push_back({"title-" + std::to_string(i), "author"});
+
+        auto const report = tnt::diagnose_hash(keys.begin(), keys.end(), [](article const &value)
+                                               { return std::hash<std::string>{}(value.title); });
+
+        ensure(std::isnan(report.low_avalanche) && std::isnan(report.high_avalanche)) << "- Keys that cannot be changed bit by bit have no avalanche score";
+        ensure(report.low_bias < 0.1 && report.high_bias < 0.1) << "- The bias should still be measured";
+    };
+
+    return 0;
+}
@@ -0,0 +1,214 @@
+
+#include "test.hpp"
+#include <bloom_filter.hpp>
+#include <hybrid_int_filter.hpp>
+
+#include <random>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        tnt::hybrid_int_filter<int> filter;
+
+        filter.insert(42);
+        filter.insert(-7);
+
+        ensure(filter.matches(42) && filter.matches(-7)) << "- Filter should contain the inserted values";
+        ensure(!filter.matches(43) && !filter.matches(7)) << "- Filter should not contain other values";
+        ensure(filter.size() == 2 && filter.exact()) << "- Small chunks should be exact";
+
+        filter.clear();
+
+        ensure(!filter.matches(42) && filter.size() == 0) << "- Filter should be empty after clearing";
+    };
+
+    "dense_test"_test = []
+    {
+        constexpr std::uint64_t range = 500'000;
+        constexpr std::size_t n = 400'000;
+
+        std::vector<std::uint64_t> values(range);
+
+        for (std::uint64_t i{}; i < range; ++i)
+            values[i] = i;
+
+        std::shuffle(values.begin(), values.end(), std::mt19937_64{42});
+        values.resize(n);
+
+        tnt::hybrid_int_filter<std::uint64_t> filter;
+        filter.insert(values.begin(), values.end());
+        filter.optimize();
+
+        std::vector<bool> present(range);
+
+        for (auto const value : values)
+            present[value] = true;
+
+        bool same{true};
+
+        for (std::uint64_t i{}; i < range + 100'000; ++i)
+            same = same && filter.matches(i) == (i < range && present[i]);
+
+        ensure(same) << "- Dense chunks should have no false positives";
+        ensure(filter.exact() && filter.size() == n) << "- Dense chunks should be exact";
+        ensure(filter.bytes() < tnt::bloom_filter_bits(n, 0.01f) / 8) << "- Dense chunks should be smaller than a bloom filter at 1%";
+    };
+
+    "elias_fano_test"_test = []
+    {
+        // about 2'000 values per chunk, too many for a bloom segment and too few for a bitmap.
+        tnt::hybrid_int_filter<std::uint32_t> filter;
+        std::vector<std::uint32_t> values;
+
+        for (std::uint32_t i{}; i < 100'000; ++i)
+            values.push_back(static_cast<std::uint32_t>(tnt::utils::mix64(i) % (std::uint64_t{1} << 22)));
+
+        filter.insert(values.begin(), values.end());
+
+        auto const before = filter.bytes();
+        filter.optimize();
+
+        std::vector<bool> present(std::size_t{1} << 22);
+
+        for (auto const value : values)
+            present[value] = true;
+
+        bool same{true};
+
+        for (std::uint32_t i{}; i < (std::uint32_t{1} << 22); ++i)
+            same = same && filter.matches(i) == present[i];
+
+        ensure(same && filter.exact()) << "- Elias-Fano chunks should be exact";
+        ensure(filter.bytes() < before) << "- Elias-Fano chunks should be smaller than arrays";
+
+        // inserting into an Elias-Fano chunk turns it back into an array.
+        filter.insert(1u << 21);
+        filter.insert(42u);
+
+        ensure(filter.matches(1u << 21) && filter.matches(42u)) << "- Values inserted after optimizing should match";
+        ensure(filter.matches(values.front()) && filter.matches(values.back())) << "- Values inserted before optimizing should still match";
+    };
+
+    "sparse_test"_test = []
+    {
+        constexpr std::size_t n = 1'000'000;
+
+        // about 15 values per chunk, where a bloom segment is smaller than any exact container.
+        tnt::hybrid_int_filter<std::uint64_t> filter{0.01f};
+        tnt::hybrid_int_filter<std::uint64_t> exact{0.0f};
+
+        std::mt19937_64 rng{7};
+        std::vector<std::uint64_t> values(n);
+
+        for (auto &value : values)
+            value = rng() & 0xffff'ffffull;
+
+        std::sort(values.begin(), values.end());
+
+        filter.insert(values.begin(), values.end());
+        exact.insert(values.begin(), values.end());
+        filter.optimize();
+        exact.optimize();
+
+        bool all{true};
+
+        for (auto const value : values)
+            all = all && filter.matches(value);
+
+        std::size_t false_positives{};
+        std::size_t absent{};
+
+        for (std::size_t i{}; i < n; ++i)
+        {
+            auto const value = rng() & 0xffff'ffffull;
+
+            if (!std::binary_search(values.begin(), values.end(), value))
+            {
+                ++absent;
+                false_positives += filter.matches(value);
+            }
+        }
+
+        ensure(all) << "- All inserted values should match";
+        ensure(!filter.exact() && exact.exact()) << "- Sparse chunks should only become bloom segments when allowed";
+        ensure(false_positives < absent / 100 * 2) << "- The false positive rate should be close to the requested one";
+        ensure(filter.bytes() < exact.bytes()) << "- Bloom segments should be smaller than exact containers";
+    };
+
+    "random_test"_test = []
+    {
+        constexpr std::size_t n = 200'000;
+
+        // random 64-bit integers leave a single value in almost every chunk.
+        tnt::hybrid_int_filter<std::uint64_t> filter;
+
+        std::mt19937_64 rng{11};
+        std::vector<std::uint64_t> values(2 * n);
+
+        for (auto &value : values)
+            value = rng();
+
+        filter.insert(values.begin(), values.begin() + n);
+        filter.optimize();
+
+        auto const optimized = filter.bytes();
+
+        // values inserted after optimizing go into exact chunks, and do not fill up the segment sized for the first ones.
+        filter.insert(values.begin() + n, values.end());
+
+        bool all{true};
+
+        for (auto const value : values)
+            all = all && filter.matches(value);
+
+        std::size_t false_positives{};
+
+        for (std::size_t i{}; i < n; ++i)
+            false_positives += filter.matches(rng());
+
+        ensure(all) << "- All inserted values should match";
+        ensure(false_positives < n / 100 * 2) << "- Values inserted after optimizing should not raise the false positive rate";
+        ensure(optimized < tnt::bloom_filter_bits(n, 0.01f) / 8 * 2) << "- Sparse values should take about as much memory as a bloom filter";
+
+        filter.optimize();
+
+        ensure(filter.size() == 2 * n && filter.bytes() < tnt::bloom_filter_bits(2 * n, 0.01f) / 8 * 2) << "- Optimizing again should fold the new values into another segment";
+    };
+
+    "batch_matches_test"_test = []
+    {
+        tnt::hybrid_int_filter<int> filter;
+        std::vector<int> values;
+
+        for (int i{}; i < 300'000; ++i)
+            values.push_back(static_cast<int>(tnt::utils::mix64(static_cast<std::uint64_t>(i)) % 1'000'000) * (i % 2 ? 1 : 50));
+
+        filter.insert(values.begin(), values.end());
+        filter.optimize();
+
+        std::vector<int> queries(200'000);
+
+        for (int i{}; i < 200'000; ++i)
+            queries[i] = i * 97 - 1'000'000;
+
+        std::unique_ptr<bool[]> found{new bool[queries.size()]};
+        auto const count = filter.matches(queries.begin(), queries.end(), found.get());
+
+        bool same{true};
+        std::size_t expected{};
+
+        for (std::size_t i{}; i < queries.size(); ++i)
+        {
+            same = same && found[i] == filter.matches(queries[i]);
+            expected += found[i];
+        }
+
+        ensure(same && count == expected) << "- Batched queries should agree with single queries";
+    };
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+
+#pragma once
+
+#include <sharded_bloom.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace tnt::test
+{
+    // Spawn one server process per owner, and connect to all of them.
+    struct local_cluster final
+    {
+        explicit local_cluster(std::size_t owners)
+        {
+            // a fresh directory per cluster, so that concurrent runs never share a socket.
+            auto pattern = (std::filesystem::temp_directory_path() / "tnt_shard_XXXXXX").string();
+
+            if (!::mkdtemp(pattern.data()))
+                throw std::system_error{errno, std::generic_category(), "Cannot create the socket directory"};
+
+            directory = pattern;
+
+            std::vector<std::string> paths;
+            std::vector<std::unique_ptr<tnt::unix_socket_server>> servers;
+
+            for (std::size_t i{}; i < owners; ++i)
+            {
+                paths.push_back((directory / (std::to_string(i) + ".sock")).string());
+
+                // the socket listens before the fork, so the parent can connect right away.
+                servers.push_back(std::make_unique<tnt::unix_socket_server>(paths.back()));
+
+                if (auto const pid = ::fork(); pid == 0)
+                {
+                    tnt::shard_node node;
+                    servers.back()->serve(node);
+                    ::_exit(0);
+                }
+                else
+                    children.push_back(pid);
+            }
+
+            transport = std::make_unique<tnt::unix_socket_transport>(paths);
+        }
+
+        ~local_cluster()
+        {
+            // servers that were not stopped, eg. because a test threw, would otherwise outlive the test.
+            for (auto const pid : children)
+            {
+                ::kill(pid, SIGKILL);
+                ::waitpid(pid, nullptr, 0);
+            }
+
+            std::error_code ignored;
+            std::filesystem::remove_all(directory, ignored);
+        }
+
+        // stop the servers, and tell whether they all exited cleanly.
+        bool stop()
+        {
+            bool clean{true};
+
+            for (std::size_t i{}; i < children.size(); ++i)
+                tnt::stop_owner(*transport, i);
+
+            for (auto const pid : children)
+            {
+                int status{};
+                ::waitpid(pid, &status, 0);
+                clean = clean && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            }
+
+            children.clear();
+
+            return clean;
+        }
+
+        std::filesystem::path directory;
+        std::vector<pid_t> children;
+        std::unique_ptr<tnt::unix_socket_transport> transport;
+    };
+}
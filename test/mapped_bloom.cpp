@@ -0,0 +1,67 @@
+
+#include "test.hpp"
+#include <mapped_bloom.hpp>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        // const char * is fine here as the value is not stored
+        tnt::mapped_bloom<char const *> bloom{100, 0.01f};
+
+        bloom.insert("Hello");
+
+        ensure(bloom.matches("Hello")) << "- Bloom filter should contain 'Hello'";
+        ensure(!bloom.matches("World")) << "- Bloom filter should not contain 'World'";
+
+        bloom.clear();
+
+        ensure(!bloom.matches("Hello")) << "- Bloom filter should not contain 'Hello'";
+
+        bloom.insert("World");
+
+        ensure(bloom.matches("World")) << "- Bloom filter should contain 'World'";
+    };
+
+    "large_test"_test = []
+    {
+        // about 1.2 GB of bits, most of which are never touched.
+        tnt::mapped_bloom<int, mixed_hash> bloom{1'000'000'000};
+
+        for (int i{}; i < 10'000; ++i)
+            bloom.insert(i);
+
+        bool all{true};
+
+        for (int i{}; i < 10'000; ++i)
+            all = all && bloom.matches(i);
+
+        ensure(all) << "- All inserted values should match";
+
+        bloom.clear();
+
+        ensure(!bloom.matches(42)) << "- Clearing should drop the pages of the filter";
+    };
+
+    "copy_test"_test = []
+    {
+        tnt::mapped_bloom<int, mixed_hash> bloom{10'000};
+
+        for (int i{}; i < 10'000; ++i)
+            bloom.insert(i);
+
+        auto copy = bloom;
+        bloom.clear();
+
+        ensure(!bloom.matches(42) && copy.matches(42)) << "- Copies should map their own pages";
+
+        bloom = std::move(copy);
+
+        ensure(bloom.matches(42)) << "- Moving should keep the contents";
+    };
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+
+#include "test.hpp"
+#include <overlay_bloom.hpp>
+
+#include <bloom_cache.hpp>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        auto base = std::make_shared<tnt::bloom_filter<int, mixed_hash>>(100'000, 0.01f);
+
+        for (int i{}; i < 90'000; ++i)
+            base->insert(i);
+
+        tnt::overlay_bloom<int, mixed_hash> first{base};
+        tnt::overlay_bloom<int, mixed_hash> second{base};
+
+        auto full = *base;
+
+        for (int i{}; i < 100; ++i)
+        {
+            first.insert(1'000'000 + i);
+            second.insert(2'000'000 + i);
+            full.insert(1'000'000 + i);
+        }
+
+        bool same{true};
+
+        for (int i{}; i < 3'000'000; i += 7)
+            same = same && first.matches(i) == full.matches(i);
+
+        for (int i{}; i < 100; ++i)
+            same = same && first.matches(1'000'000 + i);
+
+        std::size_t leaked{};
+
+        for (int i{}; i < 100; ++i)
+            leaked += first.matches(2'000'000 + i) + base->matches(1'000'000 + i);
+
+        ensure(same) << "- An overlay should match exactly like a copy of the base with the same insertions";
+        ensure(leaked < 10) << "- Insertions into an overlay should not be seen by the base or by other overlays";
+        ensure(first.delta_words() <= 100 * 6 && first.delta_bytes() * 4 < tnt::bloom_filter_bits(100'000, 0.01f) / 8) << "- The delta should be much smaller than the base";
+    };
+
+    "compact_test"_test = []
+    {
+        auto base = std::make_shared<tnt::bloom_filter<int, mixed_hash>>(10'000, 0.01f);
+
+        for (int i{}; i < 5'000; ++i)
+            base->insert(i);
+
+        tnt::overlay_bloom<int, mixed_hash> first{base};
+        tnt::overlay_bloom<int, mixed_hash> second{base};
+
+        for (int i{}; i < 500; ++i)
+        {
+            first.insert(10'000 + i);
+            second.insert(10'000 + i * 2);
+        }
+
+        bool before[20'000];
+
+        for (int i{}; i < 20'000; ++i)
+            before[i] = first.matches(i);
+
+        auto const next = first.compact();
+
+        bool same{true};
+
+        for (int i{}; i < 20'000; ++i)
+            same = same && first.matches(i) == before[i];
+
+        ensure(first.delta_words() == 0 && first.base() == next) << "- Compacting should fold the delta into a new base";
+        ensure(same) << "- Compacting should not change the results";
+        ensure(second.base() == base) << "- Compacting should not affect other overlays";
+
+        auto const words = second.delta_words();
+
+        second.rebase(next);
+
+        bool kept{true};
+
+        for (int i{}; i < 500; ++i)
+            kept = kept && second.matches(10'000 + i * 2);
+
+        ensure(kept && second.generation() == 1) << "- Rebasing should keep the values inserted into the overlay";
+        ensure(second.delta_words() < words) << "- Rebasing should drop the bits the new base already has";
+
+        bool thrown{false};
+
+        try
+        {
+            second.rebase(std::make_shared<tnt::bloom_filter<int, mixed_hash>>(20'000, 0.01f));
+        }
+        catch (std::invalid_argument const &)
+        {
+            thrown = true;
+        }
+
+        ensure(thrown) << "- A base of another size should be rejected";
+    };
+
+    "cache_test"_test = []
+    {
+        auto base = std::make_shared<tnt::bloom_filter<int, mixed_hash>>(1'000, 0.01f);
+
+        for (int i{}; i < 500; ++i)
+            base->insert(i);
+
+        tnt::overlay_bloom<int, mixed_hash> overlay{base};
+        tnt::bloom_cache cache{overlay};
+
+        bool same{true};
+
+        for (int i{}; i < 1'000; ++i)
+            same = same && cache.matches(i) == overlay.matches(i);
+
+        overlay.insert(750);
+
+        for (int i{}; i < 1'000; ++i)
+            same = same && cache.matches(i) == overlay.matches(i);
+
+        ensure(same) << "- Overlays should work with bloom_cache";
+    };
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+
+#include "test.hpp"
+#include <parquet_bloom.hpp>
+
+#include <string>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "xxhash_test"_test = []
+    {
+        auto const hash = [](std::string_view s)
+        { return tnt::utils::xxhash64(s.data(), s.size()); };
+
+        ensure(hash("") == 0xef46db3751d8e999) << "- XXH64 of an empty input should match the reference";
+        ensure(hash("a") == 0xd24ec4f1a98c6e5b) << "- XXH64 of a short input should match the reference";
+        ensure(hash("abc") == 0x44bc2cf5ad770999) << "- XXH64 of a short input should match the reference";
+        ensure(hash("Nobody inspects the spammish repetition") == 0xfbcea83c8a378bf1) << "- XXH64 of a long input should match the reference";
+
+        ensure(tnt::parquet_hash{}(std::int32_t{42}) == 0xd756d7b62fc50bf1) << "- INT32 values should be hashed as 4 little-endian bytes";
+        ensure(tnt::parquet_hash{}(std::int64_t{42}) == 0xb556806fb6d14353) << "- INT64 values should be hashed as 8 little-endian bytes";
+    };
+
+    "general_test"_test = []
+    {
+        tnt::parquet_bloom<std::string> bloom{1'000};
+
+        for (int i{}; i < 1'000; ++i)
+            bloom.insert("key-" + std::to_string(i));
+
+        bool all{true};
+        std::size_t false_positives{};
+
+        for (int i{}; i < 1'000; ++i)
+            all = all && bloom.matches("key-" + std::to_string(i));
+
+        for (int i{1'000}; i < 101'000; ++i)
+            false_positives += bloom.matches("key-" + std::to_string(i));
+
+        ensure(all) << "- All inserted values should match";
+        ensure(false_positives < 100'000 / 100 * 2) << "- The false positive rate should be close to the requested one";
+
+        auto const view = bloom.view();
+
+        ensure(view.data() == bloom.data() && view.matches(std::string_view{"key-42"})) << "- The view should read the bitset in place";
+    };
+
+    "parquet_compatibility_test"_test = []
+    {
+        // digests of the bitsets written by another Parquet writer, for 500 distinct values in each column.
+        tnt::parquet_bloom<std::int64_t> int64_bloom{500};
+        tnt::parquet_bloom<std::int32_t> int32_bloom{500};
+        tnt::parquet_bloom<std::string> string_bloom{500};
+        tnt::parquet_bloom<double> double_bloom{500};
+
+        for (int i{}; i < 500; ++i)
+        {
+            int64_bloom.insert(i);
+            int32_bloom.insert(i);
+            string_bloom.insert("key-" + std::to_string(i));
+            double_bloom.insert(i);
+        }
+
+        auto const digest = [](auto const &bloom)
+        { return tnt::utils::xxhash64(bloom.data(), bloom.size()); };
+
+        ensure(int64_bloom.size() == 1'024) << "- Bitsets should be sized like Parquet writers do";
+        ensure(digest(int64_bloom) == 0x8b74d6f471145fb6) << "- INT64 bitsets should be the same as Parquet writers'";
+        ensure(digest(int32_bloom) == 0x0b081d2e577ee2c4) << "- INT32 bitsets should be the same as Parquet writers'";
+        ensure(digest(string_bloom) == 0xb910c5ef178ea82f) << "- BYTE_ARRAY bitsets should be the same as Parquet writers'";
+        ensure(digest(double_bloom) == 0xfe732053b63e1b80) << "- DOUBLE bitsets should be the same as Parquet writers'";
+    };
+
+    "view_test"_test = []
+    {
+        tnt::parquet_bloom<std::int64_t> bloom{100};
+
+        bloom.insert(7);
+
+        // read back from an unaligned copy, like a bitset in the middle of a file.
+        std::string file(bloom.size() + 1, '\0');
+        std::memcpy(file.data() + 1, bloom.data(), bloom.size());
+
+        tnt::parquet_bloom_view<std::int64_t> view{file.data() + 1, bloom.size()};
+
+        ensure(view.matches(7) && !view.matches(8)) << "- The view should read an unaligned bitset";
+
+        bool thrown{false};
+
+        try
+        {
+            tnt::parquet_bloom_view<std::int64_t> broken{file.data(), 33};
+        }
+        catch (std::invalid_argument const &)
+        {
+            thrown = true;
+        }
+
+        ensure(thrown) << "- A bitset that is not made of blocks should be rejected";
+    };
+
+    return 0;
+}
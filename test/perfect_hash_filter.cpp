@@ -0,0 +1,47 @@
+#include "test.hpp"
+#include <perfect_hash_filter.hpp>
+
+#include <string>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        // const char * is fine here as the value is not stored
+        char const *words[]{"Hello", "Hello", "Modern", "Bloom"};
+
+        tnt::perfect_hash_filter<char const *> filter{words, words + 4};
+
+        ensure(filter.matches("Hello")) << "- Filter should contain 'Hello'";
+        ensure(filter.matches("Bloom")) << "- Filter should contain 'Bloom'";
+        ensure(!filter.matches("World")) << "- Filter should not contain 'World'";
+    };
+
+    "parallel_build_test"_test = []
+    {
+        std::vector<std::string> keys;
+
+        for (int i{}; i < 100'000; ++i)
+            keys.push_back("key-" + std::to_string(i));
+
+        tnt::perfect_hash_filter<std::string> filter{keys.begin(), keys.end(), 4};
+
+        bool all_found{true};
+
+        for (auto const &key : keys)
+            all_found = all_found && filter.matches(key);
+
+        int false_positives{};
+
+        for (int i{}; i < 100'000; ++i)
+            false_positives += filter.matches("missing-" + std::to_string(i));
+
+        ensure(all_found) << "- Every key should be found";
+        ensure(false_positives < 600) << "- The false positive rate should be about 1/255";
+    };
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+
+#include "test.hpp"
+#include <resizable_bloom.hpp>
+
+#include <string>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        tnt::resizable_bloom<std::string> bloom{10};
+
+        bloom.insert(std::string{"Hello"});
+
+        ensure(bloom.matches(std::string{"Hello"})) << "- Bloom filter should contain 'Hello'";
+        ensure(!bloom.matches(std::string{"World"})) << "- Bloom filter should not contain 'World'";
+
+        bloom.resize(1'000);
+
+        ensure(bloom.matches(std::string{"Hello"}) && bloom.size() == 1) << "- Resizing should keep the values";
+
+        bloom.clear();
+
+        ensure(!bloom.matches(std::string{"Hello"}) && bloom.size() == 0) << "- Clearing should also drop the retained hashes";
+    };
+
+    "resize_test"_test = []
+    {
+        constexpr int n = 200'000;
+
+        // sized for far fewer values, so the filter is saturated before resizing.
+        tnt::resizable_bloom<int, mixed_hash> bloom{1'000};
+        tnt::bloom_filter<int, mixed_hash> expected{n, 0.01f};
+
+        for (int i{}; i < n; ++i)
+        {
+            bloom.insert(i);
+            expected.insert(i);
+        }
+
+        // values inserted twice only count once within a chunk.
+        bloom.insert(42);
+
+        std::size_t before{};
+
+        for (int i{n}; i < 2 * n; ++i)
+            before += bloom.matches(i);
+
+        bloom.resize(n, 0.01f, 4);
+
+        bool all{true};
+        bool same{true};
+        std::size_t false_positives{};
+
+        for (int i{}; i < n; ++i)
+            all = all && bloom.matches(i);
+
+        for (int i{n}; i < 2 * n; ++i)
+        {
+            auto const found = bloom.matches(i);
+
+            false_positives += found;
+            same = same && found == expected.matches(i);
+        }
+
+        ensure(before > n / 2) << "- The filter should be saturated before resizing";
+        ensure(all) << "- All inserted values should match after resizing";
+        ensure(false_positives < n / 100 * 2) << "- The false positive rate should be close to the requested one";
+        ensure(same) << "- Resizing should give the same filter as inserting the values again";
+    };
+
+    "memory_test"_test = []
+    {
+        constexpr std::size_t n = 1'000'000;
+
+        tnt::resizable_bloom<std::string> bloom{n};
+
+        std::size_t key_bytes{};
+
+        for (std::size_t i{}; i < n; ++i)
+        {
+            auto const key = "user:" + std::to_string(i * 7'919) + "@example.com";
+
+            key_bytes += key.size();
+            bloom.insert(key);
+        }
+
+        ensure(bloom.retained_bytes() < n * 7) << "- Retained hashes should take less than 7 bytes each";
+        ensure(bloom.retained_bytes() < key_bytes / 2) << "- Retained hashes should take a fraction of the memory of the keys";
+    };
+
+    "threads_test"_test = []
+    {
+        tnt::resizable_bloom<int, mixed_hash> single{100};
+        std::vector<int> values(50'000);
+
+        for (int i{}; i < 50'000; ++i)
+            values[i] = i * 3;
+
+        single.insert(values.begin(), values.end());
+
+        auto parallel = single;
+
+        single.resize(50'000, 0.001f, 1);
+        parallel.resize(50'000, 0.001f, 8);
+
+        bool same{true};
+
+        for (int i{}; i < 150'000; ++i)
+            same = same && single.matches(i) == parallel.matches(i);
+
+        ensure(same) << "- The number of threads should not change the resized filter";
+        ensure(single.filter().version() == 50'000) << "- Resizing should keep the version of the filter";
+    };
+
+    return 0;
+}
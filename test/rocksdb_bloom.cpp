@@ -0,0 +1,142 @@
+
+#include "test.hpp"
+#include <rocksdb_bloom.hpp>
+
+#include <vector>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        tnt::rocksdb_bloom<std::uint64_t> bloom{10'000};
+
+        for (std::uint64_t i{}; i < 10'000; ++i)
+            bloom.insert_hash(tnt::utils::mix64(i));
+
+        bool all{true};
+        std::size_t false_positives{};
+
+        for (std::uint64_t i{}; i < 10'000; ++i)
+            all = all && bloom.view().matches_hash(tnt::utils::mix64(i));
+
+        for (std::uint64_t i{10'000}; i < 110'000; ++i)
+            false_positives += bloom.view().matches_hash(tnt::utils::mix64(i));
+
+        ensure(all) << "- All inserted keys should match";
+        ensure(bloom.num_probes() == 6) << "- 10 bits per key should use 6 probes, like RocksDB";
+        ensure(false_positives < 100'000 / 100 * 2) << "- 10 bits per key should give about 1% false positives";
+    };
+
+    "format_test"_test = []
+    {
+        // 60 keys at 10 bits per key take 2 cache lines.
+        tnt::rocksdb_bloom<std::uint64_t> bloom{60};
+
+        std::uint64_t const hash = 0x0123'4567'89ab'cdef;
+        bloom.insert_hash(hash);
+
+        auto const bytes = static_cast<unsigned char const *>(bloom.data());
+
+        ensure(bloom.size() == 128 + 5) << "- The block should hold whole cache lines and 5 bytes of metadata";
+        ensure(bytes[128] == 0xff && bytes[129] == 0 && bytes[130] == 6 && bytes[131] == 0 && bytes[132] == 0) << "- The metadata should be the one of RocksDB";
+
+        // the line is FastRange32 of the low half, the bits the top 9 bits of the high half times powers of the golden ratio.
+        std::size_t const line = (std::uint64_t{0x89ab'cdef} * 2) >> 32;
+        unsigned char expected[128]{};
+
+        std::uint32_t h = 0x0123'4567;
+
+        for (int i{}; i < 6; ++i, h *= 0x9e37'79b9)
+            expected[line * 64 + (h >> 23) / 8] |= 1 << ((h >> 23) % 8);
+
+        ensure(std::memcmp(bytes, expected, 128) == 0) << "- The bits should be set like RocksDB does";
+    };
+
+    "probes_test"_test = []
+    {
+        bool same{true};
+
+        // more than 8 probes take more than one round of the vectorized check.
+        for (double bits : {1.0, 5.0, 16.0, 30.0, 60.0})
+        {
+            tnt::rocksdb_bloom<std::uint64_t> bloom{1'000, bits};
+
+            for (std::uint64_t i{}; i < 1'000; ++i)
+                bloom.insert_hash(tnt::utils::mix64(i));
+
+            auto const view = bloom.view();
+            auto const bytes = static_cast<unsigned char const *>(bloom.data());
+
+            for (std::uint64_t i{}; i < 20'000; ++i)
+            {
+                auto const hash = tnt::utils::mix64(i);
+                auto const line = bytes + ((hash & 0xffff'ffff) * ((bloom.size() - 5) / 64) >> 32) * 64;
+
+                bool expected{true};
+                auto h = static_cast<std::uint32_t>(hash >> 32);
+
+                for (int p{}; p < view.num_probes(); ++p, h *= 0x9e37'79b9)
+                    expected = expected && (line[(h >> 23) / 8] >> ((h >> 23) % 8)) & 1;
+
+                same = same && view.matches_hash(hash) == expected;
+            }
+        }
+
+        ensure(same) << "- Queries should check the same bits as insertions set";
+    };
+
+    "batch_test"_test = []
+    {
+        tnt::rocksdb_bloom<int> bloom{1'000};
+
+        std::vector<int> keys;
+
+        for (int i{}; i < 1'000; ++i)
+        {
+            bloom.insert(i * 3);
+            keys.push_back(i);
+        }
+
+        std::vector<bool> found;
+        bloom.matches(keys.begin(), keys.end(), std::back_inserter(found));
+
+        bool same{found.size() == keys.size()};
+
+        for (std::size_t i{}; same && i < keys.size(); ++i)
+            same = found[i] == bloom.matches(keys[i]);
+
+        ensure(same) << "- Batched queries should give the same results as single ones";
+    };
+
+    "view_test"_test = []
+    {
+        unsigned char const empty[5]{0xff, 0, 6, 0, 0};
+
+        tnt::rocksdb_bloom_view<int> view{empty, sizeof(empty)};
+
+        ensure(!view.matches(42)) << "- A block made of metadata only should match nothing";
+
+        // a legacy block ends with the number of probes and the number of lines.
+        unsigned char legacy[64 + 5]{};
+        legacy[64] = 6;
+        legacy[65] = 1;
+
+        bool thrown{false};
+
+        try
+        {
+            tnt::rocksdb_bloom_view<int> broken{legacy, sizeof(legacy)};
+        }
+        catch (std::invalid_argument const &)
+        {
+            thrown = true;
+        }
+
+        ensure(thrown) << "- Blocks in other formats should be rejected";
+    };
+
+    return 0;
+}
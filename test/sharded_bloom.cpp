@@ -0,0 +1,277 @@
+
+#include "test.hpp"
+#include <sharded_bloom.hpp>
+
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include "local_cluster.hpp"
+#endif
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+// A loopback transport that fails the next response of owner 0, either with an error status or by throwing like a broken connection.
+struct faulty_transport final
+{
+    enum class fault
+    {
+        none,
+        status,
+        connection,
+    };
+
+    explicit faulty_transport(std::size_t owners)
+        : inner{owners}
+    {
+    }
+
+    std::size_t owners() const noexcept
+    {
+        return inner.owners();
+    }
+
+    void send(std::size_t owner, std::vector<std::uint8_t> const &request)
+    {
+        inner.send(owner, request);
+    }
+
+    std::vector<std::uint8_t> receive(std::size_t owner)
+    {
+        auto response = inner.receive(owner);
+
+        if (owner != 0 || next == fault::none)
+            return response;
+
+        auto const failure = std::exchange(next, fault::none);
+
+        if (failure == fault::connection)
+            throw std::runtime_error{"The connection was lost"};
+
+        return {1, 'x'};
+    }
+
+    tnt::loopback_transport inner;
+    fault next{};
+};
+
+template <typename F>
+bool throws(F &&f)
+{
+    try
+    {
+        f();
+    }
+    catch (std::runtime_error const &)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+int main()
+{
+    "routing_test"_test = []
+    {
+        tnt::shard_map map{4};
+
+        ensure(map.ranges().size() == 4 && map.ranges()[1].start == std::uint64_t{1} << 62) << "- Ranges should be split by the prefix of the hash";
+        ensure(map.route(0) == 0 && map.route(~std::uint64_t{}) == 3 && map.route(std::uint64_t{1} << 63) == 2) << "- Hashes should be routed by their prefix";
+
+        auto const upper = map.split(3, 0);
+
+        ensure(upper == 4 && map.ranges()[4].start == (std::uint64_t{7} << 61) && map.ranges()[4].owner == 0) << "- Splitting should halve the range";
+        ensure(map.route((std::uint64_t{7} << 61) - 1) == 3 && map.route(std::uint64_t{7} << 61) == 4) << "- Splitting should only move the upper half";
+
+        tnt::shard_map odd{3};
+
+        ensure(odd.route(~std::uint64_t{}) == 2) << "- The last range should end with the hash space";
+    };
+
+    "loopback_test"_test = []
+    {
+        tnt::loopback_transport transport{4};
+        tnt::sharded_bloom<int, tnt::loopback_transport> bloom{transport, 10'000, 0.01f};
+
+        std::vector<int> keys(10'000);
+        std::iota(keys.begin(), keys.end(), 0);
+
+        bloom.insert(keys.begin(), keys.end());
+
+        std::vector<int> others(100'000);
+        std::iota(others.begin(), others.end(), 10'000);
+
+        auto found = std::make_unique<bool[]>(others.size());
+
+        ensure(bloom.matches(keys.begin(), keys.end(), found.get()) == keys.size()) << "- All inserted values should match";
+
+        auto const false_positives = bloom.matches(others.begin(), others.end(), found.get());
+
+        ensure(false_positives < others.size() / 100 * 2) << "- The false positive rate should be close to the requested one";
+        ensure(found[42] == bloom.matches(others[42])) << "- Batched and single queries should agree";
+
+        bool spread{true};
+
+        for (std::size_t i{}; i < 4; ++i)
+            spread = spread && transport.node(i).ranges() == 1;
+
+        ensure(spread) << "- Each owner should hold one range";
+    };
+
+    "split_test"_test = []
+    {
+        tnt::loopback_transport transport{3};
+        tnt::sharded_bloom<int, tnt::loopback_transport> bloom{transport, tnt::shard_map{2}, 10'000, 0.01f};
+
+        for (int i{}; i < 5'000; ++i)
+            bloom.insert(i);
+
+        auto const upper = bloom.split(0, 2);
+
+        for (int i{5'000}; i < 10'000; ++i)
+            bloom.insert(i);
+
+        bool all{true};
+
+        for (int i{}; i < 10'000; ++i)
+            all = all && bloom.matches(i);
+
+        ensure(upper == 1 && bloom.map().ranges().size() == 3 && transport.node(2).ranges() == 1) << "- The upper half should move to the new owner";
+        ensure(all) << "- Values inserted before and after the split should match";
+
+        bool thrown{false};
+
+        try
+        {
+            bloom.split(5, 0);
+        }
+        catch (std::invalid_argument const &)
+        {
+            thrown = true;
+        }
+
+        ensure(thrown) << "- Splitting a missing range should be rejected";
+    };
+
+#if defined(__unix__) || defined(__APPLE__)
+    "process_test"_test = []
+    {
+        local_cluster cluster{3};
+
+        {
+            tnt::sharded_bloom<std::string, tnt::unix_socket_transport> bloom{*cluster.transport, 1'000, 0.01f};
+
+            for (int i{}; i < 1'000; ++i)
+                bloom.insert("key-" + std::to_string(i));
+
+            bloom.split(1, 0);
+
+            bool all{true};
+            std::size_t false_positives{};
+
+            for (int i{}; i < 1'000; ++i)
+                all = all && bloom.matches("key-" + std::to_string(i));
+
+            for (int i{1'000}; i < 11'000; ++i)
+                false_positives += bloom.matches("key-" + std::to_string(i));
+
+            ensure(all) << "- All inserted values should match across processes";
+            ensure(false_positives < 10'000 / 100 * 2) << "- The false positive rate should be close to the requested one";
+        }
+
+        ensure(cluster.stop()) << "- The servers should stop cleanly";
+    };
+#endif
+
+    "scaling_test"_test = []
+    {
+        constexpr std::size_t keys = 100'000;
+
+        std::vector<std::uint64_t> values(keys);
+        std::iota(values.begin(), values.end(), 0);
+
+        auto found = std::make_unique<bool[]>(keys);
+        bool all{true};
+
+        for (std::size_t owners : {1, 2, 4})
+        {
+            tnt::loopback_transport transport{owners};
+            tnt::sharded_bloom<std::uint64_t, tnt::loopback_transport> bloom{transport, keys, 0.01f};
+
+            bloom.insert(values.begin(), values.end());
+            all = all && bloom.matches(values.begin(), values.end(), found.get()) == keys;
+        }
+
+        ensure(all) << "- All inserted values should match, whatever the number of owners";
+    };
+
+    "failure_test"_test = []
+    {
+        faulty_transport transport{3};
+        tnt::sharded_bloom<int, faulty_transport> bloom{transport, 10'000, 0.01f};
+
+        std::vector<int> keys(10'000);
+        std::iota(keys.begin(), keys.end(), 0);
+
+        bloom.insert(keys.begin(), keys.end());
+
+        auto found = std::make_unique<bool[]>(keys.size());
+
+        transport.next = faulty_transport::fault::status;
+
+        ensure(throws([&] { bloom.matches(keys.begin(), keys.end(), found.get()); })) << "- An error of an owner should be thrown";
+        ensure(bloom.matches(keys.begin(), keys.end(), found.get()) == keys.size()) << "- The responses of the other owners should not be left for the next call";
+
+        transport.next = faulty_transport::fault::connection;
+
+        ensure(throws([&] { bloom.insert(keys.begin(), keys.end()); })) << "- A failure of the transport should be thrown";
+        ensure(throws([&] { bloom.matches(0); })) << "- The filter should refuse to use a transport that failed";
+    };
+
+    "attach_test"_test = []
+    {
+        tnt::loopback_transport transport{3};
+        tnt::sharded_bloom<int, tnt::loopback_transport> bloom{transport, 10'000, 0.01f};
+
+        for (int i{}; i < 10'000; ++i)
+            bloom.insert(i);
+
+        bloom.split(0, 2);
+
+        auto other = tnt::sharded_bloom<int, tnt::loopback_transport>::attach(transport);
+
+        bool same{other.map().ranges().size() == bloom.map().ranges().size()};
+
+        for (std::size_t r{}; same && r < bloom.map().ranges().size(); ++r)
+            same = other.map().ranges()[r].start == bloom.map().ranges()[r].start && other.map().ranges()[r].owner == bloom.map().ranges()[r].owner;
+
+        ensure(same) << "- An attached client should find the ranges of the owners";
+
+        for (int i{10'000}; i < 20'000; ++i)
+            other.insert(i);
+
+        bool all{true};
+
+        for (int i{}; i < 20'000; ++i)
+            all = all && bloom.matches(i) && other.matches(i);
+
+        ensure(all) << "- Clients should see the values inserted by each other";
+
+        tnt::sharded_bloom<int, tnt::loopback_transport> again{transport, 10'000, 0.01f};
+
+        all = true;
+
+        for (int i{}; i < 10'000; ++i)
+            all = all && again.matches(i);
+
+        ensure(all) << "- Creating ranges that already exist should keep their bits";
+        ensure(throws([&] { tnt::sharded_bloom<int, tnt::loopback_transport>{transport, 1'000'000, 0.01f}; })) << "- Creating an existing range with another size should be rejected";
+    };
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include "test.hpp"
+#include <shifting_bloom.hpp>
+
+#include <string>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        // const char * is fine here as the value is not stored
+        tnt::shifting_bloom<char const *> bloom{100, 0.01f};
+
+        bloom.insert("Hello", 3);
+
+        ensure(bloom.matches("Hello", 3)) << "- Set 3 should contain 'Hello'";
+        ensure(!bloom.matches("Hello", 2)) << "- Set 2 should not contain 'Hello'";
+        ensure(bloom.candidates("World") == 0) << "- No set should contain 'World'";
+
+        bloom.clear();
+
+        ensure(!bloom.matches("Hello", 3)) << "- Set 3 should not contain 'Hello'";
+    };
+
+    "tiers_test"_test = []
+    {
+        tnt::shifting_bloom<std::string> tiers{8'000, 0.01f};
+
+        for (int i{}; i < 8'000; ++i)
+            tiers.insert(std::to_string(i), i % 8);
+
+        bool all_found{true};
+        int ambiguous{};
+
+        for (int i{}; i < 8'000; ++i)
+        {
+            auto const sets = tiers.candidates(std::to_string(i));
+
+            all_found = all_found && ((sets >> (i % 8)) & 1);
+            ambiguous += sets != (std::uint64_t{1} << (i % 8));
+        }
+
+        ensure(all_found) << "- Every value should be found in its own tier";
+        ensure(ambiguous < 8'000 / 10) << "- Few values should match more than one tier";
+    };
+
+    "wide_test"_test = []
+    {
+        tnt::shifting_bloom<int, 64> bloom{1'000, 0.01f};
+
+        for (int i{}; i < 1'000; ++i)
+            bloom.insert(i, 63 - i % 64);
+
+        bool all_found{true};
+
+        for (int i{}; i < 1'000; ++i)
+            all_found = all_found && bloom.matches(i, 63 - i % 64);
+
+        ensure(all_found) << "- Windows straddling two words should be read correctly";
+    };
+
+    "move_test"_test = []
+    {
+        tnt::shifting_bloom<int, 8, seeded_hash> first{1'000, 0.01f, seeded_hash{1}};
+        tnt::shifting_bloom<int, 8, seeded_hash> second{100, 0.01f, seeded_hash{2}};
+
+        for (int i{}; i < 1'000; ++i)
+            first.insert(i, i % 8);
+
+        second.insert(-1, 0);
+
+        swap(first, second);
+
+        bool all{true};
+
+        for (int i{}; i < 1'000; ++i)
+            all = all && second.matches(i, i % 8);
+
+        ensure(all && first.matches(-1, 0)) << "- Swapping should exchange the contents, along with their hash";
+
+        auto moved = std::move(second);
+        first = std::move(moved);
+
+        all = true;
+
+        for (int i{}; i < 1'000; ++i)
+            all = all && first.matches(i, i % 8);
+
+        ensure(all) << "- Moving should keep the contents";
+    };
+
+    return 0;
+}
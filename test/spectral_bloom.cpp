@@ -0,0 +1,63 @@
+#include "test.hpp"
+#include <spectral_bloom.hpp>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        // const char * is fine here as the value is not stored
+        tnt::spectral_bloom<char const *> bloom{100, 0.01f};
+
+        bloom.insert("Hello");
+
+        ensure(bloom.matches("Hello")) << "- Bloom filter should contain 'Hello'";
+        ensure(!bloom.matches("World")) << "- Bloom filter should not contain 'World'";
+
+        bloom.clear();
+
+        ensure(!bloom.matches("Hello")) << "- Bloom filter should not contain 'Hello'";
+
+        bloom.insert("World");
+
+        ensure(bloom.matches("World")) << "- Bloom filter should contain 'World'";
+    };
+
+    "count_test"_test = []
+    {
+        tnt::spectral_bloom<int, 8> bloom{1'000, 0.01f};
+
+        // a skewed stream, where value i occurs (i % 10) + 1 times
+        for (int i{}; i < 1'000; ++i)
+            bloom.insert(i, i % 10 + 1);
+
+        bool never_under{true};
+        int exact{};
+
+        for (int i{}; i < 1'000; ++i)
+        {
+            auto const count = bloom.count(i);
+
+            never_under = never_under && count >= static_cast<std::size_t>(i % 10 + 1);
+            exact += count == static_cast<std::size_t>(i % 10 + 1);
+        }
+
+        ensure(never_under) << "- Counts should never be underestimated";
+        ensure(exact > 950) << "- Almost all counts should be exact";
+        ensure(bloom.count(-1) == 0) << "- Missing values should have a count of zero";
+    };
+
+    "saturation_test"_test = []
+    {
+        tnt::spectral_bloom<int, 2> bloom{10, 0.01f};
+
+        for (int i{}; i < 10; ++i)
+            bloom.insert(7);
+
+        ensure(bloom.count(7) == bloom.max_count) << "- Counters should saturate instead of wrapping around";
+    };
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+
+#include "test.hpp"
+#include <string_hash.hpp>
+#include <bloom_filter.hpp>
+#include <hash_diagnostics.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "batch_test"_test = []
+    {
+        // every length up to 100 bytes, at every alignment, so that all the tails are covered.
+        std::string data;
+        std::vector<std::string_view> keys;
+        std::vector<std::uint32_t> offsets{0};
+
+        std::uint64_t x{1};
+
+        for (std::size_t len{}; len <= 100; ++len)
+        {
+            for (std::size_t copy{}; copy < 8; ++copy)
+            {
+                for (std::size_t i{}; i < len; ++i)
+                {
+                    x = tnt::utils::mix64(x);
+                    data += static_cast<char>(x);
+                }
+
+                offsets.push_back(static_cast<std::uint32_t>(data.size()));
+            }
+        }
+
+        for (std::size_t i{}; i + 1 < offsets.size(); ++i)
+            keys.emplace_back(data.data() + offsets[i], offsets[i + 1] - offsets[i]);
+
+        tnt::string_hash const hash;
+
+        std::vector<std::uint64_t> from_views(keys.size());
+        std::vector<std::uint64_t> from_offsets(keys.size());
+
+        hash.batch(keys.data(), keys.size(), from_views.data());
+        hash.batch(offsets.data(), data.data(), keys.size(), from_offsets.data());
+
+        bool same{true};
+
+        for (std::size_t i{}; i < keys.size(); ++i)
+            same = same && from_views[i] == hash(keys[i]) && from_offsets[i] == hash(keys[i]);
+
+        ensure(same) << "- Batched hashes should be the same as single ones";
+        ensure(hash("") != hash(std::string_view{"\0", 1}) && hash("a") != hash(std::string_view{"a\0", 2})) << "- Trailing zeros should change the hash";
+    };
+
+    "quality_test"_test = []
+    {
+        std::vector<std::string> keys;
+
+        for (int i{}; i < 200'000; ++i)
+            keys.push_back("user:" + std::to_string(i) + ":session");
+
+        auto const report = tnt::diagnose_hash(keys.begin(), keys.end(), tnt::string_hash{});
+
+        ensure(report.low_bias < 0.02 && report.high_bias < 0.02) << "- Bits of the hashes should not be biased";
+        ensure(report.low_avalanche > 0.95 && report.high_avalanche > 0.95) << "- The hash should have a strong avalanche effect";
+        ensure(report.measured_fpr < report.theoretical_fpr * 1.2) << "- The hash should reach the theoretical false positive rate";
+    };
+
+    "filter_test"_test = []
+    {
+        tnt::bloom_filter<std::string_view, tnt::string_hash> bloom{1'000, 0.01f};
+
+        std::vector<std::string> keys;
+
+        for (int i{}; i < 1'000; ++i)
+            keys.push_back("key-" + std::to_string(i));
+
+        std::vector<std::string_view> views{keys.begin(), keys.end()};
+        std::vector<std::uint64_t> hashes(views.size());
+
+        tnt::string_hash{}.batch(views.data(), views.size(), hashes.data());
+
+        for (auto const h : hashes)
+            bloom.insert_hash(h);
+
+        bool all{true};
+
+        for (auto const &key : keys)
+            all = all && bloom.matches(std::string_view{key});
+
+        ensure(all) << "- Keys inserted with batched hashes should match";
+    };
+
+    return 0;
+}
@@ -7,6 +7,8 @@
 #include <string>
 #include <string_view>
 
+#include <internal/utils.hpp>
+
 namespace tnt::test
 {
     struct counter final
@@ -141,4 +143,24 @@ namespace tnt::test
     };
 
     inline static general_reporter_type general_reporter{};
+
+    // the hash of small integers has an empty high half, so std::hash would give a poor false positive rate.
+    struct mixed_hash
+    {
+        inline std::size_t operator()(std::uint64_t value) const noexcept
+        {
+            return tnt::utils::mix64(value);
+        }
+    };
+
+    // a hash with a state, to check that filters keep the hash that goes with their bits.
+    struct seeded_hash
+    {
+        std::uint64_t seed{};
+
+        inline std::size_t operator()(std::uint64_t value) const noexcept
+        {
+            return tnt::utils::mix64(value ^ seed);
+        }
+    };
 }
\ No newline at end of file
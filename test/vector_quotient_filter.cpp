@@ -0,0 +1,131 @@
+#include "test.hpp"
+#include <vector_quotient_filter.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace tnt::test;
+using namespace tnt::test::literals;
+
+int main()
+{
+    "general_test"_test = []
+    {
+        // const char * is fine here as the value is not stored
+        tnt::vector_quotient_filter<char const *> filter{100};
+
+        filter.insert("Hello");
+
+        ensure(filter.matches("Hello")) << "- Filter should contain 'Hello'";
+        ensure(!filter.matches("World")) << "- Filter should not contain 'World'";
+
+        filter.clear();
+
+        ensure(!filter.matches("Hello")) << "- Filter should not contain 'Hello'";
+
+        filter.insert("World");
+
+        ensure(filter.matches("World")) << "- Filter should contain 'World'";
+    };
+
+    "erase_test"_test = []
+    {
+        tnt::vector_quotient_filter<int> filter{15'000};
+
+        bool inserted{true};
+
+        for (int i{}; i < 10'000; ++i)
+            inserted = inserted && filter.insert(i);
+
+        // insert the even values a second time, so they are stored twice
+        for (int i{}; i < 10'000; i += 2)
+            inserted = inserted && filter.insert(i);
+
+        ensure(inserted) << "- A filter should never overflow before reaching its capacity";
+
+        for (int i{}; i < 10'000; ++i)
+            filter.erase(i);
+
+        bool evens_found{true};
+        int odds_found{};
+
+        for (int i{}; i < 10'000; ++i)
+        {
+            if (i % 2 == 0)
+                evens_found = evens_found && filter.matches(i);
+            else
+                odds_found += filter.matches(i);
+        }
+
+        ensure(evens_found) << "- Values inserted twice and erased once should still be found";
+        ensure(odds_found < 100) << "- Erased values should not be found anymore, besides false positives";
+    };
+
+    "false_positive_test"_test = []
+    {
+        tnt::vector_quotient_filter<int> filter{10'000};
+
+        for (int i{}; i < 10'000; ++i)
+            filter.insert(i);
+
+        int false_positives{};
+
+        for (int i{10'000}; i < 110'000; ++i)
+            false_positives += filter.matches(i);
+
+        ensure(false_positives < 800) << "- The false positive rate should be about 0.4%";
+    };
+
+    "concurrent_test"_test = []
+    {
+        constexpr int threads = 4;
+        constexpr int per_thread = 25'000;
+
+        tnt::vector_quotient_filter<int> filter{threads * per_thread};
+
+        std::vector<std::thread> pool;
+
+        for (int t{}; t < threads; ++t)
+        {
+            pool.emplace_back([&filter, t]
+                              {
+                                  for (int i = t * per_thread; i < (t + 1) * per_thread; ++i)
+                                  {
+                                      filter.insert(i);
+                                      filter.matches(i + 1);
+                                  } });
+        }
+
+        for (auto &thread : pool)
+            thread.join();
+
+        bool found{true};
+
+        for (int i{}; i < threads * per_thread; ++i)
+            found = found && filter.matches(i);
+
+        ensure(found) << "- Values inserted concurrently should all be found";
+
+        pool.clear();
+
+        for (int t{}; t < threads; ++t)
+        {
+            pool.emplace_back([&filter, t]
+                              {
+                                  for (int i = t * per_thread; i < (t + 1) * per_thread; i += 2)
+                                      filter.erase(i); });
+        }
+
+        for (auto &thread : pool)
+            thread.join();
+
+        found = true;
+
+        for (int i{1}; i < threads * per_thread; i += 2)
+            found = found && filter.matches(i);
+
+        ensure(found) << "- Erasing values concurrently should not affect other values";
+    };
+
+    return 0;
+}